@@ -0,0 +1,129 @@
+/* bench-analysis.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench-common.h"
+
+#include <fft/analysis-core.h>
+#include <stdio.h>
+
+// Number of frames fed to the analysis at once, the same as the live FFT thread reads from the ring buffer
+#define BLOCK_FRAMES (1024)
+
+// Window sizes measured, the hop is always a quarter of the window like the default configuration
+static const int window_sizes[] = {512, 1024, 2048, 4096, 8192};
+
+static void
+count_frame(const float *levels, int channels, int bands, gpointer user_data)
+{
+    guint64 *frames = user_data;
+
+    (*frames)++;
+}
+
+// Feed the whole signal to the core in blocks, as the audio input would.
+static void
+process_signal(AnalysisCore *core, const float *signal, int frames, guint64 *analysis_frames)
+{
+    for (int i = 0; i < frames; i += BLOCK_FRAMES)
+        analysis_core_process(core, signal + (gsize)i * BENCH_CHANNELS, MIN(BLOCK_FRAMES, frames - i),
+                              count_frame, analysis_frames);
+}
+
+/**
+ * Measure the cost of an analysis frame, from the conversion of the input to the band levels.
+ *
+ * Every case runs on the plan the application would end up with once its background planner is done.
+ */
+static void
+bench_config(const AnalysisConfig *config, const char *config_name, BenchSignal signal, const float *samples, int frames)
+{
+    AnalysisCore *core;
+    fftwf_plan plans[ANALYSIS_MAX_PLANS];
+    guint64 analysis_frames = 0;
+    gint64 start, elapsed;
+    char name[64];
+
+    core = analysis_core_new(config);
+    if (analysis_core_is_plan_estimated(core))
+    {
+        for (int i = 0; i < analysis_core_get_plan_count(core); i++)
+            plans[i] = analysis_plan_new(analysis_core_get_plan_size(core, i), analysis_core_get_channels(core),
+                                         ANALYSIS_PLANNER_FLAGS);
+
+        analysis_core_swap_plans(core, plans);
+        for (int i = 0; i < analysis_core_get_plan_count(core); i++)
+            analysis_plan_destroy(plans[i]);
+    }
+
+    // Warm up the caches and let the automatic gain settle before measuring
+    process_signal(core, samples, frames, &analysis_frames);
+
+    analysis_frames = 0;
+    start = bench_now_ns();
+    do
+        process_signal(core, samples, frames, &analysis_frames);
+    while ((elapsed = bench_now_ns() - start) < BENCH_MIN_NS);
+
+    g_snprintf(name, sizeof(name), "%s signal=%s", config_name, bench_signal_get_name(signal));
+    bench_report("analysis", name, analysis_frames, elapsed);
+
+    analysis_core_free(core);
+}
+
+static void
+bench_window_size(int window_size, BenchSignal signal, const float *samples, int frames)
+{
+    AnalysisConfig config;
+    char name[32];
+
+    analysis_config_init(&config, BENCH_SAMPLE_RATE, BENCH_CHANNELS);
+    config.window_size = window_size;
+    config.hop_size = window_size / 4;
+
+    g_snprintf(name, sizeof(name), "window=%d", window_size);
+    bench_config(&config, name, signal, samples, frames);
+}
+
+// Measure the multi-resolution analysis, its frames come as often as with a 2048 sample window.
+static void
+bench_multi_resolution(BenchSignal signal, const float *samples, int frames)
+{
+    AnalysisConfig config;
+
+    analysis_config_init(&config, BENCH_SAMPLE_RATE, BENCH_CHANNELS);
+    analysis_config_apply_preset(&config, ANALYSIS_PRESET_MULTI_RESOLUTION);
+
+    bench_config(&config, "multi-resolution", signal, samples, frames);
+}
+
+int main(int argc, char *argv[])
+{
+    for (BenchSignal signal = 0; signal < BENCH_SIGNAL_COUNT; signal++)
+    {
+        int frames;
+        float *samples = bench_signal_new(signal, &frames);
+
+        for (guint i = 0; i < G_N_ELEMENTS(window_sizes); i++)
+            bench_window_size(window_sizes[i], signal, samples, frames);
+        bench_multi_resolution(signal, samples, frames);
+
+        g_free(samples);
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/* bench-common.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench-common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+// Lowest and highest frequency of the sweep
+#define SWEEP_START_HZ (20.0)
+#define SWEEP_END_HZ (20000.0)
+
+// Seed of the noise generator, fixed so every run analyses the same noise
+#define NOISE_SEED (0x41756469)
+
+static const char *const signal_names[BENCH_SIGNAL_COUNT] = {
+    [BENCH_SIGNAL_SWEEP] = "sweep",
+    [BENCH_SIGNAL_NOISE] = "noise",
+};
+
+const char *bench_signal_get_name(BenchSignal signal)
+{
+    return signal_names[signal];
+}
+
+float *bench_signal_new(BenchSignal signal, int *frames)
+{
+    int n = BENCH_SAMPLE_RATE * BENCH_SIGNAL_SECONDS;
+    float *samples = g_new(float, (gsize)n * BENCH_CHANNELS);
+    GRand *rand;
+
+    switch (signal)
+    {
+    case BENCH_SIGNAL_SWEEP:
+    {
+        // The phase of an exponential sweep has a closed form, so there's no drift over the whole signal
+        double duration = BENCH_SIGNAL_SECONDS;
+        double rate = log(SWEEP_END_HZ / SWEEP_START_HZ);
+
+        for (int i = 0; i < n; i++)
+        {
+            double t = (double)i / BENCH_SAMPLE_RATE;
+            double phase = 2 * G_PI * SWEEP_START_HZ * duration / rate * (exp(t / duration * rate) - 1);
+            float sample = (float)(0.5 * sin(phase));
+
+            for (int c = 0; c < BENCH_CHANNELS; c++)
+                samples[i * BENCH_CHANNELS + c] = sample;
+        }
+        break;
+    }
+
+    case BENCH_SIGNAL_NOISE:
+        rand = g_rand_new_with_seed(NOISE_SEED);
+        for (int i = 0; i < n * BENCH_CHANNELS; i++)
+            samples[i] = (float)g_rand_double_range(rand, -0.5, 0.5);
+        g_rand_free(rand);
+        break;
+
+    case BENCH_SIGNAL_COUNT:
+    default:
+        g_assert_not_reached();
+    }
+
+    *frames = n;
+    return samples;
+}
+
+gint64 bench_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (gint64)now.tv_sec * G_GINT64_CONSTANT(1000000000) + now.tv_nsec;
+}
+
+void bench_report(const char *benchmark, const char *name, guint64 frames, gint64 elapsed_ns)
+{
+    char ns_per_frame[G_ASCII_DTOSTR_BUF_SIZE];
+    char frames_per_second[G_ASCII_DTOSTR_BUF_SIZE];
+
+    // Always a dot as the decimal separator, whatever the locale
+    g_ascii_formatd(ns_per_frame, sizeof(ns_per_frame), "%.1f", (double)elapsed_ns / MAX(frames, 1));
+    g_ascii_formatd(frames_per_second, sizeof(frames_per_second), "%.1f", frames * 1e9 / MAX(elapsed_ns, 1));
+
+    printf("{\"benchmark\": \"%s\", \"case\": \"%s\", \"frames\": %" G_GUINT64_FORMAT ", "
+           "\"ns_per_frame\": %s, \"frames_per_second\": %s}\n",
+           benchmark, name, frames, ns_per_frame, frames_per_second);
+    fflush(stdout);
+}
@@ -0,0 +1,76 @@
+/* bench-common.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Sample rate of the synthetic signals
+#define BENCH_SAMPLE_RATE (48000)
+
+// Number of interleaved channels of the synthetic signals
+#define BENCH_CHANNELS (2)
+
+// Length of the synthetic signals in seconds, long enough for the sweep to cover every band
+#define BENCH_SIGNAL_SECONDS (10)
+
+// Shortest time every case is measured for, in nanoseconds
+#define BENCH_MIN_NS (G_GINT64_CONSTANT(1000000000))
+
+// Synthetic signals the benchmarks run on.
+typedef enum
+{
+    // Logarithmic sine sweep from 20 Hz to 20 kHz, only a few bands are loud at once
+    BENCH_SIGNAL_SWEEP,
+    // White noise, every band is loud and changes every frame
+    BENCH_SIGNAL_NOISE,
+    BENCH_SIGNAL_COUNT,
+} BenchSignal;
+
+// Get the name of a signal as used in the reports.
+const char *bench_signal_get_name(BenchSignal signal);
+
+/**
+ * Generate `BENCH_SIGNAL_SECONDS` of a signal.
+ *
+ * The signal is the same on every run, so results of different builds can be compared.
+ *
+ * @param `frames` set to the number of frames of `BENCH_CHANNELS` interleaved samples
+ * @return the samples, free with `g_free`
+ */
+float *bench_signal_new(BenchSignal signal, int *frames);
+
+// Get the time of a monotonic clock in nanoseconds.
+gint64 bench_now_ns(void);
+
+/**
+ * Print the result of a case as a single line of JSON on the standard output.
+ *
+ * @param `benchmark` name of the benchmark
+ * @param `name` name of the case within the benchmark
+ * @param `frames` number of frames processed during the measurement
+ * @param `elapsed_ns` duration of the measurement
+ */
+void bench_report(const char *benchmark, const char *name, guint64 frames, gint64 elapsed_ns);
+
+G_END_DECLS
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,225 @@
+/* bench-render.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench-common.h"
+
+#include <audiolize-bars.h>
+#include <fft/analysis-core.h>
+#include <stdio.h>
+
+// Shortest number of frames rendered by every case, the analysis of the signal is shown over and over
+#define MIN_RENDER_FRAMES (240)
+
+// Resolutions measured.
+typedef struct
+{
+    const char *name;
+    int width;
+    int height;
+} Resolution;
+
+static const Resolution resolutions[] = {
+    {"1080p", 1920, 1080},
+    {"4k", 3840, 2160},
+};
+
+// Analysed channels measured, one group of bars each.
+static const AnalysisChannelMode channel_modes[] = {
+    ANALYSIS_CHANNELS_MONO,
+    ANALYSIS_CHANNELS_SEPARATE,
+};
+
+// Levels of every analysis frame of a signal, what the views would be fed.
+typedef struct
+{
+    GArray *levels;
+    int bars;
+    guint frames;
+} RenderLevels;
+
+static void
+store_frame(const float *levels, int channels, int bands, gpointer user_data)
+{
+    RenderLevels *render_levels = user_data;
+
+    g_array_append_vals(render_levels->levels, levels, channels * bands);
+    render_levels->bars = channels * bands;
+    render_levels->frames++;
+}
+
+// Analyse a signal with the default configuration of the application.
+static void
+render_levels_init(RenderLevels *render_levels, const float *samples, int frames, AnalysisChannelMode channel_mode)
+{
+    AnalysisConfig config;
+    AnalysisCore *core;
+
+    analysis_config_init(&config, BENCH_SAMPLE_RATE, BENCH_CHANNELS);
+    config.channel_mode = channel_mode;
+
+    *render_levels = (RenderLevels){.levels = g_array_new(FALSE, FALSE, sizeof(float))};
+
+    core = analysis_core_new(&config);
+    analysis_core_process(core, samples, frames, store_frame, render_levels);
+    analysis_core_free(core);
+}
+
+static const float *
+render_levels_get(RenderLevels *render_levels, guint frame)
+{
+    return &g_array_index(render_levels->levels, float, (gsize)(frame % render_levels->frames) * render_levels->bars);
+}
+
+/**
+ * Measure the Cairo view, drawing the bars into an image surface on the CPU.
+ *
+ * Every rendered frame shows a new analysis frame, which is the case when the display refreshes slower than
+ * the analysis. Copying the surface to the window is left to GTK and isn't measured.
+ */
+static void
+bench_cairo(RenderLevels *render_levels, const Resolution *resolution, const char *name)
+{
+    AudiolizeBarSurface bars = {0};
+    guint frames = 0;
+    gint64 start, elapsed;
+    char case_name[128];
+
+    audiolize_bar_surface_resize(&bars, resolution->width, resolution->height);
+
+    start = bench_now_ns();
+    do
+    {
+        audiolize_bar_surface_render(&bars, render_levels_get(render_levels, frames), render_levels->bars, 1.0);
+        cairo_surface_flush(bars.surface);
+        frames++;
+    } while ((elapsed = bench_now_ns() - start) < BENCH_MIN_NS || frames < MIN_RENDER_FRAMES);
+
+    g_snprintf(case_name, sizeof(case_name), "renderer=cairo %s", name);
+    bench_report("render", case_name, frames, elapsed);
+
+    audiolize_bar_surface_destroy(&bars);
+}
+
+/**
+ * Measure the GSK view, building the color nodes of the bars and rendering them into an offscreen texture.
+ *
+ * The texture is not downloaded, so on a GPU renderer this is the cost on the CPU plus whatever the driver
+ * waits for.
+ */
+static void
+bench_gsk(GskRenderer *renderer, RenderLevels *render_levels, const Resolution *resolution, const char *name)
+{
+    graphene_rect_t viewport;
+    guint frames = 0;
+    gint64 start, elapsed;
+    char case_name[128];
+
+    graphene_rect_init(&viewport, 0, 0, resolution->width, resolution->height);
+
+    start = bench_now_ns();
+    do
+    {
+        GtkSnapshot *snapshot = gtk_snapshot_new();
+        GskRenderNode *node;
+        GdkTexture *texture;
+
+        audiolize_bars_snapshot(snapshot, resolution->width, resolution->height,
+                                render_levels_get(render_levels, frames), render_levels->bars);
+        node = gtk_snapshot_free_to_node(snapshot);
+
+        // A frame without a single bar has no node at all
+        if (node != NULL)
+        {
+            texture = gsk_renderer_render_texture(renderer, node, &viewport);
+            g_object_unref(texture);
+            gsk_render_node_unref(node);
+        }
+
+        frames++;
+    } while ((elapsed = bench_now_ns() - start) < BENCH_MIN_NS || frames < MIN_RENDER_FRAMES);
+
+    g_snprintf(case_name, sizeof(case_name), "renderer=%s %s", G_OBJECT_TYPE_NAME(renderer), name);
+    bench_report("render", case_name, frames, elapsed);
+}
+
+// Create the GPU renderer, NULL if there's no display or no GL to render with.
+static GskRenderer *
+create_gpu_renderer(void)
+{
+    GskRenderer *renderer;
+    GError *error = NULL;
+
+    if (!gtk_init_check())
+    {
+        fprintf(stderr, "WARNING: No display, skipping the GPU renderer\n");
+        return NULL;
+    }
+
+    renderer = gsk_gl_renderer_new();
+    if (!gsk_renderer_realize(renderer, NULL, &error))
+    {
+        fprintf(stderr, "WARNING: Could not realize the GPU renderer, skipping it: %s\n", error->message);
+        g_error_free(error);
+        g_object_unref(renderer);
+        return NULL;
+    }
+
+    return renderer;
+}
+
+int main(int argc, char *argv[])
+{
+    GskRenderer *renderer = create_gpu_renderer();
+
+    for (BenchSignal signal = 0; signal < BENCH_SIGNAL_COUNT; signal++)
+    {
+        int frames;
+        float *samples = bench_signal_new(signal, &frames);
+
+        for (guint i = 0; i < G_N_ELEMENTS(channel_modes); i++)
+        {
+            RenderLevels render_levels;
+
+            render_levels_init(&render_levels, samples, frames, channel_modes[i]);
+
+            for (guint j = 0; j < G_N_ELEMENTS(resolutions); j++)
+            {
+                char name[96];
+
+                g_snprintf(name, sizeof(name), "resolution=%s bars=%d signal=%s",
+                           resolutions[j].name, render_levels.bars, bench_signal_get_name(signal));
+
+                bench_cairo(&render_levels, &resolutions[j], name);
+                if (renderer != NULL)
+                    bench_gsk(renderer, &render_levels, &resolutions[j], name);
+            }
+
+            g_array_unref(render_levels.levels);
+        }
+
+        g_free(samples);
+    }
+
+    if (renderer != NULL)
+    {
+        gsk_renderer_unrealize(renderer);
+        g_object_unref(renderer);
+    }
+
+    return 0;
+}
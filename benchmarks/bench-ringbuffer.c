@@ -0,0 +1,164 @@
+/* bench-ringbuffer.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench-common.h"
+
+#include <portaudio-common/pa_ringbuffer.h>
+#include <stdio.h>
+
+// Number of frames written at once, a typical block size of an audio callback
+#define WRITE_FRAMES (256)
+
+// Number of frames read at once, the same as the live FFT thread
+#define READ_FRAMES (1024)
+
+// Number of samples the ring buffer holds, the size of the audio driver's default ring buffer
+#define RING_BUFFER_SAMPLES (READ_FRAMES * 8 * 4)
+
+// State shared by the writing and the reading thread.
+typedef struct
+{
+    PaUtilRingBuffer ring_buffer;
+    const float *samples;
+    int frames;
+    // Set once the writing thread has to stop
+    gint stop;
+} RingBench;
+
+// Write the next block of the signal, starting at frame `position`.
+static ring_buffer_size_t
+write_block(RingBench *bench, guint64 position, ring_buffer_size_t frames)
+{
+    int offset = position % bench->frames;
+
+    frames = MIN(frames, bench->frames - offset);
+    return PaUtil_WriteRingBuffer(&(bench->ring_buffer), bench->samples + (gsize)offset * BENCH_CHANNELS,
+                                  frames * BENCH_CHANNELS) /
+           BENCH_CHANNELS;
+}
+
+// Write the signal the way the audio callback does, waiting for room instead of dropping frames.
+static gpointer
+writer_thread(gpointer user_data)
+{
+    RingBench *bench = user_data;
+    guint64 written = 0;
+
+    while (!g_atomic_int_get(&(bench->stop)))
+    {
+        ring_buffer_size_t frames = PaUtil_GetRingBufferWriteAvailable(&(bench->ring_buffer)) / BENCH_CHANNELS;
+
+        frames = MIN(frames, WRITE_FRAMES);
+        if (frames == 0)
+        {
+            g_thread_yield();
+            continue;
+        }
+
+        written += write_block(bench, written, frames);
+    }
+
+    return NULL;
+}
+
+/**
+ * Pass the signal through the ring buffer from a writing to a reading thread.
+ *
+ * This includes the cost of the cache lines moving between the two cores, as in the application.
+ */
+static void
+bench_threaded(RingBench *bench)
+{
+    float *output = g_new(float, READ_FRAMES * BENCH_CHANNELS);
+    GThread *writer;
+    guint64 read = 0;
+    gint64 start, elapsed;
+
+    g_atomic_int_set(&(bench->stop), FALSE);
+
+    start = bench_now_ns();
+    writer = g_thread_new("bench-writer", writer_thread, bench);
+
+    while ((elapsed = bench_now_ns() - start) < BENCH_MIN_NS)
+    {
+        ring_buffer_size_t frames = PaUtil_GetRingBufferReadAvailable(&(bench->ring_buffer)) / BENCH_CHANNELS;
+
+        frames = MIN(frames, READ_FRAMES);
+        if (frames == 0)
+        {
+            g_thread_yield();
+            continue;
+        }
+
+        read += PaUtil_ReadRingBuffer(&(bench->ring_buffer), output, frames * BENCH_CHANNELS) / BENCH_CHANNELS;
+    }
+
+    g_atomic_int_set(&(bench->stop), TRUE);
+    g_thread_join(writer);
+
+    bench_report("ringbuffer", "threads=2", read, elapsed);
+    g_free(output);
+}
+
+// Write and read the signal from a single thread, only the copies in and out of the ring buffer are measured.
+static void
+bench_single_thread(RingBench *bench)
+{
+    float *output = g_new(float, READ_FRAMES * BENCH_CHANNELS);
+    guint64 read = 0, written = 0;
+    gint64 start, elapsed;
+
+    start = bench_now_ns();
+    do
+    {
+        for (int i = 0; i < READ_FRAMES / WRITE_FRAMES; i++)
+            written += write_block(bench, written, WRITE_FRAMES);
+
+        read += PaUtil_ReadRingBuffer(&(bench->ring_buffer), output,
+                                      PaUtil_GetRingBufferReadAvailable(&(bench->ring_buffer))) /
+                BENCH_CHANNELS;
+    } while ((elapsed = bench_now_ns() - start) < BENCH_MIN_NS);
+
+    bench_report("ringbuffer", "threads=1", read, elapsed);
+    g_free(output);
+}
+
+int main(int argc, char *argv[])
+{
+    RingBench bench;
+    float *data = g_new(float, RING_BUFFER_SAMPLES);
+
+    if (PaUtil_InitializeRingBuffer(&(bench.ring_buffer), sizeof(float), RING_BUFFER_SAMPLES, data) < 0)
+    {
+        fprintf(stderr, "ERROR: Could not initialize ring buffer!\n");
+        g_free(data);
+        return 1;
+    }
+
+    // The content doesn't change the cost of a copy, but keeps the pages of the signal from being shared zeros
+    bench.samples = bench_signal_new(BENCH_SIGNAL_NOISE, &bench.frames);
+
+    bench_single_thread(&bench);
+    PaUtil_FlushRingBuffer(&(bench.ring_buffer));
+    bench_threaded(&bench);
+
+    g_free((float *)bench.samples);
+    g_free(data);
+
+    return 0;
+}
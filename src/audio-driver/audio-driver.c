@@ -17,31 +17,289 @@
  */
 
 #include <audio-driver/audio-driver.h>
+#include <memory/allocation-guard.h>
+#include <probes/probes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Operations run by the driver thread
+typedef enum
+{
+    AUDIO_DRIVER_START,
+    AUDIO_DRIVER_SELECT_DEVICE,
+    AUDIO_DRIVER_RESIZE_RING_BUFFER,
+    AUDIO_DRIVER_REFRESH_DEVICES,
+} AudioDriverOperation;
+
+// Operation queued for the driver thread, along with what to call once it's done
+typedef struct
+{
+    AudioDriver *audio_driver;
+    AudioDriverOperation operation;
+    // Device index, ring buffer size or mask of sound cards, depending on the operation
+    gint64 value;
+    // 0 on success, -1 if the operation failed, or `AUDIO_DRIVER_STREAM_KEPT`
+    int result;
+    AudioDriverCallback callback;
+    void *user_data;
+    // Main context the callback is called in
+    GMainContext *context;
+} AudioDriverJob;
+
+// Number of samples held by a ring buffer of `blocks` blocks.
+static ring_buffer_size_t
+audio_driver_ring_buffer_samples(int blocks)
+{
+    return (ring_buffer_size_t)FRAMES_PER_BUFFER * MAX_CHANNELS * blocks;
+}
 
 /**
- * Create a new audio driver.
+ * (Re)allocate the audio ring buffer data for the current `ring_buffer_size`.
  *
- * This will initialize PortAudio, open a new input stream, setup the audio data ring buffer
- * and load the list of connected devices.
+ * @return 0 on success, -1 if the ring buffer couldn't be setup
  */
-AudioDriver *audio_driver_new(void)
+static int
+audio_driver_setup_ring_buffer(AudioDriver *audio_driver)
 {
-    AudioDriver *audio_driver;
+    ring_buffer_size_t samples;
+    MemoryArena memory;
+
+    samples = audio_driver_ring_buffer_samples(audio_driver->ring_buffer_size);
 
-    ring_buffer_size_t rb_size;
+    memory_arena_init(&memory);
+    memory_arena_carve_array(&memory, AudioData, samples);
+    if (!memory_arena_allocate(&memory))
+        return -1;
+
+    if (PaUtil_InitializeRingBuffer(&audio_driver->ring_buffer,
+                                    sizeof(AudioData),
+                                    samples,
+                                    memory_arena_carve_array(&memory, AudioData, samples)) < 0)
+    {
+        memory_arena_clear(&memory);
+        return -1;
+    }
+
+    memory_arena_clear(&audio_driver->ring_buffer_memory);
+    audio_driver->ring_buffer_memory = memory;
+
+    return 0;
+}
+
+static int
+input_stream_cb(const void *input_buffer,
+                void *output_buffer,
+                unsigned long frame_count,
+                const PaStreamCallbackTimeInfo *time_info,
+                PaStreamCallbackFlags status_flags,
+                void *user_data)
+{
+    AudioDriver *audio_driver = (AudioDriver *)user_data;
+    const float *input = (const float *)input_buffer;
+    const uint64_t event = 1;
+    ring_buffer_size_t frames;
+    gint64 start = probe_now(), now;
+    double input_latency;
+
+    // Nothing in here may allocate, the host calls it on its real-time audio thread
+    allocation_guard_enter();
+
+    if (status_flags & paInputOverflow)
+        __atomic_fetch_add(&audio_driver->stats.input_overflows, 1, __ATOMIC_RELAXED);
+
+    // Copy as many whole frames as fit, the block size can be anything the host likes
+    frames = PaUtil_GetRingBufferWriteAvailable(&audio_driver->ring_buffer) / audio_driver->channels;
+    if ((unsigned long)frames > frame_count)
+        frames = frame_count;
+
+    if ((unsigned long)frames < frame_count)
+        __atomic_fetch_add(&audio_driver->stats.dropped_frames, frame_count - frames, __ATOMIC_RELAXED);
+
+    if (frames == 0)
+    {
+        allocation_guard_leave();
+        return paContinue;
+    }
+
+    __atomic_fetch_add(&audio_driver->stats.captured_frames, frames, __ATOMIC_RELAXED);
+
+    PaUtil_WriteRingBuffer(&audio_driver->ring_buffer, input, frames * audio_driver->channels);
+
+    // Wake the reader up now that there is something new to read.
+    // Writing to a non-blocking eventfd never blocks, so this is safe to do from the audio thread.
+    if (write(audio_driver->wakeup_fd, &event, sizeof(event)) < 0)
+    {
+        // The counter can only overflow if the reader has stopped, in which case there is no one to wake up.
+    }
+
+    // The newest sample was captured this long ago, hosts that don't know leave the times at 0
+    input_latency = 0;
+    if (time_info->inputBufferAdcTime > 0 && time_info->currentTime > time_info->inputBufferAdcTime)
+        input_latency = time_info->currentTime - time_info->inputBufferAdcTime -
+                        (frame_count - 1) / audio_driver->selected_device->defaultSampleRate;
+
+    now = probe_now();
+    probes_set_audio_written(now, now - (gint64)(MAX(input_latency, 0) * 1e9));
+    probe_record(PROBE_RING_WRITE, now - start);
+
+    allocation_guard_leave();
+    return paContinue;
+}
+
+// Stop and close the input stream, if one is open.
+static void
+audio_driver_close_stream(AudioDriver *audio_driver)
+{
+    PaError err;
+
+    if (audio_driver->stream == NULL)
+        return;
+
+    err = Pa_StopStream(audio_driver->stream);
+    if (err != paNoError)
+        fprintf(stderr, "ERROR: Could not stop PortAudio input stream: %s\n", Pa_GetErrorText(err));
+
+    err = Pa_CloseStream(audio_driver->stream);
+    if (err != paNoError)
+        fprintf(stderr, "ERROR: Could not close PortAudio input stream: %s\n", Pa_GetErrorText(err));
+
+    audio_driver->stream = NULL;
+}
+
+/**
+ * Open and start the input stream on the selected device.
+ *
+ * @return 0 on success, -1 if the stream couldn't be opened or started
+ */
+static int
+audio_driver_open_stream(AudioDriver *audio_driver)
+{
+    PaStreamParameters input_parameters;
     PaError err;
 
-    audio_driver = (AudioDriver *)malloc(sizeof(AudioDriver));
+    if (audio_driver->stream != NULL)
+        audio_driver_close_stream(audio_driver); // Close the stream if one was open before
+
+    // Capture every channel the device has, up to the maximum the ring buffer can hold
+    audio_driver->channels = audio_driver->selected_device->maxInputChannels;
+    if (audio_driver->channels < 1)
+        audio_driver->channels = 1;
+    else if (audio_driver->channels > MAX_CHANNELS)
+        audio_driver->channels = MAX_CHANNELS;
+
+    input_parameters = (PaStreamParameters){
+        .channelCount = audio_driver->channels,
+        .device = audio_driver->selected_index,
+        .hostApiSpecificStreamInfo = NULL,
+        .sampleFormat = paFloat32,
+        .suggestedLatency = audio_driver->selected_device->defaultLowInputLatency};
+
+    err = Pa_OpenStream(&(audio_driver->stream),
+                        &input_parameters, NULL,
+                        audio_driver->selected_device->defaultSampleRate, paFramesPerBufferUnspecified,
+                        paNoFlag,
+                        input_stream_cb, audio_driver);
+
+    if (err != paNoError)
+    {
+        fprintf(stderr, "ERROR: Could not open PortAudio input stream: %s\n", Pa_GetErrorText(err));
+        audio_driver->stream = NULL;
+        return -1;
+    }
+
+    // Once the stream is opened, we can now start it
+    err = Pa_StartStream(audio_driver->stream);
+    if (err != paNoError)
+    {
+        fprintf(stderr, "ERROR: Could not start PortAudio input stream: %s\n", Pa_GetErrorText(err));
+        audio_driver_close_stream(audio_driver);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Change the capacity of the audio ring buffer, restarting the input stream if it was open.
+ *
+ * @note Must only be called from the driver thread.
+ * @return 0 on success, -1 if the ring buffer kept its old size or the stream couldn't be reopened
+ */
+static int
+audio_driver_resize_ring_buffer(AudioDriver *audio_driver, int blocks)
+{
+    int old_blocks;
+    int was_open;
+    int result = 0;
+
+    if (blocks <= 0 || blocks > MAX_RING_BUFFER_SIZE || (blocks & (blocks - 1)) != 0)
+    {
+        fprintf(stderr, "ERROR: Ring buffer size must be a power of 2 up to %d blocks!\n", MAX_RING_BUFFER_SIZE);
+        return -1;
+    }
+
+    if (blocks == audio_driver->ring_buffer_size)
+        return 0;
+
+    // The input callback must not be writing while the ring buffer is replaced
+    was_open = audio_driver->stream != NULL;
+    audio_driver_close_stream(audio_driver);
+
+    old_blocks = audio_driver->ring_buffer_size;
+    audio_driver->ring_buffer_size = blocks;
+
+    if (audio_driver_setup_ring_buffer(audio_driver) < 0)
+    {
+        fprintf(stderr, "ERROR: Could not resize ring buffer to %d blocks!\n", blocks);
+        audio_driver->ring_buffer_size = old_blocks;
+        PaUtil_FlushRingBuffer(&audio_driver->ring_buffer);
+        result = -1;
+    }
+    else
+        printf("Ring buffer resized to %d blocks\n", blocks);
+
+    if (was_open && audio_driver_open_stream(audio_driver) < 0)
+        result = -1;
+
+    return result;
+}
+
+static void
+audio_driver_unref(AudioDriver *audio_driver)
+{
+    if (!g_atomic_ref_count_dec(&audio_driver->ref_count))
+        return;
+
+    free(audio_driver->devices);
+    memory_arena_clear(&audio_driver->ring_buffer_memory);
+    if (audio_driver->wakeup_fd >= 0)
+        close(audio_driver->wakeup_fd);
+    free(audio_driver);
+}
+
+/**
+ * Initialize PortAudio and load the list of connected devices, selecting the first one.
+ *
+ * @note Must only be called from the driver thread.
+ * @return 0 on success, -1 if PortAudio couldn't be initialized or there are no devices
+ */
+static int
+audio_driver_initialize(AudioDriver *audio_driver)
+{
+    PaError err;
 
     // Initialize PortAudio
     err = Pa_Initialize();
     if (err != paNoError)
     {
         fprintf(stderr, "ERROR: Could not initialize PortAudio: %s\n", Pa_GetErrorText(err));
-        goto audio_driver_new_error;
+        return -1;
     }
+    audio_driver->initialized = TRUE;
     printf("PortAudio initialized!\n");
 
     // Get the list of connected devices
@@ -49,8 +307,9 @@ AudioDriver *audio_driver_new(void)
     if (audio_driver->num_devices <= 0)
     {
         err = audio_driver->num_devices;
+        audio_driver->num_devices = 0;
         fprintf(stderr, "ERROR: No devices connected: %s\n", Pa_GetErrorText(err));
-        goto audio_driver_new_error;
+        return -1;
     }
 
     audio_driver->devices = (PaDeviceInfo **)malloc(sizeof(PaDeviceInfo *) * audio_driver->num_devices);
@@ -60,134 +319,363 @@ AudioDriver *audio_driver_new(void)
         printf("%02d: %s\n", i, audio_driver->devices[i]->name);
     }
 
-    // Setup the ring buffer
-    audio_driver->audio_data = (AudioData *)malloc(AUDIO_FRAME_SIZE * RING_BUFFER_SIZE);
+    audio_driver->selected_device = audio_driver->devices[0];
+    audio_driver->selected_index = 0;
 
-    audio_driver->ring_buffer = (PaUtilRingBuffer *)malloc(sizeof(PaUtilRingBuffer));
-    rb_size = PaUtil_InitializeRingBuffer(audio_driver->ring_buffer,
-                                          AUDIO_FRAME_SIZE,
-                                          RING_BUFFER_SIZE,
-                                          audio_driver->audio_data);
+    return 0;
+}
 
-    if (rb_size < 0)
+/**
+ * Select a device to use for the input stream and open the stream on it.
+ *
+ * @note Must only be called from the driver thread.
+ */
+static int
+audio_driver_select_device(AudioDriver *audio_driver, PaDeviceIndex device_index)
+{
+    if (device_index < 0 || device_index >= audio_driver->num_devices)
     {
-        fprintf(stderr, "ERROR: Could not initialize ring buffer!\n");
-        goto audio_driver_new_error;
+        fprintf(stderr, "ERROR: Device index is out of range!\n");
+        return -1;
     }
 
-    audio_driver->stream = NULL;
-    audio_driver->selected_device = audio_driver->devices[0];
-    audio_driver->selected_index = 0;
+    audio_driver->selected_index = device_index;
+    audio_driver->selected_device = audio_driver->devices[device_index];
 
-    return audio_driver;
+    printf("Device changed to: %s\n", audio_driver->selected_device->name);
 
-audio_driver_new_error:
-    free(audio_driver->ring_buffer);
-    free(audio_driver->audio_data);
-    free(audio_driver->devices);
-    free(audio_driver);
-    return NULL;
+    // Close the currently open stream
+    audio_driver_close_stream(audio_driver);
+    // Open a new stream with the newly selected device
+    return audio_driver_open_stream(audio_driver);
 }
 
-void audio_driver_close(AudioDriver **audio_driver)
+// Get the type of the host API of a device. Unlike its index, the type stays the same when PortAudio is initialized again.
+static PaHostApiTypeId
+audio_driver_get_host_api_type(const PaDeviceInfo *device)
 {
-    PaError err;
+    const PaHostApiInfo *host_api = Pa_GetHostApiInfo(device->hostApi);
 
-    // Close the input stream
-    audio_driver_close_stream(*audio_driver);
+    return host_api != NULL ? host_api->type : paInDevelopment;
+}
+
+/**
+ * Get the ALSA card a device is on.
+ *
+ * @return the card number, or -1 for devices that aren't on a card of their own like "default" or the ones of JACK
+ */
+static int
+audio_driver_get_card(const PaDeviceInfo *device)
+{
+    const char *hw;
+    int card;
 
-    // Release allocated resources
-    free((*audio_driver)->devices);
-    free((*audio_driver)->audio_data);
-    free((*audio_driver)->ring_buffer);
-    free(*audio_driver);
+    if (audio_driver_get_host_api_type(device) != paALSA)
+        return -1;
 
-    *audio_driver = NULL;
+    // PortAudio names the hardware devices of ALSA after their card and device, like "USB Audio: - (hw:1,0)"
+    hw = strstr(device->name, "(hw:");
+    if (hw == NULL || sscanf(hw, "(hw:%d,", &card) != 1)
+        return -1;
 
-    err = Pa_Terminate();
-    if (err != paNoError)
-        fprintf(stderr, "ERROR: Could not initialize PortAudio: %s\n", Pa_GetErrorText(err));
+    return card;
 }
 
-void audio_driver_set_selected_device(AudioDriver *audio_driver, PaDeviceIndex device_index)
+/**
+ * Reload the list of connected devices, selecting `device` of the old list again if it's still there.
+ *
+ * PortAudio only sees devices that were plugged in after it was initialized once it's initialized again, which
+ * closes every stream. The stream is reopened on the device straight away, or on the default input device if
+ * it's gone. Devices are matched on their name and host API, as a card reachable through several host APIs shows
+ * up under the same name in each of them.
+ *
+ * @note Must only be called from the driver thread.
+ */
+static int
+audio_driver_reload_devices(AudioDriver *audio_driver, const PaDeviceInfo *device)
 {
-    if (device_index >= audio_driver->num_devices)
+    char *selected_name = NULL;
+    PaHostApiTypeId selected_host_api = paInDevelopment;
+    PaDeviceIndex device_index = paNoDevice;
+    PaError err;
+
+    if (device != NULL)
     {
-        fprintf(stderr, "ERROR: Device index is out of range!\n");
-        return;
+        selected_name = strdup(device->name);
+        selected_host_api = audio_driver_get_host_api_type(device);
     }
 
-    audio_driver->selected_index = device_index;
-    audio_driver->selected_device = audio_driver->devices[device_index];
+    // Every device info is freed by PortAudio once it's terminated
+    audio_driver_close_stream(audio_driver);
+    if (audio_driver->initialized)
+    {
+        err = Pa_Terminate();
+        if (err != paNoError)
+            fprintf(stderr, "ERROR: Could not terminate PortAudio: %s\n", Pa_GetErrorText(err));
+        audio_driver->initialized = FALSE;
+    }
 
-    printf("Device changed to: %s\n", audio_driver->selected_device->name);
+    free(audio_driver->devices);
+    audio_driver->devices = NULL;
+    audio_driver->num_devices = 0;
+    audio_driver->selected_device = NULL;
+    audio_driver->selected_index = paNoDevice;
+    audio_driver->devices_stale = FALSE;
 
-    // Close the currently open stream
-    audio_driver_close_stream(audio_driver);
-    // Open a new stream with the newly selected device
-    audio_driver_open_stream(audio_driver);
+    if (audio_driver_initialize(audio_driver) < 0)
+    {
+        free(selected_name);
+        return -1;
+    }
+
+    for (int i = 0; i < audio_driver->num_devices && selected_name != NULL; i++)
+    {
+        if (strcmp(audio_driver->devices[i]->name, selected_name) == 0 &&
+            audio_driver_get_host_api_type(audio_driver->devices[i]) == selected_host_api)
+        {
+            device_index = i;
+            break;
+        }
+    }
+
+    if (device_index == paNoDevice)
+    {
+        device_index = Pa_GetDefaultInputDevice();
+        if (device_index < 0 || device_index >= audio_driver->num_devices)
+            device_index = 0;
+
+        if (selected_name != NULL)
+            printf("Device %s was removed\n", selected_name);
+    }
+    free(selected_name);
+
+    return audio_driver_select_device(audio_driver, device_index);
 }
 
+/**
+ * Switch the input stream over to a device picked from the list, reloading the list first if it's out of date.
+ *
+ * @note Must only be called from the driver thread.
+ */
 static int
-input_stream_cb(const void *input_buffer,
-                void *output_buffer,
-                unsigned long frame_count,
-                const PaStreamCallbackTimeInfo *time_info,
-                PaStreamCallbackFlags status_flags,
-                void *user_data)
+audio_driver_pick_device(AudioDriver *audio_driver, PaDeviceIndex device_index)
 {
-    PaUtilRingBuffer *rb = (PaUtilRingBuffer *)user_data;
-    const float *input = (const float *)input_buffer;
+    // The stream is restarted anyway, so this is the time to catch up with the devices that came and went
+    if (audio_driver->devices_stale && device_index >= 0 && device_index < audio_driver->num_devices)
+        return audio_driver_reload_devices(audio_driver, audio_driver->devices[device_index]);
 
-    PaUtil_WriteRingBuffer(rb, input, 1);
+    return audio_driver_select_device(audio_driver, device_index);
+}
 
-    return 0;
+/**
+ * Catch up with the sound cards in `cards` being plugged in or out.
+ *
+ * The list is only reloaded when the input stream would be restarted anyway: when its device is on one of the
+ * cards, or when it isn't running. Otherwise it's kept running and the list is marked as out of date.
+ *
+ * @note Must only be called from the driver thread.
+ * @return 0 on success, -1 if the list couldn't be reloaded, or `AUDIO_DRIVER_STREAM_KEPT`
+ */
+static int
+audio_driver_devices_changed(AudioDriver *audio_driver, guint64 cards)
+{
+    int card;
+
+    if (audio_driver->stream != NULL && Pa_IsStreamActive(audio_driver->stream) == 1)
+    {
+        // A device that isn't on a card of its own goes through a server that follows the cards by itself
+        card = audio_driver_get_card(audio_driver->selected_device);
+        if (card < 0 || (cards & AUDIO_DRIVER_CARD_BIT(card)) == 0)
+        {
+            audio_driver->devices_stale = TRUE;
+            return AUDIO_DRIVER_STREAM_KEPT;
+        }
+    }
+
+    return audio_driver_reload_devices(audio_driver, audio_driver->selected_device);
 }
 
-void audio_driver_open_stream(AudioDriver *audio_driver)
+// Call the callback of a finished operation, unless the driver was closed since it was started.
+static gboolean
+audio_driver_job_done_cb(gpointer data)
 {
-    PaStreamParameters input_parameters;
-    PaError err;
+    AudioDriverJob *job = data;
 
-    if (audio_driver->stream != NULL)
-        audio_driver_close_stream(audio_driver); // Close the stream if one was open before
+    if (!job->audio_driver->closed && job->callback != NULL)
+        job->callback(job->audio_driver, job->result, job->user_data);
 
-    input_parameters = (PaStreamParameters){
-        .channelCount = 2,
-        .device = audio_driver->selected_index,
-        .hostApiSpecificStreamInfo = NULL,
-        .sampleFormat = paFloat32,
-        .suggestedLatency = audio_driver->selected_device->defaultLowInputLatency};
+    return G_SOURCE_REMOVE;
+}
 
-    err = Pa_OpenStream(&(audio_driver->stream),
-                        &input_parameters, NULL,
-                        audio_driver->selected_device->defaultSampleRate, FRAMES_PER_BUFFER,
-                        paNoFlag,
-                        input_stream_cb, audio_driver->ring_buffer);
+static void
+audio_driver_job_free(gpointer data)
+{
+    AudioDriverJob *job = data;
 
-    if (err != paNoError)
-        fprintf(stderr, "ERROR: Could not open PortAudio input stream: %s\n", Pa_GetErrorText(err));
+    audio_driver_unref(job->audio_driver);
+    g_main_context_unref(job->context);
+    g_free(job);
+}
 
-    // Once the stream is opened, we can not start it
-    err = Pa_StartStream(audio_driver->stream);
-    if (err != paNoError)
-        fprintf(stderr, "ERROR: Could not start PortAudio input stream: %s\n", Pa_GetErrorText(err));
+// Run an operation on the driver thread, then hand it back to the main context it came from.
+static void
+audio_driver_thread_func(gpointer data, gpointer user_data)
+{
+    AudioDriverJob *job = data;
+    AudioDriver *audio_driver = job->audio_driver;
+
+    switch (job->operation)
+    {
+    case AUDIO_DRIVER_START:
+        job->result = audio_driver_initialize(audio_driver);
+        if (job->result == 0)
+            job->result = audio_driver_open_stream(audio_driver);
+        break;
+    case AUDIO_DRIVER_SELECT_DEVICE:
+        job->result = audio_driver_pick_device(audio_driver, job->value);
+        break;
+    case AUDIO_DRIVER_RESIZE_RING_BUFFER:
+        job->result = audio_driver_resize_ring_buffer(audio_driver, job->value);
+        break;
+    case AUDIO_DRIVER_REFRESH_DEVICES:
+        job->result = audio_driver_devices_changed(audio_driver, job->value);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+    g_main_context_invoke_full(job->context, G_PRIORITY_DEFAULT, audio_driver_job_done_cb, job, audio_driver_job_free);
 }
 
-void audio_driver_close_stream(AudioDriver *audio_driver)
+// Queue an operation for the driver thread.
+static void
+audio_driver_push_job(AudioDriver *audio_driver,
+                      AudioDriverOperation operation,
+                      gint64 value,
+                      AudioDriverCallback callback,
+                      void *user_data)
 {
-    PaError err;
+    AudioDriverJob *job;
+
+    job = g_new0(AudioDriverJob, 1);
+    job->audio_driver = audio_driver;
+    job->operation = operation;
+    job->value = value;
+    job->callback = callback;
+    job->user_data = user_data;
+    job->context = g_main_context_ref_thread_default();
+
+    g_atomic_ref_count_inc(&audio_driver->ref_count);
+    g_thread_pool_push(audio_driver->thread, job, NULL);
+}
 
-    if (audio_driver->stream == NULL)
-        return;
+AudioDriver *audio_driver_new(void)
+{
+    AudioDriver *audio_driver;
+    GError *error = NULL;
 
-    err = Pa_StopStream(audio_driver->stream);
-    if (err != paNoError)
-        fprintf(stderr, "ERROR: Could not stop PortAudio input stream: %s\n", Pa_GetErrorText(err));
+    audio_driver = (AudioDriver *)calloc(1, sizeof(AudioDriver));
+    audio_driver->wakeup_fd = -1;
+    g_atomic_ref_count_init(&audio_driver->ref_count);
 
-    err = Pa_CloseStream(audio_driver->stream);
-    if (err != paNoError)
-        fprintf(stderr, "ERROR: Could not close PortAudio input stream: %s\n", Pa_GetErrorText(err));
+    // Setup the ring buffer
+    memory_arena_init(&audio_driver->ring_buffer_memory);
+    audio_driver->ring_buffer_size = RING_BUFFER_SIZE;
+
+    if (audio_driver_setup_ring_buffer(audio_driver) < 0)
+    {
+        fprintf(stderr, "ERROR: Could not initialize ring buffer!\n");
+        goto audio_driver_new_error;
+    }
+
+    // Setup the wakeup event for the consumer of the ring buffer.
+    // It is non-blocking so the input callback can never stall on it.
+    audio_driver->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (audio_driver->wakeup_fd < 0)
+    {
+        perror("ERROR: Could not create ring buffer wakeup event");
+        goto audio_driver_new_error;
+    }
+
+    // A single exclusive thread, so the operations run in order and PortAudio is always called from the same thread
+    audio_driver->thread = g_thread_pool_new_full(audio_driver_thread_func, NULL, audio_driver_job_free,
+                                                  1, TRUE, &error);
+    if (audio_driver->thread == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not start the audio driver thread: %s\n", error->message);
+        g_error_free(error);
+        goto audio_driver_new_error;
+    }
 
     audio_driver->stream = NULL;
-}
\ No newline at end of file
+    audio_driver->selected_device = NULL;
+    audio_driver->selected_index = paNoDevice;
+    audio_driver->channels = 1;
+
+    return audio_driver;
+
+audio_driver_new_error:
+    audio_driver_unref(audio_driver);
+    return NULL;
+}
+
+void audio_driver_close(AudioDriver **audio_driver)
+{
+    AudioDriver *driver = *audio_driver;
+    PaError err;
+
+    // Let the running operation finish and drop the ones still queued
+    driver->closed = TRUE;
+    g_thread_pool_free(driver->thread, TRUE, TRUE);
+
+    // Close the input stream
+    audio_driver_close_stream(driver);
+
+    if (driver->initialized)
+    {
+        err = Pa_Terminate();
+        if (err != paNoError)
+            fprintf(stderr, "ERROR: Could not terminate PortAudio: %s\n", Pa_GetErrorText(err));
+    }
+
+    // Release allocated resources once no callback is pending any more
+    audio_driver_unref(driver);
+
+    *audio_driver = NULL;
+}
+
+void audio_driver_start(AudioDriver *audio_driver, AudioDriverCallback callback, void *user_data)
+{
+    audio_driver_push_job(audio_driver, AUDIO_DRIVER_START, 0, callback, user_data);
+}
+
+void audio_driver_set_selected_device(AudioDriver *audio_driver,
+                                      PaDeviceIndex device_index,
+                                      AudioDriverCallback callback,
+                                      void *user_data)
+{
+    audio_driver_push_job(audio_driver, AUDIO_DRIVER_SELECT_DEVICE, device_index, callback, user_data);
+}
+
+void audio_driver_set_ring_buffer_size(AudioDriver *audio_driver,
+                                       int blocks,
+                                       AudioDriverCallback callback,
+                                       void *user_data)
+{
+    audio_driver_push_job(audio_driver, AUDIO_DRIVER_RESIZE_RING_BUFFER, blocks, callback, user_data);
+}
+
+void audio_driver_refresh_devices(AudioDriver *audio_driver,
+                                  guint64 cards,
+                                  AudioDriverCallback callback,
+                                  void *user_data)
+{
+    audio_driver_push_job(audio_driver, AUDIO_DRIVER_REFRESH_DEVICES, cards, callback, user_data);
+}
+
+void audio_driver_get_stats(AudioDriver *audio_driver, AudioDriverStats *stats)
+{
+    stats->captured_frames = __atomic_load_n(&audio_driver->stats.captured_frames, __ATOMIC_RELAXED);
+    stats->dropped_frames = __atomic_load_n(&audio_driver->stats.dropped_frames, __ATOMIC_RELAXED);
+    stats->input_overflows = __atomic_load_n(&audio_driver->stats.input_overflows, __ATOMIC_RELAXED);
+}
@@ -19,20 +19,55 @@
 #ifndef AUDIO_DRIVER_H
 #define AUDIO_DRIVER_H
 
+#include <glib.h>
+#include <memory/memory-arena.h>
 #include <portaudio-common/pa_ringbuffer.h>
 #include <portaudio.h>
 
+// Number of frames read from the audio ring buffer at once. The stream itself delivers whatever block size the host prefers.
 #define FRAMES_PER_BUFFER (1024)
-#define CHANNELS (2)
+
+// Maximum number of input channels captured from a device
+#define MAX_CHANNELS (8)
 
 typedef float AudioData;
 
-// Size of input audio frame
-#define AUDIO_FRAME_SIZE (sizeof(AudioData) * FRAMES_PER_BUFFER * CHANNELS)
+// Size of a block of audio frames read at once, large enough to hold the maximum number of channels
+#define AUDIO_FRAME_SIZE (sizeof(AudioData) * FRAMES_PER_BUFFER * MAX_CHANNELS)
 
+// Default number of blocks the audio ring buffer can hold, this must be a power of 2
 #define RING_BUFFER_SIZE (4)
 
-// Audio driver struct: used for handling sound input with PortAudio.
+// Largest number of blocks the audio ring buffer may grow to
+#define MAX_RING_BUFFER_SIZE (64)
+
+// Sample rate reported until a device has been opened
+#define DEFAULT_SAMPLE_RATE (48000)
+
+// Bit of an ALSA card in a mask of sound cards, the cards from 63 on share the last bit
+#define AUDIO_DRIVER_CARD_BIT(card) ((guint64)1 << MIN((card), 63))
+
+// Result of refreshing the devices when the input stream was left running, see `audio_driver_refresh_devices`
+#define AUDIO_DRIVER_STREAM_KEPT (1)
+
+// Audio driver counters, all of them only ever increase while the driver is open.
+typedef struct _AudioDriverStats
+{
+    // Number of frames written to the ring buffer
+    unsigned long captured_frames;
+    // Number of frames lost because the ring buffer was full
+    unsigned long dropped_frames;
+    // Number of callbacks where PortAudio reported an input overflow
+    unsigned long input_overflows;
+} AudioDriverStats;
+
+/**
+ * Audio driver struct: used for handling sound input with PortAudio.
+ *
+ * Every PortAudio call is made on a thread of the driver, so initializing it or opening a stream never
+ * blocks the caller. The device list, selected device, channels and ring buffer size are changed by that
+ * thread, they must only be read from the callback of an operation or while none is running.
+ */
 typedef struct _AudioDriver
 {
     // List of connected devices
@@ -43,27 +78,100 @@ typedef struct _AudioDriver
     PaDeviceInfo *selected_device;
     // Index number of selected device
     PaDeviceIndex selected_index;
+    // Whether devices were plugged in or out since the list was loaded, it's reloaded once the stream has to move
+    int devices_stale;
     // Input stream
     PaStream *stream;
-    // Audio data array for ring buffer
-    AudioData *audio_data;
-    // Ring buffer for audio data
-    PaUtilRingBuffer *ring_buffer;
+    // Number of interleaved channels captured by the input stream
+    int channels;
+    // Memory of the ring buffer, a cache line aligned array of samples
+    MemoryArena ring_buffer_memory;
+    // Ring buffer for audio data. Each element is a single sample, frames are always written and read whole.
+    PaUtilRingBuffer ring_buffer;
+    // Capacity of the ring buffer in blocks of `FRAMES_PER_BUFFER` frames of `MAX_CHANNELS` samples
+    int ring_buffer_size;
+    // Counters updated atomically by the input callback
+    AudioDriverStats stats;
+    // Event file descriptor signalled by the input callback whenever new data is written to the ring buffer
+    int wakeup_fd;
+    // Thread running the operations one after the other, in the order they were started
+    GThreadPool *thread;
+    // Whether PortAudio was initialized by the driver thread
+    int initialized;
+    // Set once the driver is closed, the callbacks of operations still in flight are dropped
+    int closed;
+    // Held by the driver and by every operation in flight
+    gatomicrefcount ref_count;
 } AudioDriver;
 
-// Create a new audio driver and initialize it.
+/**
+ * Called once an operation of the driver thread is done, in the main context it was started from.
+ *
+ * @param `result` 0 on success, -1 if the operation failed, or `AUDIO_DRIVER_STREAM_KEPT` when refreshing the devices
+ * left the input stream as it was
+ */
+typedef void (*AudioDriverCallback)(AudioDriver *audio_driver, int result, void *user_data);
+
+/**
+ * Create a new audio driver.
+ *
+ * Only the ring buffer and its wakeup event are setup, PortAudio isn't touched until `audio_driver_start`.
+ */
 AudioDriver *audio_driver_new(void);
 
-// Close the audio driver.
+/**
+ * Close the audio driver.
+ *
+ * Waits for the running operation to finish, operations that haven't started yet are dropped and none
+ * of the callbacks still pending are called.
+ */
 void audio_driver_close(AudioDriver **audio_driver);
 
-// Select a device to use for the input stream.
-void audio_driver_set_selected_device(AudioDriver *audio_driver, PaDeviceIndex device);
+/**
+ * Initialize PortAudio, load the list of connected devices and open the input stream on the first one,
+ * in the background.
+ */
+void audio_driver_start(AudioDriver *audio_driver, AudioDriverCallback callback, void *user_data);
 
-// Opens the input stream for the audio driver.
-void audio_driver_open_stream(AudioDriver *audio_driver);
+/**
+ * Select a device to use for the input stream and reopen the stream on it, in the background.
+ *
+ * If devices were plugged in or out since the list was loaded it's reloaded first, and the stream is opened on the
+ * same device in the new list, or on the default input device if it's gone.
+ */
+void audio_driver_set_selected_device(AudioDriver *audio_driver,
+                                      PaDeviceIndex device,
+                                      AudioDriverCallback callback,
+                                      void *user_data);
+
+/**
+ * Change the capacity of the audio ring buffer in the background, restarting the input stream if it was open.
+ *
+ * The ring buffer pointer stays the same, but nothing may read from it until the callback is called.
+ *
+ * @param `blocks` new capacity in blocks, must be a power of 2 no larger than `MAX_RING_BUFFER_SIZE`
+ */
+void audio_driver_set_ring_buffer_size(AudioDriver *audio_driver,
+                                       int blocks,
+                                       AudioDriverCallback callback,
+                                       void *user_data);
+
+/**
+ * Reload the list of connected devices in the background, after a device was plugged in or out.
+ *
+ * PortAudio has to be initialized again to see new devices, which restarts the input stream. So while the stream
+ * runs on a device that isn't on one of the `cards` it's left alone, and the callback gets `AUDIO_DRIVER_STREAM_KEPT`:
+ * the list keeps the devices it had until the stream is moved to another one. Otherwise the list is reloaded and the
+ * stream reopened on the selected device if it's still connected, or on the default input device.
+ *
+ * @param `cards` mask of the ALSA cards that were plugged in or out, see `AUDIO_DRIVER_CARD_BIT`
+ */
+void audio_driver_refresh_devices(AudioDriver *audio_driver,
+                                  guint64 cards,
+                                  AudioDriverCallback callback,
+                                  void *user_data);
 
-// Close the input stream for the audio driver.
-void audio_driver_close_stream(AudioDriver *audio_driver);
+// Get a snapshot of the audio driver counters.
+void audio_driver_get_stats(AudioDriver *audio_driver, AudioDriverStats *stats);
 
 #endif // AUDIO_DRIVER_H
\ No newline at end of file
@@ -0,0 +1,272 @@
+/* device-monitor.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <audio-driver/audio-driver.h>
+#include <audio-driver/device-monitor.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static gboolean
+device_monitor_timeout_cb(gpointer user_data)
+{
+    DeviceMonitor *device_monitor = user_data;
+    guint64 cards = device_monitor->cards;
+
+    device_monitor->timeout_id = 0;
+    device_monitor->cards = 0;
+    device_monitor->callback(cards, device_monitor->user_data);
+
+    return G_SOURCE_REMOVE;
+}
+
+// Report a change of `cards` once the burst of changes of the card has settled.
+static void
+device_monitor_report(DeviceMonitor *device_monitor, guint64 cards)
+{
+    device_monitor->cards |= cards;
+
+    g_clear_handle_id(&(device_monitor->timeout_id), g_source_remove);
+    device_monitor->timeout_id = g_timeout_add(DEVICE_MONITOR_DELAY, device_monitor_timeout_cb, device_monitor);
+}
+
+// Report a node being created or removed.
+static void
+device_monitor_changed_cb(GFileMonitor *monitor,
+                          GFile *file,
+                          GFile *other_file,
+                          GFileMonitorEvent event_type,
+                          gpointer user_data)
+{
+    DeviceMonitor *device_monitor = user_data;
+    char *name;
+    unsigned int card;
+
+    if (event_type != G_FILE_MONITOR_EVENT_CREATED && event_type != G_FILE_MONITOR_EVENT_DELETED)
+        return;
+
+    // Only the nodes of a card carry its number, like controlC0 or pcmC1D0c, the sequencer and timer are shared
+    name = g_file_get_basename(file);
+    if (sscanf(name, "%*[a-z]C%u", &card) == 1)
+        device_monitor_report(device_monitor, AUDIO_DRIVER_CARD_BIT(card));
+    g_free(name);
+}
+
+// Watch the ALSA device nodes instead of the sound server, nothing is watched if they aren't accessible.
+static void
+device_monitor_watch_nodes(DeviceMonitor *device_monitor)
+{
+    GFile *directory;
+    GError *error = NULL;
+
+    // A missing directory would be watched without complaint and never change, as in a sandbox without device access
+    if (!g_file_test(DEVICE_MONITOR_PATH, G_FILE_TEST_IS_DIR))
+        return;
+
+    directory = g_file_new_for_path(DEVICE_MONITOR_PATH);
+    device_monitor->monitor = g_file_monitor_directory(directory, G_FILE_MONITOR_NONE, NULL, &error);
+    g_object_unref(directory);
+
+    if (device_monitor->monitor == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not watch %s for new devices: %s\n", DEVICE_MONITOR_PATH, error->message);
+        g_error_free(error);
+        return;
+    }
+
+    g_signal_connect(device_monitor->monitor, "changed", G_CALLBACK(device_monitor_changed_cb), device_monitor);
+}
+
+// Drop an operation of the sound server, its callback is still called once it's done.
+static void
+device_monitor_forget(pa_operation *operation)
+{
+    if (operation != NULL)
+        pa_operation_unref(operation);
+}
+
+/**
+ * Remember which ALSA card a card of the sound server is.
+ *
+ * @return the bit of the ALSA card, or 0 if it isn't one
+ */
+static guint64
+device_monitor_add_card(DeviceMonitor *device_monitor, const pa_card_info *info)
+{
+    const char *alsa_card = pa_proplist_gets(info->proplist, "alsa.card");
+    unsigned int card;
+
+    if (alsa_card == NULL || sscanf(alsa_card, "%u", &card) != 1)
+        return 0;
+
+    g_hash_table_insert(device_monitor->alsa_cards, GUINT_TO_POINTER(info->index), GUINT_TO_POINTER(card));
+
+    return AUDIO_DRIVER_CARD_BIT(card);
+}
+
+// Remember the cards that were already there when the connection was made.
+static void
+device_monitor_card_listed_cb(pa_context *context, const pa_card_info *info, int eol, void *user_data)
+{
+    if (eol == 0)
+        device_monitor_add_card(user_data, info);
+}
+
+// Report a card that was just plugged in, along with the ALSA card it is.
+static void
+device_monitor_card_added_cb(pa_context *context, const pa_card_info *info, int eol, void *user_data)
+{
+    if (eol == 0)
+        device_monitor_report(user_data, device_monitor_add_card(user_data, info));
+}
+
+static void
+device_monitor_subscribe_cb(pa_context *context, pa_subscription_event_type_t event, uint32_t index, void *user_data)
+{
+    DeviceMonitor *device_monitor = user_data;
+    gpointer card;
+    guint64 cards = 0;
+
+    if ((event & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) != PA_SUBSCRIPTION_EVENT_CARD)
+        return;
+
+    if ((event & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_NEW)
+    {
+        // The ALSA card of a new card is only known once the server has told what it is
+        device_monitor_forget(pa_context_get_card_info_by_index(context, index, device_monitor_card_added_cb,
+                                                                device_monitor));
+    }
+    else if ((event & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
+    {
+        // A removed card can't be asked about any more, it was remembered when it showed up
+        if (g_hash_table_lookup_extended(device_monitor->alsa_cards, GUINT_TO_POINTER(index), NULL, &card))
+        {
+            cards = AUDIO_DRIVER_CARD_BIT(GPOINTER_TO_UINT(card));
+            g_hash_table_remove(device_monitor->alsa_cards, GUINT_TO_POINTER(index));
+        }
+
+        device_monitor_report(device_monitor, cards);
+    }
+}
+
+// Close the connection to the sound server, none of its callbacks is called after this.
+static void
+device_monitor_disconnect(DeviceMonitor *device_monitor)
+{
+    pa_context_set_state_callback(device_monitor->context, NULL, NULL);
+    pa_context_set_subscribe_callback(device_monitor->context, NULL, NULL);
+    pa_context_disconnect(device_monitor->context);
+    pa_context_unref(device_monitor->context);
+    device_monitor->context = NULL;
+
+    g_hash_table_remove_all(device_monitor->alsa_cards);
+}
+
+static void
+device_monitor_state_cb(pa_context *context, void *user_data)
+{
+    DeviceMonitor *device_monitor = user_data;
+
+    switch (pa_context_get_state(context))
+    {
+    case PA_CONTEXT_READY:
+        pa_context_set_subscribe_callback(context, device_monitor_subscribe_cb, device_monitor);
+        device_monitor_forget(pa_context_subscribe(context, PA_SUBSCRIPTION_MASK_CARD, NULL, NULL));
+        device_monitor_forget(pa_context_get_card_info_list(context, device_monitor_card_listed_cb, device_monitor));
+        break;
+    case PA_CONTEXT_FAILED:
+    case PA_CONTEXT_TERMINATED:
+        // There is no sound server, or it went away
+        device_monitor_disconnect(device_monitor);
+        device_monitor_watch_nodes(device_monitor);
+        break;
+    case PA_CONTEXT_UNCONNECTED:
+    case PA_CONTEXT_CONNECTING:
+    case PA_CONTEXT_AUTHORIZING:
+    case PA_CONTEXT_SETTING_NAME:
+    default:
+        break;
+    }
+}
+
+/**
+ * Start connecting to the sound server, the cards are listed once the connection is ready.
+ *
+ * @return 0 on success, -1 if the server can't be reached
+ */
+static int
+device_monitor_connect(DeviceMonitor *device_monitor)
+{
+    device_monitor->mainloop = pa_glib_mainloop_new(NULL);
+    device_monitor->context = pa_context_new(pa_glib_mainloop_get_api(device_monitor->mainloop), "Audiolize");
+    if (device_monitor->context == NULL)
+        return -1;
+
+    pa_context_set_state_callback(device_monitor->context, device_monitor_state_cb, device_monitor);
+
+    // Starting a server only to watch it would be pointless, PortAudio would start its own anyway
+    if (pa_context_connect(device_monitor->context, NULL, PA_CONTEXT_NOAUTOSPAWN, NULL) < 0)
+    {
+        device_monitor_disconnect(device_monitor);
+        return -1;
+    }
+
+    return 0;
+}
+
+DeviceMonitor *device_monitor_new(DeviceMonitorCallback callback, void *user_data)
+{
+    DeviceMonitor *device_monitor;
+
+    device_monitor = (DeviceMonitor *)calloc(1, sizeof(DeviceMonitor));
+    device_monitor->callback = callback;
+    device_monitor->user_data = user_data;
+    device_monitor->alsa_cards = g_hash_table_new(NULL, NULL);
+
+    if (device_monitor_connect(device_monitor) < 0)
+        device_monitor_watch_nodes(device_monitor);
+
+    if (device_monitor->context == NULL && device_monitor->monitor == NULL)
+    {
+        device_monitor_free(&device_monitor);
+        return NULL;
+    }
+
+    return device_monitor;
+}
+
+void device_monitor_free(DeviceMonitor **device_monitor)
+{
+    g_clear_handle_id(&((*device_monitor)->timeout_id), g_source_remove);
+
+    if ((*device_monitor)->context != NULL)
+        device_monitor_disconnect(*device_monitor);
+    if ((*device_monitor)->mainloop != NULL)
+        pa_glib_mainloop_free((*device_monitor)->mainloop);
+
+    if ((*device_monitor)->monitor != NULL)
+    {
+        g_file_monitor_cancel((*device_monitor)->monitor);
+        g_signal_handlers_disconnect_by_data((*device_monitor)->monitor, *device_monitor);
+        g_object_unref((*device_monitor)->monitor);
+    }
+
+    g_hash_table_destroy((*device_monitor)->alsa_cards);
+    free(*device_monitor);
+
+    *device_monitor = NULL;
+}
@@ -0,0 +1,74 @@
+/* device-monitor.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEVICE_MONITOR_H
+#define DEVICE_MONITOR_H
+
+#include <gio/gio.h>
+#include <pulse/glib-mainloop.h>
+#include <pulse/pulseaudio.h>
+
+// Directory of the ALSA device nodes, watched when the sound server can't be reached. A node is created or removed
+// there whenever a sound card is plugged in or out.
+#define DEVICE_MONITOR_PATH "/dev/snd"
+
+// Time to wait after the last change before reporting it in milliseconds. A card adds or removes several nodes at
+// once, and the sound server needs a moment to pick it up before PortAudio can see it.
+#define DEVICE_MONITOR_DELAY (1000)
+
+/**
+ * Called in the main context once the connected sound devices have changed.
+ *
+ * @param `cards` mask of the ALSA cards that were plugged in or out, see `AUDIO_DRIVER_CARD_BIT`. It's empty when
+ * only cards of the sound server that aren't ALSA cards changed, like Bluetooth headsets.
+ */
+typedef void (*DeviceMonitorCallback)(guint64 cards, void *user_data);
+
+// Device monitor struct: watches for sound devices being plugged in or out.
+typedef struct _DeviceMonitor
+{
+    // Main loop of the connection to the sound server
+    pa_glib_mainloop *mainloop;
+    // Connection to the sound server, NULL once it failed and the device nodes are watched instead
+    pa_context *context;
+    // ALSA card number of every card of the sound server, by the index the server gave the card
+    GHashTable *alsa_cards;
+    // Monitor of `DEVICE_MONITOR_PATH`, NULL while the sound server is used or if the directory isn't there
+    GFileMonitor *monitor;
+    // Source ID of the timeout reporting the changes, 0 when nothing changed since the last report
+    guint timeout_id;
+    // Cards that changed since the last report
+    guint64 cards;
+    DeviceMonitorCallback callback;
+    void *user_data;
+} DeviceMonitor;
+
+/**
+ * Start watching for sound devices being plugged in or out.
+ *
+ * The cards are followed through the sound server, PulseAudio or PipeWire, which is also reachable from a sandbox.
+ * Without one the ALSA device nodes are watched, and if they aren't accessible either nothing is reported.
+ *
+ * @return the monitor, or NULL if the devices can't be watched on this system
+ */
+DeviceMonitor *device_monitor_new(DeviceMonitorCallback callback, void *user_data);
+
+// Stop watching the sound devices, no callback is called after this.
+void device_monitor_free(DeviceMonitor **device_monitor);
+
+#endif // DEVICE_MONITOR_H
@@ -21,14 +21,165 @@
 
 #include "audiolize-application.h"
 #include "audiolize-window.h"
+#include "audiolize-spectrum-player.h"
+#include "audiolize-spectrum-receiver.h"
+#include "audiolize-preferences-dialog.h"
+#include <audio-driver/device-monitor.h>
+#include <offline/offline-analysis.h>
+#include <probes/probes.h>
+#include <string.h>
 
+// Interval at which the audio and FFT counters are checked, in seconds
+#define STATS_INTERVAL (1)
+
+// Number of consecutive intervals with dropped capture frames before the ring buffer is grown
+#define RING_BUFFER_GROW_STREAK (3)
+
+// Interval at which the timing probes are dumped with `--dump-probes`, in seconds
+#define PROBES_DUMP_INTERVAL (5)
+
+/**
+ * The application owns the audio input and its analysis, every window is only a view of the FFT output.
+ * This way opening more windows doesn't open more streams or start more FFT threads.
+ *
+ * When playing a spectrum file back there is no audio input or analysis at all, the windows show the player instead.
+ * The same goes for showing the bands another instance streams, the windows then show the receiver.
+ */
 struct _AudiolizeApplication
 {
 	AdwApplication parent_instance;
+
+	// Audio driver used to handle input
+	AudioDriver *audio_driver;
+	// Names of the input devices, empty until the audio driver has loaded them
+	GtkStringList *devices;
+	// Index of the selected input device
+	guint device;
+	// Set while `devices` is updated, the drop downs moving their selection along then don't switch devices
+	gboolean updating_devices;
+	// Watches for input devices being plugged in or out, NULL if they can't be watched
+	DeviceMonitor *device_monitor;
+	// Number of audio driver operations running, the FFT thread is paused until they're all done
+	int driver_operations;
+
+	// FFT struct to handle Fourier Transform
+	AudiolizeFFT *fft;
+
+	// Player of the spectrum file given with `--play`, replaces the audio input and FFT
+	AudiolizeSpectrumPlayer *player;
+	// Recording given with `--media`, played along with `player`
+	gchar *media_path;
+	GtkMediaStream *media;
+
+	// Receiver of the bands streamed to the address given with `--receive`, replaces the audio input and FFT
+	AudiolizeSpectrumReceiver *receiver;
+	// Sender streaming the analysis to the displays given with `--stream`, handed over to the FFT at startup
+	BandStreamSender *sender;
+
+	// Source ID of the counter checking timeout
+	guint stats_timeout_id;
+	// Counters from the last check, used to work out what changed since
+	AudioDriverStats driver_stats;
+	AudiolizeFFTStats fft_stats;
+	// Number of consecutive checks that found dropped capture frames
+	int drop_streak;
+
+	// Whether the timing probes are dumped to the standard error, and how
+	gboolean dump_probes;
+	ProbeDumpFormat probe_dump_format;
+	// Source ID of the timeout dumping the probes
+	guint probe_dump_id;
+	// Histograms of the last dump, `PROBE_COUNT` of them, taken at `probe_dump_time`
+	ProbeHistogram *probe_dump_histograms;
+	gint64 probe_dump_time;
+
+	// Settings of the application, NULL when the schema isn't installed and the preferences aren't kept
+	GSettings *settings;
+	// Whether the FFT thread runs with real-time priority
+	gboolean realtime_priority;
+	// CPUs the FFT thread is restricted to, empty for every CPU
+	gchar *cpu_affinity;
 };
 
 G_DEFINE_FINAL_TYPE(AudiolizeApplication, audiolize_application, ADW_TYPE_APPLICATION)
 
+enum
+{
+	PROP_0,
+	PROP_DEVICE,
+	PROP_REALTIME_PRIORITY,
+	PROP_CPU_AFFINITY,
+	N_PROPS,
+};
+
+static GParamSpec *properties[N_PROPS];
+
+// Names of the channel modes, as used by the channel-mode action and the command line.
+static const char *const channel_mode_names[] = {
+	[ANALYSIS_CHANNELS_MONO] = "mono",
+	[ANALYSIS_CHANNELS_SEPARATE] = "separate",
+	[ANALYSIS_CHANNELS_MID_SIDE] = "mid-side",
+};
+
+// Names of the presets, as used by the preset action and the command line.
+static const char *const preset_names[] = {
+	[ANALYSIS_PRESET_LOW_LATENCY] = "low-latency",
+	[ANALYSIS_PRESET_BALANCED] = "balanced",
+	[ANALYSIS_PRESET_HIGH_RESOLUTION] = "high-resolution",
+	[ANALYSIS_PRESET_MULTI_RESOLUTION] = "multi-resolution",
+};
+
+// Names of the quantizations, as used by the command line.
+static const char *const quantization_names[] = {
+	[SPECTRUM_FILE_FORMAT_FLOAT32] = "float",
+	[SPECTRUM_FILE_FORMAT_U16] = "u16",
+	[SPECTRUM_FILE_FORMAT_U8] = "u8",
+};
+
+// Names of the band layouts, as used by the band-layout action and the command line.
+static const char *const band_layout_names[] = {
+	[BAND_LAYOUT_CLASSIC] = "classic",
+	[BAND_LAYOUT_LINEAR] = "linear",
+	[BAND_LAYOUT_LOG] = "log",
+	[BAND_LAYOUT_MEL] = "mel",
+	[BAND_LAYOUT_THIRD_OCTAVE] = "third-octave",
+};
+
+// Names of the frequency weightings, as used by the weighting action and the command line.
+static const char *const weighting_names[] = {
+	[BAND_WEIGHTING_NONE] = "none",
+	[BAND_WEIGHTING_A] = "a",
+	[BAND_WEIGHTING_C] = "c",
+};
+
+// Names of the window functions, as used by the window-function action and the command line.
+static const char *const window_function_names[] = {
+	[WINDOW_FUNCTION_RECTANGULAR] = "rectangular",
+	[WINDOW_FUNCTION_HANN] = "hann",
+	[WINDOW_FUNCTION_BLACKMAN_HARRIS] = "blackman-harris",
+	[WINDOW_FUNCTION_KAISER] = "kaiser",
+	[WINDOW_FUNCTION_FLAT_TOP] = "flat-top",
+};
+
+/**
+ * Look a name up in one of the name tables.
+ *
+ * @return the index of `name` in `names`, or -1 if it isn't there
+ */
+static int
+audiolize_application_parse_name(const char *const *names, int count, const char *name)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (g_str_equal(names[i], name))
+			return i;
+	}
+
+	return -1;
+}
+
+#define PARSE_NAME(names, name) audiolize_application_parse_name((names), G_N_ELEMENTS(names), (name))
+
 AudiolizeApplication *
 audiolize_application_new(const char *application_id,
 						  GApplicationFlags flags)
@@ -42,6 +193,410 @@ audiolize_application_new(const char *application_id,
 						NULL);
 }
 
+GListModel *audiolize_application_get_devices(AudiolizeApplication *self)
+{
+	return self->devices != NULL ? G_LIST_MODEL(self->devices) : NULL;
+}
+
+AudiolizeFFT *audiolize_application_get_fft(AudiolizeApplication *self)
+{
+	return self->fft;
+}
+
+AudiolizeSpectrumSource *audiolize_application_get_source(AudiolizeApplication *self)
+{
+	if (self->player != NULL)
+		return AUDIOLIZE_SPECTRUM_SOURCE(self->player);
+	if (self->receiver != NULL)
+		return AUDIOLIZE_SPECTRUM_SOURCE(self->receiver);
+
+	return AUDIOLIZE_SPECTRUM_SOURCE(self->fft);
+}
+
+// Keep the FFT thread off the ring buffer until the audio driver operation about to be started is done.
+static void
+audiolize_application_begin_driver_operation(AudiolizeApplication *self)
+{
+	audiolize_fft_pause(self->fft);
+	self->driver_operations++;
+}
+
+// Let the FFT thread continue once the audio driver is done with the ring buffer.
+static void
+audiolize_application_driver_done_cb(AudioDriver *audio_driver, int result, void *user_data)
+{
+	AudiolizeApplication *self = user_data;
+
+	self->driver_operations--;
+	audiolize_fft_resume(self->fft);
+}
+
+// Point the FFT object at the input the audio driver has just opened.
+static void
+audiolize_application_input_opened_cb(AudioDriver *audio_driver, int result, void *user_data)
+{
+	AudiolizeApplication *self = user_data;
+
+	// Keep the same FFT object and thread running, only the input changes
+	if (audio_driver->selected_device != NULL)
+		audiolize_fft_reconfigure(self->fft,
+								  audio_driver->selected_device->defaultSampleRate,
+								  audio_driver->channels,
+								  &audio_driver->ring_buffer);
+
+	audiolize_application_driver_done_cb(audio_driver, result, user_data);
+}
+
+// Whether a device of the audio driver from index `first` onwards is called `name`.
+static gboolean
+audiolize_application_has_device(AudioDriver *audio_driver, int first, const char *name)
+{
+	for (int i = first; i < audio_driver->num_devices; i++)
+	{
+		if (g_str_equal(audio_driver->devices[i]->name, name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Bring the device names in line with the devices the audio driver has loaded.
+ *
+ * Only the devices that were plugged in or out are inserted or removed, so the drop downs keep their state
+ * and the selection follows the selected device around.
+ */
+static void
+audiolize_application_update_devices(AudiolizeApplication *self, AudioDriver *audio_driver)
+{
+	GListModel *devices = G_LIST_MODEL(self->devices);
+	guint position = 0;
+	int next = 0;
+
+	self->updating_devices = TRUE;
+
+	while (position < g_list_model_get_n_items(devices) || next < audio_driver->num_devices)
+	{
+		const char *name = gtk_string_list_get_string(self->devices, position);
+		const char *const added[] = {
+			next < audio_driver->num_devices ? audio_driver->devices[next]->name : NULL,
+			NULL,
+		};
+
+		if (name != NULL && added[0] != NULL && g_str_equal(name, added[0]))
+		{
+			position++;
+			next++;
+		}
+		else if (name != NULL && !audiolize_application_has_device(audio_driver, next, name))
+		{
+			gtk_string_list_remove(self->devices, position);
+		}
+		else
+		{
+			gtk_string_list_splice(self->devices, position, 0, added);
+			position++;
+			next++;
+		}
+	}
+
+	self->updating_devices = FALSE;
+
+	self->device = MAX(audio_driver->selected_index, 0);
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_DEVICE]);
+}
+
+// Show the devices the audio driver has found, and analyse the input it opened.
+static void
+audiolize_application_driver_started_cb(AudioDriver *audio_driver, int result, void *user_data)
+{
+	AudiolizeApplication *self = user_data;
+
+	if (result < 0)
+		g_printerr("ERROR: No audio input could be opened\n");
+
+	audiolize_application_update_devices(self, audio_driver);
+	audiolize_application_input_opened_cb(audio_driver, result, user_data);
+}
+
+// Show the devices the audio driver has reloaded, unless it left the input running as it was.
+static void
+audiolize_application_devices_refreshed_cb(AudioDriver *audio_driver, int result, void *user_data)
+{
+	if (result == AUDIO_DRIVER_STREAM_KEPT)
+		audiolize_application_driver_done_cb(audio_driver, result, user_data);
+	else
+		audiolize_application_driver_started_cb(audio_driver, result, user_data);
+}
+
+// Reload the devices in the background whenever one is plugged in or out.
+static void
+audiolize_application_devices_changed_cb(guint64 cards, void *user_data)
+{
+	AudiolizeApplication *self = user_data;
+
+	// The stream is only restarted if its card is one of those that changed, or if it isn't running
+	audiolize_application_begin_driver_operation(self);
+	audio_driver_refresh_devices(self->audio_driver, cards, audiolize_application_devices_refreshed_cb, self);
+}
+
+/**
+ * Switch the audio input over to another device, the stream is reopened in the background.
+ *
+ * The audio driver may reload the devices first, when some were plugged in or out while the input kept running.
+ */
+static void
+audiolize_application_set_device(AudiolizeApplication *self, guint device)
+{
+	if (self->audio_driver == NULL ||
+		self->updating_devices ||
+		device >= g_list_model_get_n_items(G_LIST_MODEL(self->devices)) ||
+		device == self->device)
+		return;
+
+	self->device = device;
+
+	audiolize_application_begin_driver_operation(self);
+	audio_driver_set_selected_device(self->audio_driver, device, audiolize_application_driver_started_cb, self);
+
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_DEVICE]);
+}
+
+/**
+ * Report any lost audio frames since the last check.
+ *
+ * The capture ring buffer is doubled in size when frames keep being dropped, this happens on machines
+ * that are too busy to keep the FFT thread scheduled.
+ */
+static gboolean
+audiolize_application_check_stats_cb(gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+	AudioDriverStats driver_stats;
+	AudiolizeFFTStats fft_stats;
+	unsigned long dropped_capture, overflows;
+
+	audio_driver_get_stats(self->audio_driver, &driver_stats);
+	audiolize_fft_get_stats(self->fft, &fft_stats);
+
+	dropped_capture = driver_stats.dropped_frames - self->driver_stats.dropped_frames;
+	overflows = driver_stats.input_overflows - self->driver_stats.input_overflows;
+
+	if (dropped_capture > 0 || overflows > 0)
+		g_print("Dropped %lu capture frames and had %lu input overflows, analysed %u frames\n",
+				dropped_capture, overflows, fft_stats.analysed_frames - self->fft_stats.analysed_frames);
+
+	// Frames pile up while the FFT thread waits for the driver, those drops don't count
+	self->drop_streak = dropped_capture > 0 && self->driver_operations == 0 ? self->drop_streak + 1 : 0;
+
+	if (self->drop_streak >= RING_BUFFER_GROW_STREAK &&
+		self->audio_driver->ring_buffer_size < MAX_RING_BUFFER_SIZE)
+	{
+		audiolize_application_begin_driver_operation(self);
+		audio_driver_set_ring_buffer_size(self->audio_driver, self->audio_driver->ring_buffer_size * 2,
+										  audiolize_application_driver_done_cb, self);
+
+		self->drop_streak = 0;
+	}
+
+	self->driver_stats = driver_stats;
+	self->fft_stats = fft_stats;
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Dump what the timing probes recorded since the last dump.
+static gboolean
+audiolize_application_dump_probes_cb(gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+	ProbeHistogram histograms[PROBE_COUNT], interval[PROBE_COUNT];
+	gint64 now = g_get_monotonic_time();
+
+	probes_snapshot(histograms);
+
+	memcpy(interval, histograms, sizeof(interval));
+	for (int stage = 0; stage < PROBE_COUNT; stage++)
+		probe_histogram_subtract(&interval[stage], &self->probe_dump_histograms[stage]);
+
+	probes_dump(stderr, self->probe_dump_format, interval, (double)(now - self->probe_dump_time) / G_USEC_PER_SEC);
+
+	memcpy(self->probe_dump_histograms, histograms, sizeof(histograms));
+	self->probe_dump_time = now;
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Start dumping the timing probes periodically, if `--dump-probes` was given.
+static void
+audiolize_application_start_probe_dump(AudiolizeApplication *self)
+{
+	if (!self->dump_probes)
+		return;
+
+	self->probe_dump_histograms = g_new(ProbeHistogram, PROBE_COUNT);
+	probes_snapshot(self->probe_dump_histograms);
+	self->probe_dump_time = g_get_monotonic_time();
+
+	self->probe_dump_id = g_timeout_add_seconds(PROBES_DUMP_INTERVAL, audiolize_application_dump_probes_cb, self);
+}
+
+// Actions changing the analysis, they do nothing while a spectrum file is played back
+static const char *const analysis_actions[] = {
+	"channel-mode",
+	"preset",
+	"band-layout",
+	"band-count",
+	"weighting",
+	"auto-gain",
+	"window-function",
+};
+
+// Disable the actions changing the analysis, when the windows don't show one.
+static void
+audiolize_application_disable_analysis_actions(AudiolizeApplication *self)
+{
+	for (guint i = 0; i < G_N_ELEMENTS(analysis_actions); i++)
+	{
+		GAction *action = g_action_map_lookup_action(G_ACTION_MAP(self), analysis_actions[i]);
+
+		g_simple_action_set_enabled(G_SIMPLE_ACTION(action), FALSE);
+	}
+}
+
+// Start playing the spectrum file back, along with its recording if there is one.
+static void
+audiolize_application_start_playback(AudiolizeApplication *self)
+{
+	audiolize_application_disable_analysis_actions(self);
+
+	if (self->media_path == NULL)
+		return;
+
+	self->media = gtk_media_file_new_for_filename(self->media_path);
+	audiolize_spectrum_player_set_media_stream(self->player, self->media);
+	gtk_media_stream_play(self->media);
+}
+
+// Apply the scheduling preferences to the FFT thread.
+static void
+audiolize_application_update_scheduling(AudiolizeApplication *self)
+{
+	if (self->fft != NULL)
+		audiolize_fft_set_scheduling(self->fft, self->realtime_priority, self->cpu_affinity);
+}
+
+/**
+ * Keep the preferences in GSettings.
+ *
+ * Running from the build directory the schema usually isn't installed, the preferences then only last until
+ * the application quits instead of aborting it.
+ */
+static void
+audiolize_application_load_settings(AudiolizeApplication *self)
+{
+	const char *schema_id = g_application_get_application_id(G_APPLICATION(self));
+	GSettingsSchemaSource *source = g_settings_schema_source_get_default();
+	g_autoptr(GSettingsSchema) schema = NULL;
+
+	if (source != NULL)
+		schema = g_settings_schema_source_lookup(source, schema_id, TRUE);
+	if (schema == NULL)
+	{
+		g_printerr("ERROR: The settings schema %s isn't installed, preferences won't be kept\n", schema_id);
+		return;
+	}
+
+	self->settings = g_settings_new_full(schema, NULL, NULL);
+	g_settings_bind(self->settings, "realtime-priority", self, "realtime-priority", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(self->settings, "cpu-affinity", self, "cpu-affinity", G_SETTINGS_BIND_DEFAULT);
+}
+
+// Open the audio input and start the FFT thread, before any window is created.
+static void
+audiolize_application_startup(GApplication *app)
+{
+	AudiolizeApplication *self = AUDIOLIZE_APPLICATION(app);
+
+	G_APPLICATION_CLASS(audiolize_application_parent_class)->startup(app);
+
+	audiolize_application_start_probe_dump(self);
+	audiolize_application_load_settings(self);
+
+	// Nothing is captured or analysed while playing a spectrum file back
+	if (self->player != NULL)
+	{
+		audiolize_application_start_playback(self);
+		return;
+	}
+
+	// Nor while showing the bands of another instance
+	if (self->receiver != NULL)
+	{
+		audiolize_application_disable_analysis_actions(self);
+		return;
+	}
+
+	// Initialize the audio driver
+	self->audio_driver = audio_driver_new();
+	if (self->audio_driver == NULL)
+	{
+		g_abort();
+		return;
+	}
+	self->devices = gtk_string_list_new(NULL);
+
+	// Startup the FFT thread, it's reconfigured for the input once the stream is open
+	self->fft = audiolize_fft_new(DEFAULT_SAMPLE_RATE,
+								  self->audio_driver->channels,
+								  &self->audio_driver->ring_buffer,
+								  self->audio_driver->wakeup_fd);
+	audiolize_application_update_scheduling(self);
+
+	// Every frame is also streamed to the displays given with `--stream`
+	if (self->sender != NULL)
+		audiolize_fft_set_sender(self->fft, g_steal_pointer(&(self->sender)));
+
+	// PortAudio is initialized and the input stream opened in the background, so the window shows right away
+	audiolize_application_begin_driver_operation(self);
+	audio_driver_start(self->audio_driver, audiolize_application_driver_started_cb, self);
+
+	self->device_monitor = device_monitor_new(audiolize_application_devices_changed_cb, self);
+
+	self->stats_timeout_id = g_timeout_add_seconds(STATS_INTERVAL, audiolize_application_check_stats_cb, self);
+}
+
+// Stop the FFT thread and close the audio input once every window is gone.
+static void
+audiolize_application_shutdown(GApplication *app)
+{
+	AudiolizeApplication *self = AUDIOLIZE_APPLICATION(app);
+
+	g_clear_handle_id(&(self->stats_timeout_id), g_source_remove);
+	g_clear_handle_id(&(self->probe_dump_id), g_source_remove);
+	g_clear_pointer(&(self->probe_dump_histograms), g_free);
+	g_clear_object(&(self->settings));
+	if (self->device_monitor != NULL)
+		device_monitor_free(&(self->device_monitor));
+	if (self->fft != NULL)
+		audiolize_fft_cancel_task(self->fft);
+	g_clear_object(&(self->fft));
+	if (self->audio_driver != NULL)
+		audio_driver_close(&(self->audio_driver));
+	g_clear_object(&(self->devices));
+
+	if (self->media != NULL)
+		gtk_media_stream_pause(self->media);
+	g_clear_object(&(self->media));
+	g_clear_object(&(self->player));
+	g_clear_pointer(&(self->media_path), g_free);
+	g_clear_object(&(self->receiver));
+	g_clear_pointer(&(self->sender), band_stream_sender_free);
+	g_clear_pointer(&(self->cpu_affinity), g_free);
+
+	G_APPLICATION_CLASS(audiolize_application_parent_class)->shutdown(app);
+}
+
 static void
 audiolize_application_activate(GApplication *app)
 {
@@ -52,19 +607,374 @@ audiolize_application_activate(GApplication *app)
 	window = gtk_application_get_active_window(GTK_APPLICATION(app));
 
 	if (window == NULL)
-		window = g_object_new(AUDIOLIZE_TYPE_WINDOW,
-							  "application", app,
-							  NULL);
+		window = GTK_WINDOW(audiolize_window_new(AUDIOLIZE_APPLICATION(app)));
 
 	gtk_window_present(window);
 }
 
+static void
+audiolize_application_get_property(GObject *object,
+								   guint prop_id,
+								   GValue *value,
+								   GParamSpec *pspec)
+{
+	AudiolizeApplication *self = AUDIOLIZE_APPLICATION(object);
+
+	switch (prop_id)
+	{
+	case PROP_DEVICE:
+		g_value_set_uint(value, self->device);
+		break;
+	case PROP_REALTIME_PRIORITY:
+		g_value_set_boolean(value, self->realtime_priority);
+		break;
+	case PROP_CPU_AFFINITY:
+		g_value_set_string(value, self->cpu_affinity);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+	}
+}
+
+static void
+audiolize_application_set_property(GObject *object,
+								   guint prop_id,
+								   const GValue *value,
+								   GParamSpec *pspec)
+{
+	AudiolizeApplication *self = AUDIOLIZE_APPLICATION(object);
+
+	switch (prop_id)
+	{
+	case PROP_DEVICE:
+		audiolize_application_set_device(self, g_value_get_uint(value));
+		break;
+	case PROP_REALTIME_PRIORITY:
+		if (self->realtime_priority == g_value_get_boolean(value))
+			break;
+		self->realtime_priority = g_value_get_boolean(value);
+		audiolize_application_update_scheduling(self);
+		g_object_notify_by_pspec(object, pspec);
+		break;
+	case PROP_CPU_AFFINITY:
+		if (g_strcmp0(self->cpu_affinity, g_value_get_string(value)) == 0)
+			break;
+		g_free(self->cpu_affinity);
+		self->cpu_affinity = g_value_dup_string(value);
+		audiolize_application_update_scheduling(self);
+		g_object_notify_by_pspec(object, pspec);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+	}
+}
+
+/**
+ * Look up a command line option naming one of the entries of a name table.
+ *
+ * @param `value` set to the index of the entry, left as it is when the option isn't given
+ * @return FALSE if the option names an entry that doesn't exist
+ */
+static gboolean
+audiolize_application_lookup_name(GVariantDict *options,
+								  const char *option,
+								  const char *const *names,
+								  int count,
+								  int *value)
+{
+	const char *name;
+	int index;
+
+	if (!g_variant_dict_lookup(options, option, "&s", &name))
+		return TRUE;
+
+	index = audiolize_application_parse_name(names, count, name);
+	if (index < 0)
+	{
+		g_printerr("ERROR: Unknown --%s '%s'\n", option, name);
+		return FALSE;
+	}
+
+	*value = index;
+	return TRUE;
+}
+
+#define LOOKUP_NAME(options, option, names, value) \
+	audiolize_application_lookup_name((options), (option), (names), G_N_ELEMENTS(names), (value))
+
+/**
+ * Open the spectrum file given with `--play`, the GUI then shows it instead of the audio input.
+ *
+ * The application is made non unique, otherwise an instance that is already running would be activated
+ * without ever seeing the file.
+ */
+static int
+audiolize_application_handle_play_options(AudiolizeApplication *self, GVariantDict *options)
+{
+	const char *path;
+
+	g_variant_dict_lookup(options, "play", "^&ay", &path);
+
+	self->player = audiolize_spectrum_player_new(path);
+	if (self->player == NULL)
+		return 1;
+
+	g_variant_dict_lookup(options, "media", "^ay", &(self->media_path));
+
+	g_application_set_flags(G_APPLICATION(self),
+							g_application_get_flags(G_APPLICATION(self)) | G_APPLICATION_NON_UNIQUE);
+
+	return -1;
+}
+
+/**
+ * Listen on the address given with `--receive`, the GUI then shows the bands received there instead of the audio input.
+ *
+ * The application is made non unique like with `--play`, so a display can run next to the instance streaming to it.
+ */
+static int
+audiolize_application_handle_receive_options(AudiolizeApplication *self, GVariantDict *options)
+{
+	const char *address;
+
+	g_variant_dict_lookup(options, "receive", "&s", &address);
+
+	self->receiver = audiolize_spectrum_receiver_new(address);
+	if (self->receiver == NULL)
+		return 1;
+
+	g_application_set_flags(G_APPLICATION(self),
+							g_application_get_flags(G_APPLICATION(self)) | G_APPLICATION_NON_UNIQUE);
+
+	return -1;
+}
+
+/**
+ * Resolve the displays given with `--stream`, the analysis is sent to them on top of being shown.
+ *
+ * This is done before starting up so a destination that doesn't resolve stops the application straight away.
+ * The application is made non unique, otherwise an instance that is already running would be activated
+ * without ever streaming.
+ *
+ * @return FALSE if the options are invalid or a destination couldn't be resolved
+ */
+static gboolean
+audiolize_application_handle_stream_options(AudiolizeApplication *self, GVariantDict *options)
+{
+	g_autofree const char **destinations = NULL;
+	// Eight bits are plenty for bars, and keep a frame of 64 bands to 72 bytes
+	int quantization = SPECTRUM_FILE_FORMAT_U8;
+
+	g_variant_dict_lookup(options, "stream", "^a&s", &destinations);
+
+	if (!LOOKUP_NAME(options, "quantization", quantization_names, &quantization))
+		return FALSE;
+
+	self->sender = band_stream_sender_new(destinations, quantization);
+	if (self->sender == NULL)
+		return FALSE;
+
+	g_application_set_flags(G_APPLICATION(self),
+							g_application_get_flags(G_APPLICATION(self)) | G_APPLICATION_NON_UNIQUE);
+
+	return TRUE;
+}
+
+// Options that each pick where the bands come from or go to, at most one of them can be given
+static const char *const mode_options[] = {"play", "receive", "stream", "analyze"};
+
+/**
+ * Check that the options given make sense together, rather than ignoring the ones the others override.
+ *
+ * @return FALSE if they don't
+ */
+static gboolean
+audiolize_application_check_options(GVariantDict *options)
+{
+	const char *mode = NULL;
+
+	for (int i = 0; i < (int)G_N_ELEMENTS(mode_options); i++)
+	{
+		if (!g_variant_dict_contains(options, mode_options[i]))
+			continue;
+
+		if (mode != NULL)
+		{
+			g_printerr("ERROR: --%s can't be used together with --%s\n", mode_options[i], mode);
+			return FALSE;
+		}
+		mode = mode_options[i];
+	}
+
+	if (g_variant_dict_contains(options, "media") && !g_variant_dict_contains(options, "play"))
+	{
+		g_printerr("ERROR: --media needs a spectrum file to play along with, given with --play\n");
+		return FALSE;
+	}
+
+	if (g_variant_dict_contains(options, "out") && !g_variant_dict_contains(options, "analyze"))
+	{
+		g_printerr("ERROR: --out needs the files to analyse, given with --analyze\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Run the offline analysis instead of the GUI when `--analyze` is given.
+ *
+ * This happens before the application is registered or started up, so no audio device or display is needed.
+ */
+static int
+audiolize_application_handle_local_options(GApplication *app, GVariantDict *options)
+{
+	OfflineAnalysisOptions analysis = {0};
+	AnalysisConfig *config = &analysis.config;
+	g_autofree const char **input_paths = NULL;
+	const char *format = "csv";
+	const char *probe_dump_format;
+	int quantization = SPECTRUM_FILE_FORMAT_FLOAT32;
+	int channel_mode, preset, band_layout, weighting, window_function;
+	gint32 bands, jobs;
+
+	if (g_variant_dict_lookup(options, "dump-probes", "&s", &probe_dump_format))
+	{
+		AudiolizeApplication *self = AUDIOLIZE_APPLICATION(app);
+
+		if (g_str_equal(probe_dump_format, "json"))
+			self->probe_dump_format = PROBE_DUMP_JSON;
+		else if (g_str_equal(probe_dump_format, "text"))
+			self->probe_dump_format = PROBE_DUMP_TEXT;
+		else
+		{
+			g_printerr("ERROR: Unknown --dump-probes '%s'\n", probe_dump_format);
+			return 1;
+		}
+		self->dump_probes = TRUE;
+	}
+
+	if (!audiolize_application_check_options(options))
+		return 1;
+
+	if (g_variant_dict_contains(options, "receive"))
+		return audiolize_application_handle_receive_options(AUDIOLIZE_APPLICATION(app), options);
+
+	if (g_variant_dict_contains(options, "play"))
+		return audiolize_application_handle_play_options(AUDIOLIZE_APPLICATION(app), options);
+
+	if (g_variant_dict_contains(options, "stream") &&
+		!audiolize_application_handle_stream_options(AUDIOLIZE_APPLICATION(app), options))
+		return 1;
+
+	if (!g_variant_dict_lookup(options, "analyze", "^a&ay", &input_paths))
+		return G_APPLICATION_CLASS(audiolize_application_parent_class)->handle_local_options(app, options);
+	analysis.input_paths = input_paths;
+
+	if (!g_variant_dict_lookup(options, "out", "^&ay", &analysis.output_path))
+	{
+		g_printerr("ERROR: --analyze needs a file or directory to write to, given with --out\n");
+		return 1;
+	}
+
+	if (g_variant_dict_lookup(options, "jobs", "i", &jobs))
+	{
+		if (jobs < 1)
+		{
+			g_printerr("ERROR: --jobs must be at least 1\n");
+			return 1;
+		}
+		analysis.jobs = jobs;
+	}
+
+	if (!LOOKUP_NAME(options, "quantization", quantization_names, &quantization))
+		return 1;
+	analysis.quantization = quantization;
+
+	g_variant_dict_lookup(options, "format", "&s", &format);
+	if (g_str_equal(format, "binary"))
+		analysis.format = OFFLINE_FORMAT_BINARY;
+	else if (g_str_equal(format, "csv"))
+		analysis.format = OFFLINE_FORMAT_CSV;
+	else
+	{
+		g_printerr("ERROR: Unknown --format '%s'\n", format);
+		return 1;
+	}
+
+	// Start from the same settings as the live view, the file decides the sample rate and channels
+	analysis_config_init(config, 0, 0);
+	channel_mode = config->channel_mode;
+	preset = config->preset;
+	band_layout = config->band_layout;
+	weighting = config->weighting;
+	window_function = config->window_function;
+
+	if (!LOOKUP_NAME(options, "channels", channel_mode_names, &channel_mode) ||
+		!LOOKUP_NAME(options, "preset", preset_names, &preset) ||
+		!LOOKUP_NAME(options, "layout", band_layout_names, &band_layout) ||
+		!LOOKUP_NAME(options, "weighting", weighting_names, &weighting) ||
+		!LOOKUP_NAME(options, "window", window_function_names, &window_function))
+		return 1;
+
+	config->channel_mode = channel_mode;
+	config->preset = preset;
+	config->band_layout = band_layout;
+	config->weighting = weighting;
+	config->window_function = window_function;
+
+	if (g_variant_dict_lookup(options, "bands", "i", &bands))
+	{
+		if (bands < 1 || bands > BAND_LAYOUT_MAX_BANDS)
+		{
+			g_printerr("ERROR: --bands must be between 1 and %d\n", BAND_LAYOUT_MAX_BANDS);
+			return 1;
+		}
+		config->bands = bands;
+	}
+
+	if (g_variant_dict_contains(options, "fixed-gain"))
+		config->auto_gain = FALSE;
+
+	return offline_analysis_run(&analysis);
+}
+
 static void
 audiolize_application_class_init(AudiolizeApplicationClass *klass)
 {
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
 	GApplicationClass *app_class = G_APPLICATION_CLASS(klass);
 
+	object_class->get_property = audiolize_application_get_property;
+	object_class->set_property = audiolize_application_set_property;
+
+	app_class->startup = audiolize_application_startup;
+	app_class->shutdown = audiolize_application_shutdown;
 	app_class->activate = audiolize_application_activate;
+	app_class->handle_local_options = audiolize_application_handle_local_options;
+
+	/**
+	 * Index of the audio input device, shared by all windows.
+	 */
+	properties[PROP_DEVICE] = g_param_spec_uint("device", NULL, NULL,
+												0, G_MAXUINT, 0,
+												G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * Whether the FFT thread runs with real-time priority.
+	 */
+	properties[PROP_REALTIME_PRIORITY] = g_param_spec_boolean("realtime-priority", NULL, NULL,
+															  FALSE,
+															  G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * CPUs the FFT thread is restricted to like "0,2-3", empty for every CPU.
+	 */
+	properties[PROP_CPU_AFFINITY] = g_param_spec_string("cpu-affinity", NULL, NULL,
+														"",
+														G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties(object_class, N_PROPS, properties);
 }
 
 static void
@@ -91,6 +1001,18 @@ audiolize_application_about_action(GSimpleAction *action,
 						  NULL);
 }
 
+// Open the preferences over the active window.
+static void
+audiolize_application_preferences_action(GSimpleAction *action,
+										 GVariant *parameter,
+										 gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+	GtkWindow *window = gtk_application_get_active_window(GTK_APPLICATION(self));
+
+	adw_dialog_present(ADW_DIALOG(audiolize_preferences_dialog_new(self)), GTK_WIDGET(window));
+}
+
 // Called when the window is destroyed
 static void
 destroy_window(gpointer data, gpointer user_data)
@@ -116,14 +1038,151 @@ audiolize_application_quit_action(GSimpleAction *action,
 	g_application_quit(G_APPLICATION(self));
 }
 
+// Open another window showing the same audio input.
+static void
+audiolize_application_new_window_action(GSimpleAction *action,
+										GVariant *parameter,
+										gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+
+	gtk_window_present(GTK_WINDOW(audiolize_window_new(self)));
+}
+
+// Callback used to change how the input channels are analysed.
+static void
+channel_mode_change_state_cb(GSimpleAction *action,
+							 GVariant *state,
+							 gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+	int mode = PARSE_NAME(channel_mode_names, g_variant_get_string(state, NULL));
+
+	audiolize_fft_set_channel_mode(self->fft, mode >= 0 ? mode : ANALYSIS_CHANNELS_MONO);
+
+	g_simple_action_set_state(action, state);
+}
+
+// Callback used to change the trade-off between frequency resolution and latency.
+static void
+preset_change_state_cb(GSimpleAction *action,
+					   GVariant *state,
+					   gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+	int preset = PARSE_NAME(preset_names, g_variant_get_string(state, NULL));
+
+	audiolize_fft_set_preset(self->fft, preset >= 0 ? preset : ANALYSIS_PRESET_BALANCED);
+
+	g_simple_action_set_state(action, state);
+}
+
+// Apply the band layout and band count actions to the FFT object.
+static void
+audiolize_application_update_band_layout(AudiolizeApplication *self)
+{
+	g_autoptr(GVariant) layout_state = g_action_group_get_action_state(G_ACTION_GROUP(self), "band-layout");
+	g_autoptr(GVariant) count_state = g_action_group_get_action_state(G_ACTION_GROUP(self), "band-count");
+	int layout = PARSE_NAME(band_layout_names, g_variant_get_string(layout_state, NULL));
+
+	audiolize_fft_set_band_layout(self->fft,
+								  layout >= 0 ? layout : BAND_LAYOUT_CLASSIC,
+								  g_variant_get_int32(count_state));
+}
+
+// Callback used to change how the spectrum is split up into bands.
+static void
+band_layout_change_state_cb(GSimpleAction *action,
+							GVariant *state,
+							gpointer user_data)
+{
+	g_simple_action_set_state(action, state);
+	audiolize_application_update_band_layout(user_data);
+}
+
+// Callback used to change the frequency weighting of the bands.
+static void
+weighting_change_state_cb(GSimpleAction *action,
+						  GVariant *state,
+						  gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+	int weighting = PARSE_NAME(weighting_names, g_variant_get_string(state, NULL));
+
+	audiolize_fft_set_weighting(self->fft, weighting >= 0 ? weighting : BAND_WEIGHTING_NONE);
+
+	g_simple_action_set_state(action, state);
+}
+
+// Callback used to change the window function of the analysis windows.
+static void
+window_function_change_state_cb(GSimpleAction *action,
+								GVariant *state,
+								gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+	int function = PARSE_NAME(window_function_names, g_variant_get_string(state, NULL));
+
+	audiolize_fft_set_window_function(self->fft, function >= 0 ? function : WINDOW_FUNCTION_HANN);
+
+	g_simple_action_set_state(action, state);
+}
+
+// Callback used to turn the automatic gain on or off.
+static void
+auto_gain_change_state_cb(GSimpleAction *action,
+						  GVariant *state,
+						  gpointer user_data)
+{
+	AudiolizeApplication *self = user_data;
+
+	audiolize_fft_set_auto_gain(self->fft, g_variant_get_boolean(state));
+
+	g_simple_action_set_state(action, state);
+}
+
 static const GActionEntry app_actions[] = {
 	{"quit", audiolize_application_quit_action},
 	{"about", audiolize_application_about_action},
+	{"preferences", audiolize_application_preferences_action},
+	{"new-window", audiolize_application_new_window_action},
+	{"channel-mode", NULL, "s", "'mono'", channel_mode_change_state_cb},
+	{"preset", NULL, "s", "'balanced'", preset_change_state_cb},
+	{"band-layout", NULL, "s", "'classic'", band_layout_change_state_cb},
+	{"band-count", NULL, "i", "64", band_layout_change_state_cb},
+	{"weighting", NULL, "s", "'none'", weighting_change_state_cb},
+	{"auto-gain", NULL, NULL, "true", auto_gain_change_state_cb},
+	{"window-function", NULL, "s", "'hann'", window_function_change_state_cb},
+};
+
+// Command line options, `--play`, `--media` and `--dump-probes` are for the GUI, the others for the offline analysis.
+static const GOptionEntry main_options[] = {
+	{"dump-probes", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Print the timings of every stage of the pipeline every few seconds: text or json"), N_("FORMAT")},
+	{"play", 0, 0, G_OPTION_ARG_FILENAME, NULL, N_("Show a spectrum file made with --analyze instead of the audio input"), N_("FILE")},
+	{"media", 0, 0, G_OPTION_ARG_FILENAME, NULL, N_("Recording to play along with --play, the bars follow its position"), N_("FILE")},
+	{"stream", 0, 0, G_OPTION_ARG_STRING_ARRAY, NULL, N_("Send the bands to a display started with --receive, can be given several times"), N_("HOST[:PORT]")},
+	{"receive", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Show the bands sent by another instance with --stream instead of the audio input"), N_("[ADDRESS:]PORT")},
+	{"analyze", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, NULL, N_("Analyse a WAV file without opening a window, can be given several times"), N_("FILE")},
+	{"out", 0, 0, G_OPTION_ARG_FILENAME, NULL, N_("File to write the analysis to, or directory when analysing several files"), N_("PATH")},
+	{"jobs", 0, 0, G_OPTION_ARG_INT, NULL, N_("Number of files or chunks analysed at once, one per processor by default"), N_("COUNT")},
+	{"format", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Output format: csv or binary"), N_("FORMAT")},
+	{"quantization", 0, 0, G_OPTION_ARG_STRING, NULL, N_("How binary output and --stream store the levels: float, u16 or u8"), N_("TYPE")},
+	{"preset", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Trade-off between latency and frequency resolution: low-latency, balanced, high-resolution or multi-resolution"), N_("PRESET")},
+	{"layout", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Band layout: classic, linear, log, mel or third-octave"), N_("LAYOUT")},
+	{"bands", 0, 0, G_OPTION_ARG_INT, NULL, N_("Number of bands of the linear, log and mel layouts"), N_("COUNT")},
+	{"channels", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Channel mode: mono, separate or mid-side"), N_("MODE")},
+	{"window", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Window function: rectangular, hann, blackman-harris, kaiser or flat-top"), N_("FUNCTION")},
+	{"weighting", 0, 0, G_OPTION_ARG_STRING, NULL, N_("Frequency weighting: none, a or c"), N_("WEIGHTING")},
+	{"fixed-gain", 0, 0, G_OPTION_ARG_NONE, NULL, N_("Keep the top of the levels at 0 dBFS instead of following the loudness"), NULL},
+	{NULL},
 };
 
 static void
 audiolize_application_init(AudiolizeApplication *self)
 {
+	self->cpu_affinity = g_strdup("");
+
+	g_application_add_main_option_entries(G_APPLICATION(self), main_options);
 	g_action_map_add_action_entries(G_ACTION_MAP(self),
 									app_actions,
 									G_N_ELEMENTS(app_actions),
@@ -131,4 +1190,13 @@ audiolize_application_init(AudiolizeApplication *self)
 	gtk_application_set_accels_for_action(GTK_APPLICATION(self),
 										  "app.quit",
 										  (const char *[]){"<control>q", NULL});
+	gtk_application_set_accels_for_action(GTK_APPLICATION(self),
+										  "app.new-window",
+										  (const char *[]){"<control>n", NULL});
+	gtk_application_set_accels_for_action(GTK_APPLICATION(self),
+										  "app.preferences",
+										  (const char *[]){"<control>comma", NULL});
+	gtk_application_set_accels_for_action(GTK_APPLICATION(self),
+										  "win.show-timings",
+										  (const char *[]){"<control><shift>t", NULL});
 }
@@ -19,6 +19,8 @@
 #pragma once
 
 #include <adwaita.h>
+#include <audio-driver/audio-driver.h>
+#include <fft/fft.h>
 
 G_BEGIN_DECLS
 
@@ -29,4 +31,13 @@ G_DECLARE_FINAL_TYPE(AudiolizeApplication, audiolize_application, AUDIOLIZE, APP
 AudiolizeApplication *audiolize_application_new(const char *application_id,
                                                 GApplicationFlags flags);
 
+// Get the names of the input devices, filled in once the audio driver has loaded them. NULL while playing a spectrum file back.
+GListModel *audiolize_application_get_devices(AudiolizeApplication *self);
+
+// Get the FFT object shared by all windows, owned by the application. NULL while playing a spectrum file back.
+AudiolizeFFT *audiolize_application_get_fft(AudiolizeApplication *self);
+
+// Get the source every window shows, either the FFT object or the player of a spectrum file.
+AudiolizeSpectrumSource *audiolize_application_get_source(AudiolizeApplication *self);
+
 G_END_DECLS
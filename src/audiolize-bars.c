@@ -0,0 +1,133 @@
+/* audiolize-bars.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "audiolize-bars.h"
+#include <math.h>
+
+void audiolize_bar_surface_resize(AudiolizeBarSurface *bars, int width, int height)
+{
+	audiolize_bar_surface_destroy(bars);
+
+	// Setup the Cairo surface for rendering, every pixel is written with the source operator
+	bars->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+											   width,
+											   height);
+	bars->cr = cairo_create(bars->surface);
+	cairo_set_operator(bars->cr, CAIRO_OPERATOR_SOURCE);
+
+	audiolize_bar_surface_clear(bars);
+}
+
+void audiolize_bar_surface_clear(AudiolizeBarSurface *bars)
+{
+	cairo_set_source_rgba(bars->cr, 0, 0, 0, 0);
+	cairo_paint(bars->cr);
+	bars->drawn_bars = 0;
+}
+
+void audiolize_bar_surface_destroy(AudiolizeBarSurface *bars)
+{
+	if (bars->surface == NULL)
+		return;
+
+	cairo_destroy(bars->cr);
+	cairo_surface_destroy(bars->surface);
+	bars->cr = NULL;
+	bars->surface = NULL;
+}
+
+gboolean audiolize_bar_surface_render(AudiolizeBarSurface *bars, const float *levels, int count, double step)
+{
+	int width, height, bar_width, padding;
+	gboolean changed;
+
+	width = cairo_image_surface_get_width(bars->surface);
+	height = cairo_image_surface_get_height(bars->surface);
+
+	// Each analysed channel gets its own group of bars, side by side
+	bar_width = width / count;
+	padding = MIN(AUDIOLIZE_BARS_PADDING, bar_width / 4);
+
+	// The columns move when the number of bars changes
+	if (count != bars->drawn_bars)
+		audiolize_bar_surface_clear(bars);
+
+	changed = bars->drawn_bars == 0;
+
+	// Draw the FFT graph
+	for (int i = 0; i < count; i++)
+	{
+		double bar_height = bars->current_heights[i];
+		int drawn_height;
+
+		// We can now multiply it by the max height of the surface we'd like to use
+		bar_height += (levels[i] * height - bar_height) * step;
+
+		bars->current_heights[i] = bar_height;
+
+		drawn_height = CLAMP((int)ceil(bar_height), 0, height);
+		if (bars->drawn_bars != 0 && drawn_height == bars->drawn_heights[i])
+			continue;
+
+		// Clear the column above the bar and fill the bar itself
+		cairo_set_source_rgba(bars->cr, 0, 0, 0, 0);
+		cairo_rectangle(bars->cr, i * bar_width, 0, bar_width, height - drawn_height);
+		cairo_fill(bars->cr);
+
+		cairo_set_source_rgb(bars->cr, 1, 0, 0);
+		cairo_rectangle(bars->cr, (i * bar_width) + padding, height - drawn_height, bar_width - (padding * 2), drawn_height);
+		cairo_fill(bars->cr);
+
+		bars->drawn_heights[i] = drawn_height;
+		changed = TRUE;
+	}
+
+	bars->drawn_bars = count;
+
+	return changed;
+}
+
+void audiolize_bars_snapshot(GtkSnapshot *snapshot, int width, int height, const float *levels, int count)
+{
+	const GdkRGBA color = {1, 0, 0, 1};
+	float bar_width, padding;
+
+	if (count == 0)
+		return;
+
+	bar_width = (float)width / count;
+	padding = MIN(AUDIOLIZE_BARS_PADDING, bar_width / 4);
+
+	for (int i = 0; i < count; i++)
+	{
+		graphene_rect_t bar;
+		int bar_height = (int)ceil(levels[i] * height);
+
+		if (bar_height <= 0)
+			continue;
+
+		graphene_rect_init(&bar,
+						   (i * bar_width) + padding,
+						   height - bar_height,
+						   bar_width - (padding * 2),
+						   bar_height);
+		gtk_snapshot_append_color(snapshot, &color, &bar);
+	}
+}
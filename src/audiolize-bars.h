@@ -0,0 +1,75 @@
+/* audiolize-bars.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+#include <fft/spectrum-source.h>
+
+G_BEGIN_DECLS
+
+// Padding between bars, narrow bars get a quarter of their width at most
+#define AUDIOLIZE_BARS_PADDING (6)
+
+/**
+ * Bars drawn into a Cairo image surface on the CPU.
+ *
+ * Only the columns of bars whose height changed are repainted, `audiolize_bar_surface_render` tells whether
+ * anything moved at all.
+ */
+typedef struct
+{
+	// Cairo surface for drawing to, NULL until the first resize
+	cairo_surface_t *surface;
+	// Cairo context drawing to `surface`, lives as long as the surface does
+	cairo_t *cr;
+
+	// The current height of the bars from the last rendered frame
+	double current_heights[AUDIOLIZE_SPECTRUM_SOURCE_MAX_BARS];
+	// Height in pixels of each bar as it is on the surface
+	int drawn_heights[AUDIOLIZE_SPECTRUM_SOURCE_MAX_BARS];
+	// Number of bars on the surface, 0 when the surface has to be repainted entirely
+	int drawn_bars;
+} AudiolizeBarSurface;
+
+// Replace the surface with an empty one of the given size.
+void audiolize_bar_surface_resize(AudiolizeBarSurface *bars, int width, int height);
+
+// Clear the surface, the next render repaints every bar.
+void audiolize_bar_surface_clear(AudiolizeBarSurface *bars);
+
+// Free the surface and its context.
+void audiolize_bar_surface_destroy(AudiolizeBarSurface *bars);
+
+/**
+ * Move the bars towards their target levels and repaint the ones that changed.
+ *
+ * @param `levels` `count` target levels from 0 to 1
+ * @param `step` fraction of the way to the target levels to move, 1 jumps straight to them
+ * @return TRUE if any pixel of the surface changed
+ */
+gboolean audiolize_bar_surface_render(AudiolizeBarSurface *bars, const float *levels, int count, double step);
+
+/**
+ * Append the bars to a snapshot as color nodes.
+ *
+ * @param `levels` `count` levels from 0 to 1
+ */
+void audiolize_bars_snapshot(GtkSnapshot *snapshot, int width, int height, const float *levels, int count);
+
+G_END_DECLS
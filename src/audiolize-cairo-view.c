@@ -0,0 +1,218 @@
+/* audiolize-cairo-view.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "audiolize-cairo-view.h"
+#include "audiolize-bars.h"
+#include <probes/probes.h>
+
+/**
+ * Drawing area drawing the bars into a Cairo image surface on the CPU.
+ *
+ * This is the fallback for `AudiolizeVisualizer`. Only the columns of bars whose height changed are repainted,
+ * and the drawing area isn't redrawn at all when nothing moved.
+ */
+struct _AudiolizeCairoView
+{
+	GtkDrawingArea parent_instance;
+
+	// Source to take the bar levels from
+	AudiolizeSpectrumSource *source;
+	// Sequence number of the last frame read from `source`
+	guint64 sequence;
+	// Capture time of the last frame read from `source`, until the window takes it once the frame is painted
+	gint64 shown_capture_time;
+
+	// Surface the bars are drawn into
+	AudiolizeBarSurface bar_surface;
+
+	// Levels to animate towards, as fractions of the surface height
+	float target_levels[AUDIOLIZE_SPECTRUM_SOURCE_MAX_BARS];
+	// Number of bars in the last analysis frame
+	int bars;
+
+	// Frame clock time of the last rendered frame, 0 if nothing was rendered since the widget was mapped
+	gint64 last_frame_time;
+	// ID of the tick callback, 0 while the widget is unmapped
+	guint tick_id;
+};
+
+G_DEFINE_FINAL_TYPE(AudiolizeCairoView, audiolize_cairo_view, GTK_TYPE_DRAWING_AREA)
+
+static void
+audiolize_cairo_view_resize(GtkDrawingArea *area,
+							int width,
+							int height)
+{
+	AudiolizeCairoView *self = AUDIOLIZE_CAIRO_VIEW(area);
+
+	audiolize_bar_surface_resize(&(self->bar_surface), width, height);
+}
+
+// Copies the surface to the drawing area. Doesn't actually update the surface.
+static void
+audiolize_cairo_view_draw(GtkDrawingArea *area,
+						  cairo_t *cr,
+						  int width,
+						  int height,
+						  gpointer user_data)
+{
+	AudiolizeCairoView *self = AUDIOLIZE_CAIRO_VIEW(area);
+
+	if (self->bar_surface.surface == NULL)
+		return;
+
+	cairo_set_source_surface(cr, self->bar_surface.surface, 0, 0);
+	cairo_paint(cr);
+}
+
+/**
+ * Render the next frame of the bars, called by the frame clock once per display refresh.
+ *
+ * The bars move towards their target height by the fraction of the analysis period that passed since the
+ * last frame, so the animation speed doesn't depend on the refresh rate of the display.
+ */
+static gboolean
+audiolize_cairo_view_tick_cb(GtkWidget *widget,
+							 GdkFrameClock *frame_clock,
+							 gpointer user_data)
+{
+	AudiolizeCairoView *self = AUDIOLIZE_CAIRO_VIEW(widget);
+	gint64 frame_time, start = probe_now();
+	double step;
+	int bars;
+
+	// Wait for the first resize before rendering
+	if (self->bar_surface.surface == NULL || self->source == NULL)
+		return G_SOURCE_CONTINUE;
+
+	frame_time = gdk_frame_clock_get_frame_time(frame_clock);
+	if (self->last_frame_time == 0)
+		step = 1.0;
+	else
+		step = MIN((frame_time - self->last_frame_time) / audiolize_spectrum_source_get_frame_interval(self->source), 1.0);
+	self->last_frame_time = frame_time;
+
+	// Pick up the newest frame, if the source has one since the last render
+	bars = audiolize_spectrum_source_read_levels(self->source, &self->sequence, self->target_levels,
+												 &self->shown_capture_time);
+	if (bars > 0)
+		self->bars = bars;
+
+	if (self->bars == 0)
+		return G_SOURCE_CONTINUE;
+
+	if (audiolize_bar_surface_render(&(self->bar_surface), self->target_levels, self->bars, step))
+		gtk_widget_queue_draw(widget);
+
+	probe_record_since(PROBE_RENDER, start);
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Start rendering once the drawing area is on screen.
+static void
+audiolize_cairo_view_map(GtkWidget *widget)
+{
+	AudiolizeCairoView *self = AUDIOLIZE_CAIRO_VIEW(widget);
+
+	GTK_WIDGET_CLASS(audiolize_cairo_view_parent_class)->map(widget);
+
+	self->last_frame_time = 0;
+	self->tick_id = gtk_widget_add_tick_callback(widget, audiolize_cairo_view_tick_cb, NULL, NULL);
+}
+
+// Stop rendering while the drawing area isn't visible.
+static void
+audiolize_cairo_view_unmap(GtkWidget *widget)
+{
+	AudiolizeCairoView *self = AUDIOLIZE_CAIRO_VIEW(widget);
+
+	if (self->tick_id != 0)
+	{
+		gtk_widget_remove_tick_callback(widget, self->tick_id);
+		self->tick_id = 0;
+	}
+
+	GTK_WIDGET_CLASS(audiolize_cairo_view_parent_class)->unmap(widget);
+}
+
+static void
+audiolize_cairo_view_dispose(GObject *gobject)
+{
+	AudiolizeCairoView *self = AUDIOLIZE_CAIRO_VIEW(gobject);
+
+	g_clear_object(&(self->source));
+
+	G_OBJECT_CLASS(audiolize_cairo_view_parent_class)->dispose(gobject);
+}
+
+static void
+audiolize_cairo_view_finalize(GObject *gobject)
+{
+	AudiolizeCairoView *self = AUDIOLIZE_CAIRO_VIEW(gobject);
+
+	audiolize_bar_surface_destroy(&(self->bar_surface));
+
+	G_OBJECT_CLASS(audiolize_cairo_view_parent_class)->finalize(gobject);
+}
+
+static void
+audiolize_cairo_view_class_init(AudiolizeCairoViewClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+	GtkDrawingAreaClass *drawing_area_class = GTK_DRAWING_AREA_CLASS(klass);
+
+	object_class->dispose = audiolize_cairo_view_dispose;
+	object_class->finalize = audiolize_cairo_view_finalize;
+
+	widget_class->map = audiolize_cairo_view_map;
+	widget_class->unmap = audiolize_cairo_view_unmap;
+
+	drawing_area_class->resize = audiolize_cairo_view_resize;
+}
+
+static void
+audiolize_cairo_view_init(AudiolizeCairoView *self)
+{
+	gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(self), audiolize_cairo_view_draw, NULL, NULL);
+}
+
+void audiolize_cairo_view_set_source(AudiolizeCairoView *self, AudiolizeSpectrumSource *source)
+{
+	if (!g_set_object(&(self->source), source))
+		return;
+
+	// Start over, the new source numbers its frames on its own
+	self->sequence = 0;
+	self->shown_capture_time = 0;
+	self->bars = 0;
+	if (self->bar_surface.surface != NULL)
+		audiolize_bar_surface_clear(&(self->bar_surface));
+	gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+gint64 audiolize_cairo_view_take_shown_capture_time(AudiolizeCairoView *self)
+{
+	gint64 capture_time = self->shown_capture_time;
+
+	self->shown_capture_time = 0;
+	return capture_time;
+}
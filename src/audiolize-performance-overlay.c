@@ -0,0 +1,194 @@
+/* audiolize-performance-overlay.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "audiolize-performance-overlay.h"
+#include <probes/probes.h>
+#include <string.h>
+
+// Interval at which the timings are refreshed, in milliseconds
+#define REFRESH_INTERVAL (1000)
+
+// Number of refreshes the percentiles are computed over
+#define HISTORY_LENGTH (5)
+
+/**
+ * Label showing the percentiles of every timing probe over the last few seconds.
+ *
+ * The timings are only gathered while the overlay is mapped, a hidden overlay costs nothing.
+ */
+struct _AudiolizePerformanceOverlay
+{
+	GtkWidget parent_instance;
+
+	GtkWidget *label;
+
+	// Histograms of the last `HISTORY_LENGTH` refreshes, `PROBE_COUNT` for each, oldest first
+	ProbeHistogram *history;
+	// Number of refreshes in `history`
+	int history_length;
+
+	// Source ID of the refresh timeout, 0 while the overlay is unmapped
+	guint refresh_id;
+};
+
+G_DEFINE_FINAL_TYPE(AudiolizePerformanceOverlay, audiolize_performance_overlay, GTK_TYPE_WIDGET)
+
+// Append a line with the rate and percentiles of a stage.
+static void
+append_stage(GString *text, const ProbeHistogram *histogram, ProbeStage stage, double interval)
+{
+	static const double percentiles[] = {50, 99, 100};
+	static const char *const percentile_names[] = {"p50", "p99", "max"};
+
+	g_string_append_printf(text, "%-16s %6.0f/s", probe_stage_get_name(stage), histogram->count / interval);
+
+	for (guint i = 0; i < G_N_ELEMENTS(percentiles) && histogram->count > 0; i++)
+	{
+		char duration[32];
+
+		probe_format_duration(probe_histogram_get_percentile(histogram, percentiles[i]), duration, sizeof(duration));
+		g_string_append_printf(text, "  %s %9s", percentile_names[i], duration);
+	}
+
+	g_string_append_c(text, '\n');
+}
+
+// Take a new snapshot of the probes and show what was recorded since the oldest one kept.
+static gboolean
+audiolize_performance_overlay_refresh_cb(gpointer user_data)
+{
+	AudiolizePerformanceOverlay *self = user_data;
+	ProbeHistogram interval[PROBE_COUNT];
+	ProbeHistogram *latest;
+	g_autoptr(GString) text = NULL;
+	double seconds;
+
+	// Drop the oldest snapshot once the history is full
+	if (self->history_length == HISTORY_LENGTH + 1)
+	{
+		memmove(self->history, self->history + PROBE_COUNT, sizeof(ProbeHistogram) * PROBE_COUNT * HISTORY_LENGTH);
+		self->history_length--;
+	}
+
+	latest = self->history + self->history_length * PROBE_COUNT;
+	probes_snapshot(latest);
+	self->history_length++;
+
+	if (self->history_length < 2)
+	{
+		gtk_label_set_text(GTK_LABEL(self->label), "Gathering timings…");
+		return G_SOURCE_CONTINUE;
+	}
+
+	memcpy(interval, latest, sizeof(interval));
+	for (int stage = 0; stage < PROBE_COUNT; stage++)
+		probe_histogram_subtract(&interval[stage], &self->history[stage]);
+	seconds = (self->history_length - 1) * REFRESH_INTERVAL / 1000.0;
+
+	// The end to end latency is what the whole pipeline is about, so it comes first
+	text = g_string_new(NULL);
+	append_stage(text, &interval[PROBE_AUDIO_TO_PHOTON], PROBE_AUDIO_TO_PHOTON, seconds);
+	g_string_append_c(text, '\n');
+	for (int stage = 0; stage < PROBE_AUDIO_TO_PHOTON; stage++)
+		append_stage(text, &interval[stage], stage, seconds);
+
+	// No trailing newline, it would add an empty line to the label
+	g_string_truncate(text, text->len - 1);
+	gtk_label_set_text(GTK_LABEL(self->label), text->str);
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Start gathering timings once the overlay is shown.
+static void
+audiolize_performance_overlay_map(GtkWidget *widget)
+{
+	AudiolizePerformanceOverlay *self = AUDIOLIZE_PERFORMANCE_OVERLAY(widget);
+
+	GTK_WIDGET_CLASS(audiolize_performance_overlay_parent_class)->map(widget);
+
+	self->history_length = 0;
+	audiolize_performance_overlay_refresh_cb(self);
+	self->refresh_id = g_timeout_add(REFRESH_INTERVAL, audiolize_performance_overlay_refresh_cb, self);
+}
+
+// Stop refreshing while the overlay is hidden.
+static void
+audiolize_performance_overlay_unmap(GtkWidget *widget)
+{
+	AudiolizePerformanceOverlay *self = AUDIOLIZE_PERFORMANCE_OVERLAY(widget);
+
+	g_clear_handle_id(&(self->refresh_id), g_source_remove);
+
+	GTK_WIDGET_CLASS(audiolize_performance_overlay_parent_class)->unmap(widget);
+}
+
+static void
+audiolize_performance_overlay_dispose(GObject *gobject)
+{
+	AudiolizePerformanceOverlay *self = AUDIOLIZE_PERFORMANCE_OVERLAY(gobject);
+
+	g_clear_pointer(&(self->label), gtk_widget_unparent);
+
+	G_OBJECT_CLASS(audiolize_performance_overlay_parent_class)->dispose(gobject);
+}
+
+static void
+audiolize_performance_overlay_finalize(GObject *gobject)
+{
+	AudiolizePerformanceOverlay *self = AUDIOLIZE_PERFORMANCE_OVERLAY(gobject);
+
+	g_free(self->history);
+
+	G_OBJECT_CLASS(audiolize_performance_overlay_parent_class)->finalize(gobject);
+}
+
+static void
+audiolize_performance_overlay_class_init(AudiolizePerformanceOverlayClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+	object_class->dispose = audiolize_performance_overlay_dispose;
+	object_class->finalize = audiolize_performance_overlay_finalize;
+
+	widget_class->map = audiolize_performance_overlay_map;
+	widget_class->unmap = audiolize_performance_overlay_unmap;
+
+	gtk_widget_class_set_layout_manager_type(widget_class, GTK_TYPE_BIN_LAYOUT);
+}
+
+static void
+audiolize_performance_overlay_init(AudiolizePerformanceOverlay *self)
+{
+	self->history = g_new0(ProbeHistogram, (HISTORY_LENGTH + 1) * PROBE_COUNT);
+
+	self->label = gtk_label_new(NULL);
+	gtk_label_set_xalign(GTK_LABEL(self->label), 0);
+	gtk_widget_add_css_class(self->label, "monospace");
+	gtk_widget_set_margin_start(self->label, 8);
+	gtk_widget_set_margin_end(self->label, 8);
+	gtk_widget_set_margin_top(self->label, 6);
+	gtk_widget_set_margin_bottom(self->label, 6);
+	gtk_widget_set_parent(self->label, GTK_WIDGET(self));
+
+	gtk_widget_add_css_class(GTK_WIDGET(self), "osd");
+	gtk_widget_set_can_target(GTK_WIDGET(self), FALSE);
+}
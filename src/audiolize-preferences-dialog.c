@@ -0,0 +1,115 @@
+/* audiolize-preferences-dialog.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "audiolize-preferences-dialog.h"
+#include <fft/thread-scheduling.h>
+
+/**
+ * Dialog editing the preferences of the application.
+ *
+ * The rows are bound to the properties of the application, which stores them in GSettings when the schema is
+ * installed and applies them to the running analysis.
+ */
+struct _AudiolizePreferencesDialog
+{
+	AdwPreferencesDialog parent_instance;
+
+	/* Template widgets */
+
+	AdwSwitchRow *realtime_row;
+	AdwEntryRow *affinity_row;
+
+	// Application the preferences belong to
+	AudiolizeApplication *app;
+};
+
+G_DEFINE_FINAL_TYPE(AudiolizePreferencesDialog, audiolize_preferences_dialog, ADW_TYPE_PREFERENCES_DIALOG)
+
+// Apply the CPU list typed into the affinity row, or mark the row if the list is invalid.
+static void
+affinity_row_apply_cb(AdwEntryRow *row, gpointer user_data)
+{
+	AudiolizePreferencesDialog *self = user_data;
+	const char *cpus = gtk_editable_get_text(GTK_EDITABLE(row));
+
+	if (!thread_scheduling_is_valid_cpu_list(cpus))
+	{
+		gtk_widget_add_css_class(GTK_WIDGET(row), "error");
+		return;
+	}
+
+	g_object_set(self->app, "cpu-affinity", cpus, NULL);
+}
+
+// Clear the error of the affinity row as soon as the list is edited.
+static void
+affinity_row_changed_cb(GtkEditable *editable, gpointer user_data)
+{
+	gtk_widget_remove_css_class(GTK_WIDGET(editable), "error");
+}
+
+static void
+audiolize_preferences_dialog_dispose(GObject *gobject)
+{
+	AudiolizePreferencesDialog *self = AUDIOLIZE_PREFERENCES_DIALOG(gobject);
+
+	g_clear_object(&(self->app));
+	gtk_widget_dispose_template(GTK_WIDGET(gobject), AUDIOLIZE_TYPE_PREFERENCES_DIALOG);
+
+	G_OBJECT_CLASS(audiolize_preferences_dialog_parent_class)->dispose(gobject);
+}
+
+static void
+audiolize_preferences_dialog_class_init(AudiolizePreferencesDialogClass *klass)
+{
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+	G_OBJECT_CLASS(klass)->dispose = audiolize_preferences_dialog_dispose;
+
+	gtk_widget_class_set_template_from_resource(widget_class, "/io/bricksigma/Audiolize/audiolize-preferences-dialog.ui");
+	gtk_widget_class_bind_template_child(widget_class, AudiolizePreferencesDialog, realtime_row);
+	gtk_widget_class_bind_template_child(widget_class, AudiolizePreferencesDialog, affinity_row);
+	gtk_widget_class_bind_template_callback(widget_class, affinity_row_apply_cb);
+	gtk_widget_class_bind_template_callback(widget_class, affinity_row_changed_cb);
+}
+
+static void
+audiolize_preferences_dialog_init(AudiolizePreferencesDialog *self)
+{
+	gtk_widget_init_template(GTK_WIDGET(self));
+}
+
+AudiolizePreferencesDialog *
+audiolize_preferences_dialog_new(AudiolizeApplication *app)
+{
+	AudiolizePreferencesDialog *self = g_object_new(AUDIOLIZE_TYPE_PREFERENCES_DIALOG, NULL);
+	g_autofree char *cpu_affinity = NULL;
+
+	self->app = g_object_ref(app);
+
+	g_object_bind_property(app, "realtime-priority", self->realtime_row, "active",
+						   G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+
+	// Only applied once the list is confirmed, every keystroke would move the analysis thread around
+	g_object_get(app, "cpu-affinity", &cpu_affinity, NULL);
+	gtk_editable_set_text(GTK_EDITABLE(self->affinity_row), cpu_affinity != NULL ? cpu_affinity : "");
+
+	return self;
+}
@@ -0,0 +1,33 @@
+/* audiolize-preferences-dialog.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <adwaita.h>
+#include "audiolize-application.h"
+
+G_BEGIN_DECLS
+
+#define AUDIOLIZE_TYPE_PREFERENCES_DIALOG (audiolize_preferences_dialog_get_type())
+
+G_DECLARE_FINAL_TYPE (AudiolizePreferencesDialog, audiolize_preferences_dialog, AUDIOLIZE, PREFERENCES_DIALOG, AdwPreferencesDialog)
+
+// Create a new dialog editing the preferences of `app`.
+AudiolizePreferencesDialog *audiolize_preferences_dialog_new(AudiolizeApplication *app);
+
+G_END_DECLS
@@ -0,0 +1,171 @@
+/* audiolize-spectrum-player.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "audiolize-spectrum-player.h"
+#include <offline/spectrum-file.h>
+
+/**
+ * Spectrum source playing a precomputed spectrum file back.
+ *
+ * Frames are only read when the playback position reaches a new one, nothing runs in between.
+ */
+struct _AudiolizeSpectrumPlayer
+{
+	GObject parent_instance;
+
+	// Mapped spectrum file
+	SpectrumFile *file;
+
+	// Media stream the position is taken from, NULL to use the player's own clock
+	GtkMediaStream *stream;
+	// Monotonic time at which the player's own clock was at position 0
+	gint64 start_time;
+
+	// Index of the frame handed out last, -1 before the first one
+	gint64 frame;
+	// Increased whenever `frame` changes, so views pick up every change, even when seeking backwards
+	guint64 sequence;
+};
+
+static void audiolize_spectrum_player_source_init(AudiolizeSpectrumSourceInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(AudiolizeSpectrumPlayer, audiolize_spectrum_player, G_TYPE_OBJECT,
+							  G_IMPLEMENT_INTERFACE(AUDIOLIZE_TYPE_SPECTRUM_SOURCE, audiolize_spectrum_player_source_init))
+
+static int
+audiolize_spectrum_player_read_levels(AudiolizeSpectrumSource *source,
+									  guint64 *sequence,
+									  float *levels,
+									  gint64 *capture_time)
+{
+	AudiolizeSpectrumPlayer *self = AUDIOLIZE_SPECTRUM_PLAYER(source);
+	const SpectrumFileInfo *info = spectrum_file_get_info(self->file);
+	guint64 frames = spectrum_file_get_frames(self->file);
+	gint64 position, frame;
+
+	if (frames == 0)
+		return 0;
+
+	// Frame `n` covers the audio up to the end of hop `n + 1`, that is the moment the live view would show it
+	position = audiolize_spectrum_player_get_position(self);
+	frame = position * info->sample_rate / ((gint64)info->hop_size * G_USEC_PER_SEC) - 1;
+	frame = CLAMP(frame, 0, (gint64)frames - 1);
+
+	if (frame != self->frame)
+	{
+		self->frame = frame;
+		self->sequence++;
+	}
+
+	if (self->sequence <= *sequence)
+		return 0;
+
+	spectrum_file_read_frame(self->file, frame, levels);
+	*sequence = self->sequence;
+	// The audio was captured whenever the file was made, there is no latency to time
+	*capture_time = 0;
+
+	return info->channels * info->bands;
+}
+
+static double
+audiolize_spectrum_player_get_frame_interval(AudiolizeSpectrumSource *source)
+{
+	AudiolizeSpectrumPlayer *self = AUDIOLIZE_SPECTRUM_PLAYER(source);
+	const SpectrumFileInfo *info = spectrum_file_get_info(self->file);
+
+	return (double)info->hop_size * G_USEC_PER_SEC / (double)info->sample_rate;
+}
+
+static void
+audiolize_spectrum_player_source_init(AudiolizeSpectrumSourceInterface *iface)
+{
+	iface->read_levels = audiolize_spectrum_player_read_levels;
+	iface->get_frame_interval = audiolize_spectrum_player_get_frame_interval;
+}
+
+static void
+audiolize_spectrum_player_dispose(GObject *gobject)
+{
+	AudiolizeSpectrumPlayer *self = AUDIOLIZE_SPECTRUM_PLAYER(gobject);
+
+	g_clear_object(&(self->stream));
+
+	G_OBJECT_CLASS(audiolize_spectrum_player_parent_class)->dispose(gobject);
+}
+
+static void
+audiolize_spectrum_player_finalize(GObject *gobject)
+{
+	AudiolizeSpectrumPlayer *self = AUDIOLIZE_SPECTRUM_PLAYER(gobject);
+
+	spectrum_file_close(self->file);
+
+	G_OBJECT_CLASS(audiolize_spectrum_player_parent_class)->finalize(gobject);
+}
+
+static void
+audiolize_spectrum_player_class_init(AudiolizeSpectrumPlayerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+	object_class->dispose = audiolize_spectrum_player_dispose;
+	object_class->finalize = audiolize_spectrum_player_finalize;
+}
+
+static void
+audiolize_spectrum_player_init(AudiolizeSpectrumPlayer *self)
+{
+	self->frame = -1;
+	self->start_time = g_get_monotonic_time();
+}
+
+AudiolizeSpectrumPlayer *audiolize_spectrum_player_new(const char *path)
+{
+	AudiolizeSpectrumPlayer *self;
+	SpectrumFile *file;
+
+	file = spectrum_file_open(path);
+	if (file == NULL)
+		return NULL;
+
+	self = AUDIOLIZE_SPECTRUM_PLAYER(g_object_new(AUDIOLIZE_TYPE_SPECTRUM_PLAYER, NULL));
+	self->file = file;
+
+	return self;
+}
+
+void audiolize_spectrum_player_set_media_stream(AudiolizeSpectrumPlayer *self, GtkMediaStream *stream)
+{
+	g_set_object(&(self->stream), stream);
+}
+
+gint64 audiolize_spectrum_player_get_position(AudiolizeSpectrumPlayer *self)
+{
+	if (self->stream != NULL)
+		return gtk_media_stream_get_timestamp(self->stream);
+
+	return g_get_monotonic_time() - self->start_time;
+}
+
+void audiolize_spectrum_player_seek(AudiolizeSpectrumPlayer *self, gint64 position)
+{
+	self->start_time = g_get_monotonic_time() - position;
+}
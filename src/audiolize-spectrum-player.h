@@ -0,0 +1,57 @@
+/* audiolize-spectrum-player.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+#include <fft/spectrum-source.h>
+
+G_BEGIN_DECLS
+
+#define AUDIOLIZE_TYPE_SPECTRUM_PLAYER (audiolize_spectrum_player_get_type())
+
+G_DECLARE_FINAL_TYPE (AudiolizeSpectrumPlayer, audiolize_spectrum_player, AUDIOLIZE, SPECTRUM_PLAYER, GObject)
+
+/**
+ * Create a player showing the frames of a spectrum file written by the offline analysis.
+ *
+ * The file is mapped into memory and every frame is looked up straight from the playback position,
+ * so playing it back takes no analysis at all. The player is an `AudiolizeSpectrumSource` for the views.
+ *
+ * @return the player, or NULL if the file couldn't be opened
+ */
+AudiolizeSpectrumPlayer *audiolize_spectrum_player_new(const char *path);
+
+/**
+ * Follow the position of a media stream, normally the recording the file was made from.
+ *
+ * @param `stream` stream to follow, or NULL to play on the player's own clock
+ */
+void audiolize_spectrum_player_set_media_stream(AudiolizeSpectrumPlayer *self, GtkMediaStream *stream);
+
+// Get the playback position in microseconds.
+gint64 audiolize_spectrum_player_get_position(AudiolizeSpectrumPlayer *self);
+
+/**
+ * Move the player's own clock to a position in microseconds.
+ *
+ * This has no effect while following a media stream, seek the stream instead.
+ */
+void audiolize_spectrum_player_seek(AudiolizeSpectrumPlayer *self, gint64 position);
+
+G_END_DECLS
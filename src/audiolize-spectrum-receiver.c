@@ -0,0 +1,247 @@
+/* audiolize-spectrum-receiver.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "audiolize-spectrum-receiver.h"
+#include <network/band-stream.h>
+#include <probes/probes.h>
+#include <string.h>
+
+// A frame this far behind the newest one means the sender was restarted, rather than a datagram arriving late
+#define RESTART_GAP (1000)
+
+/**
+ * Spectrum source showing frames received from the network.
+ *
+ * Nothing is analysed, the levels are shown as they arrive.
+ */
+struct _AudiolizeSpectrumReceiver
+{
+	GObject parent_instance;
+
+	GSocket *socket;
+	// Source receiving the datagrams on the main context
+	GSource *source;
+
+	// Datagram being received
+	guint8 packet[BAND_STREAM_MAX_DATAGRAM_SIZE];
+
+	// Levels of the newest frame received, `values` of them
+	float levels[ANALYSIS_MAX_VALUES];
+	int values;
+	// Time the audio of the newest frame was captured at on the `probe_now` clock, 0 if the sender didn't know
+	gint64 capture_time;
+	// Time between the frames of the stream in microseconds
+	double frame_interval;
+	// Sequence number in the stream of the newest frame received
+	guint64 stream_sequence;
+	// Increased whenever a newer frame is received, 0 until the first one
+	guint64 sequence;
+};
+
+static void audiolize_spectrum_receiver_source_init(AudiolizeSpectrumSourceInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(AudiolizeSpectrumReceiver, audiolize_spectrum_receiver, G_TYPE_OBJECT,
+							  G_IMPLEMENT_INTERFACE(AUDIOLIZE_TYPE_SPECTRUM_SOURCE, audiolize_spectrum_receiver_source_init))
+
+static int
+audiolize_spectrum_receiver_read_levels(AudiolizeSpectrumSource *source,
+										guint64 *sequence,
+										float *levels,
+										gint64 *capture_time)
+{
+	AudiolizeSpectrumReceiver *self = AUDIOLIZE_SPECTRUM_RECEIVER(source);
+
+	if (self->sequence <= *sequence)
+		return 0;
+
+	memcpy(levels, self->levels, sizeof(float) * self->values);
+	*sequence = self->sequence;
+	*capture_time = self->capture_time;
+
+	return self->values;
+}
+
+static double
+audiolize_spectrum_receiver_get_frame_interval(AudiolizeSpectrumSource *source)
+{
+	AudiolizeSpectrumReceiver *self = AUDIOLIZE_SPECTRUM_RECEIVER(source);
+
+	return self->frame_interval;
+}
+
+static void
+audiolize_spectrum_receiver_source_init(AudiolizeSpectrumSourceInterface *iface)
+{
+	iface->read_levels = audiolize_spectrum_receiver_read_levels;
+	iface->get_frame_interval = audiolize_spectrum_receiver_get_frame_interval;
+}
+
+// Take every datagram waiting, keeping the newest frame of the newest one.
+static gboolean
+audiolize_spectrum_receiver_receive_cb(GSocket *socket, GIOCondition condition, gpointer user_data)
+{
+	AudiolizeSpectrumReceiver *self = user_data;
+	BandStreamHeader header;
+	gint64 capture_time;
+	guint64 last;
+	gssize size;
+
+	while ((size = g_socket_receive(socket, (gchar *)self->packet, sizeof(self->packet), NULL, NULL)) > 0)
+	{
+		if (!band_stream_parse_header(self->packet, size, &header))
+			continue;
+
+		// Datagrams can arrive out of order, an older one would make the bars jump back
+		last = header.sequence + header.frames - 1;
+		if (self->sequence != 0 && last <= self->stream_sequence && self->stream_sequence - last < RESTART_GAP)
+			continue;
+
+		band_stream_read_frame(self->packet, &header, header.frames - 1, &capture_time, self->levels);
+
+		// The sender stamps the frames on its wall clock, which only lines up with ours when both are synchronized.
+		// The latency from the capture on the other machine to our screen is then timed like a local one.
+		self->capture_time = 0;
+		if (capture_time != 0)
+			self->capture_time = probe_now() - (g_get_real_time() - capture_time) * 1000;
+
+		self->values = header.channels * header.bands;
+		self->frame_interval = MAX(header.frame_interval, 1);
+		self->stream_sequence = last;
+		self->sequence++;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Work out the address to bind to from `[ADDRESS:]PORT`.
+ *
+ * @param `group` set to the multicast group to join, or NULL if `address` isn't a multicast one
+ * @return the address, or NULL if `address` isn't an IP address and port
+ */
+static GSocketAddress *
+audiolize_spectrum_receiver_parse_address(const char *address, GInetAddress **group)
+{
+	g_autoptr(GSocketConnectable) connectable = NULL;
+	g_autoptr(GInetAddress) inet_address = NULL;
+	g_autoptr(GError) error = NULL;
+	guint64 port;
+
+	*group = NULL;
+
+	// A port on its own listens on every interface
+	if (g_ascii_string_to_unsigned(address, 10, 1, G_MAXUINT16, &port, NULL))
+	{
+		inet_address = g_inet_address_new_any(G_SOCKET_FAMILY_IPV4);
+		return g_inet_socket_address_new(inet_address, port);
+	}
+
+	connectable = g_network_address_parse(address, BAND_STREAM_DEFAULT_PORT, &error);
+	if (connectable == NULL)
+	{
+		g_printerr("ERROR: Invalid --receive '%s': %s\n", address, error->message);
+		return NULL;
+	}
+
+	inet_address = g_inet_address_new_from_string(g_network_address_get_hostname(G_NETWORK_ADDRESS(connectable)));
+	if (inet_address == NULL)
+	{
+		g_printerr("ERROR: --receive needs an IP address to listen on, not '%s'\n", address);
+		return NULL;
+	}
+
+	port = g_network_address_get_port(G_NETWORK_ADDRESS(connectable));
+
+	// The stream is sent to the group, so it's received on any address of the family
+	if (g_inet_address_get_is_multicast(inet_address))
+	{
+		*group = g_steal_pointer(&inet_address);
+		inet_address = g_inet_address_new_any(g_inet_address_get_family(*group));
+	}
+
+	return g_inet_socket_address_new(inet_address, port);
+}
+
+static void
+audiolize_spectrum_receiver_dispose(GObject *gobject)
+{
+	AudiolizeSpectrumReceiver *self = AUDIOLIZE_SPECTRUM_RECEIVER(gobject);
+
+	if (self->source != NULL)
+		g_source_destroy(self->source);
+	g_clear_pointer(&(self->source), g_source_unref);
+	g_clear_object(&(self->socket));
+
+	G_OBJECT_CLASS(audiolize_spectrum_receiver_parent_class)->dispose(gobject);
+}
+
+static void
+audiolize_spectrum_receiver_class_init(AudiolizeSpectrumReceiverClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+	object_class->dispose = audiolize_spectrum_receiver_dispose;
+}
+
+static void
+audiolize_spectrum_receiver_init(AudiolizeSpectrumReceiver *self)
+{
+	// Until the first frame arrives, the interval of the default analysis at 48 kHz
+	self->frame_interval = 512.0 * G_USEC_PER_SEC / 48000.0;
+}
+
+AudiolizeSpectrumReceiver *audiolize_spectrum_receiver_new(const char *address)
+{
+	g_autoptr(AudiolizeSpectrumReceiver) self = NULL;
+	g_autoptr(GSocketAddress) socket_address = NULL;
+	g_autoptr(GInetAddress) group = NULL;
+	g_autoptr(GError) error = NULL;
+
+	socket_address = audiolize_spectrum_receiver_parse_address(address, &group);
+	if (socket_address == NULL)
+		return NULL;
+
+	self = AUDIOLIZE_SPECTRUM_RECEIVER(g_object_new(AUDIOLIZE_TYPE_SPECTRUM_RECEIVER, NULL));
+
+	self->socket = g_socket_new(g_socket_address_get_family(socket_address),
+								G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error);
+	if (self->socket == NULL)
+	{
+		g_printerr("ERROR: Could not open a socket to receive on: %s\n", error->message);
+		return NULL;
+	}
+
+	// Address reuse lets several displays on the same machine join the same group
+	g_socket_set_blocking(self->socket, FALSE);
+	if (!g_socket_bind(self->socket, socket_address, TRUE, &error) ||
+		(group != NULL && !g_socket_join_multicast_group(self->socket, group, FALSE, NULL, &error)))
+	{
+		g_printerr("ERROR: Could not receive on %s: %s\n", address, error->message);
+		return NULL;
+	}
+
+	self->source = g_socket_create_source(self->socket, G_IO_IN, NULL);
+	g_source_set_callback(self->source, G_SOURCE_FUNC(audiolize_spectrum_receiver_receive_cb), self, NULL);
+	g_source_attach(self->source, NULL);
+
+	g_print("Receiving bands on %s\n", address);
+
+	return g_steal_pointer(&self);
+}
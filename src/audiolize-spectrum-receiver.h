@@ -0,0 +1,41 @@
+/* audiolize-spectrum-receiver.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <fft/spectrum-source.h>
+
+G_BEGIN_DECLS
+
+#define AUDIOLIZE_TYPE_SPECTRUM_RECEIVER (audiolize_spectrum_receiver_get_type())
+
+G_DECLARE_FINAL_TYPE (AudiolizeSpectrumReceiver, audiolize_spectrum_receiver, AUDIOLIZE, SPECTRUM_RECEIVER, GObject)
+
+/**
+ * Create a receiver showing the frames another instance streams with `--stream`.
+ *
+ * Datagrams are received on the main context and only the newest frame is kept, so the display runs no analysis
+ * and needs no audio input. The receiver is an `AudiolizeSpectrumSource` for the views.
+ *
+ * @param `address` `[ADDRESS:]PORT` to listen on, a multicast address joins its group
+ * @return the receiver, or NULL if it couldn't listen on `address`
+ */
+AudiolizeSpectrumReceiver *audiolize_spectrum_receiver_new(const char *address);
+
+G_END_DECLS
@@ -0,0 +1,187 @@
+/* audiolize-visualizer.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "audiolize-visualizer.h"
+#include "audiolize-bars.h"
+#include <probes/probes.h>
+#include <string.h>
+
+/**
+ * Widget drawing the bars as GSK color nodes.
+ *
+ * Nothing is rasterized on the CPU, the bars are a handful of rectangles that the renderer draws straight
+ * into the window. The widget only ticks while it is mapped.
+ */
+struct _AudiolizeVisualizer
+{
+	GtkWidget parent_instance;
+
+	// Source to take the bar levels from
+	AudiolizeSpectrumSource *source;
+	// Sequence number of the last frame read from `source`
+	guint64 sequence;
+	// Capture time of the last frame read from `source`, until the window takes it once the frame is painted
+	gint64 shown_capture_time;
+
+	// Levels to animate towards, as fractions of the widget height
+	float target_levels[AUDIOLIZE_SPECTRUM_SOURCE_MAX_BARS];
+	// Levels drawn in the last frame
+	float current_levels[AUDIOLIZE_SPECTRUM_SOURCE_MAX_BARS];
+	// Number of bars in the last analysis frame
+	int bars;
+
+	// Frame clock time of the last frame, 0 if nothing was drawn since the widget was mapped
+	gint64 last_frame_time;
+	// ID of the tick callback, 0 while the widget is unmapped
+	guint tick_id;
+};
+
+G_DEFINE_FINAL_TYPE(AudiolizeVisualizer, audiolize_visualizer, GTK_TYPE_WIDGET)
+
+// Move the bars towards the newest analysis frame, called once per display refresh.
+static gboolean
+audiolize_visualizer_tick_cb(GtkWidget *widget,
+							 GdkFrameClock *frame_clock,
+							 gpointer user_data)
+{
+	AudiolizeVisualizer *self = AUDIOLIZE_VISUALIZER(widget);
+	gint64 frame_time;
+	double step;
+	int bars;
+
+	if (self->source == NULL)
+		return G_SOURCE_CONTINUE;
+
+	bars = audiolize_spectrum_source_read_levels(self->source, &self->sequence, self->target_levels,
+												 &self->shown_capture_time);
+	if (bars > 0)
+		self->bars = bars;
+
+	// Step by the fraction of the analysis interval that passed, independent of the refresh rate
+	frame_time = gdk_frame_clock_get_frame_time(frame_clock);
+	if (self->last_frame_time == 0)
+		step = 1.0;
+	else
+		step = MIN((frame_time - self->last_frame_time) / audiolize_spectrum_source_get_frame_interval(self->source), 1.0);
+	self->last_frame_time = frame_time;
+
+	for (int i = 0; i < self->bars; i++)
+		self->current_levels[i] += (self->target_levels[i] - self->current_levels[i]) * step;
+
+	gtk_widget_queue_draw(widget);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+audiolize_visualizer_snapshot(GtkWidget *widget,
+							  GtkSnapshot *snapshot)
+{
+	AudiolizeVisualizer *self = AUDIOLIZE_VISUALIZER(widget);
+	gint64 start = probe_now();
+
+	audiolize_bars_snapshot(snapshot,
+							gtk_widget_get_width(widget),
+							gtk_widget_get_height(widget),
+							self->current_levels,
+							self->bars);
+
+	probe_record_since(PROBE_RENDER, start);
+}
+
+// Start ticking once the widget is on screen.
+static void
+audiolize_visualizer_map(GtkWidget *widget)
+{
+	AudiolizeVisualizer *self = AUDIOLIZE_VISUALIZER(widget);
+
+	GTK_WIDGET_CLASS(audiolize_visualizer_parent_class)->map(widget);
+
+	self->last_frame_time = 0;
+	self->tick_id = gtk_widget_add_tick_callback(widget, audiolize_visualizer_tick_cb, NULL, NULL);
+}
+
+// Stop ticking while the widget isn't visible.
+static void
+audiolize_visualizer_unmap(GtkWidget *widget)
+{
+	AudiolizeVisualizer *self = AUDIOLIZE_VISUALIZER(widget);
+
+	if (self->tick_id != 0)
+	{
+		gtk_widget_remove_tick_callback(widget, self->tick_id);
+		self->tick_id = 0;
+	}
+
+	GTK_WIDGET_CLASS(audiolize_visualizer_parent_class)->unmap(widget);
+}
+
+static void
+audiolize_visualizer_dispose(GObject *gobject)
+{
+	AudiolizeVisualizer *self = AUDIOLIZE_VISUALIZER(gobject);
+
+	g_clear_object(&(self->source));
+
+	G_OBJECT_CLASS(audiolize_visualizer_parent_class)->dispose(gobject);
+}
+
+static void
+audiolize_visualizer_class_init(AudiolizeVisualizerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+	object_class->dispose = audiolize_visualizer_dispose;
+
+	widget_class->snapshot = audiolize_visualizer_snapshot;
+	widget_class->map = audiolize_visualizer_map;
+	widget_class->unmap = audiolize_visualizer_unmap;
+}
+
+static void
+audiolize_visualizer_init(AudiolizeVisualizer *self)
+{
+	// Loud bars are clipped at the top of the widget instead of drawing over the header bar
+	gtk_widget_set_overflow(GTK_WIDGET(self), GTK_OVERFLOW_HIDDEN);
+	gtk_widget_set_hexpand(GTK_WIDGET(self), TRUE);
+	gtk_widget_set_vexpand(GTK_WIDGET(self), TRUE);
+}
+
+void audiolize_visualizer_set_source(AudiolizeVisualizer *self, AudiolizeSpectrumSource *source)
+{
+	if (!g_set_object(&(self->source), source))
+		return;
+
+	// Start over, the new source numbers its frames on its own
+	self->sequence = 0;
+	self->shown_capture_time = 0;
+	self->bars = 0;
+	memset(self->current_levels, 0, sizeof(self->current_levels));
+	gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+gint64 audiolize_visualizer_take_shown_capture_time(AudiolizeVisualizer *self)
+{
+	gint64 capture_time = self->shown_capture_time;
+
+	self->shown_capture_time = 0;
+	return capture_time;
+}
@@ -0,0 +1,48 @@
+/* audiolize-visualizer.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+#include <fft/spectrum-source.h>
+
+G_BEGIN_DECLS
+
+#define AUDIOLIZE_TYPE_VISUALIZER (audiolize_visualizer_get_type())
+
+G_DECLARE_FINAL_TYPE (AudiolizeVisualizer, audiolize_visualizer, AUDIOLIZE, VISUALIZER, GtkWidget)
+
+/**
+ * Set the source the visualizer takes its bar levels from.
+ *
+ * @param `source` live FFT or spectrum file to show, or NULL to show nothing
+ */
+void audiolize_visualizer_set_source(AudiolizeVisualizer *self, AudiolizeSpectrumSource *source);
+
+/**
+ * Get when the audio of the last frame the visualizer read was captured, once it has been painted.
+ *
+ * Every visualizer keeps its own, so each window times the frames it shows itself. This must only be called from the
+ * main thread, and only once per painted frame.
+ *
+ * @returns the `probe_now` capture time in nanoseconds, or 0 if no frame with a known capture time was read
+ * since the last call
+ */
+gint64 audiolize_visualizer_take_shown_capture_time(AudiolizeVisualizer *self);
+
+G_END_DECLS
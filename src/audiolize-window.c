@@ -19,8 +19,10 @@
 #include "config.h"
 
 #include "audiolize-window.h"
-#include <audio-driver/audio-driver.h>
-#include <fft/fft.h>
+#include "audiolize-visualizer.h"
+#include "audiolize-cairo-view.h"
+#include "audiolize-performance-overlay.h"
+#include <probes/probes.h>
 
 struct _AudiolizeWindow
 {
@@ -29,17 +31,83 @@ struct _AudiolizeWindow
 	/* Template widgets */
 
 	GtkDropDown *devices_list;
-	GtkDrawingArea *drawing_area;
-
-	// Audio driver used to handle input
-	AudioDriver *audio_driver;
-
-	// FFT struct to handle Fourier Transform
-	AudiolizeFFT *fft;
+	GtkStack *view_stack;
+	AudiolizeVisualizer *visualizer;
+	AudiolizeCairoView *cairo_view;
+	AudiolizePerformanceOverlay *performance_overlay;
+
+	// Frame clock the paint handlers are connected to, NULL while the window is unrealized
+	GdkFrameClock *frame_clock;
+	gulong paint_handler;
+	gulong after_paint_handler;
+	// Time the paint phase of the current frame started at, in nanoseconds
+	gint64 paint_start;
 };
 
 G_DEFINE_FINAL_TYPE(AudiolizeWindow, audiolize_window, ADW_TYPE_APPLICATION_WINDOW)
 
+static void
+audiolize_window_paint_cb(GdkFrameClock *frame_clock, gpointer user_data)
+{
+	AudiolizeWindow *self = user_data;
+
+	self->paint_start = probe_now();
+}
+
+/**
+ * Time the paint phase, and the latency of the audio shown in the frame that was just painted.
+ *
+ * The frame reaches the screen at its predicted presentation time, or right away if the display doesn't
+ * predict one.
+ */
+static void
+audiolize_window_after_paint_cb(GdkFrameClock *frame_clock, gpointer user_data)
+{
+	AudiolizeWindow *self = user_data;
+	GdkFrameTimings *timings;
+	gint64 now = probe_now(), presentation_time = 0, capture_time;
+
+	probe_record(PROBE_PAINT, now - self->paint_start);
+
+	// Only the visible view reads frames, but both are taken from so neither keeps a stale capture time
+	capture_time = audiolize_visualizer_take_shown_capture_time(self->visualizer);
+	capture_time = MAX(capture_time, audiolize_cairo_view_take_shown_capture_time(self->cairo_view));
+	if (capture_time == 0)
+		return;
+
+	timings = gdk_frame_clock_get_current_timings(frame_clock);
+	if (timings != NULL)
+		presentation_time = gdk_frame_timings_get_predicted_presentation_time(timings) * 1000;
+
+	probe_record(PROBE_AUDIO_TO_PHOTON, MAX(presentation_time, now) - capture_time);
+}
+
+static void
+audiolize_window_realize(GtkWidget *widget)
+{
+	AudiolizeWindow *self = AUDIOLIZE_WINDOW(widget);
+
+	GTK_WIDGET_CLASS(audiolize_window_parent_class)->realize(widget);
+
+	self->frame_clock = g_object_ref(gtk_widget_get_frame_clock(widget));
+	self->paint_handler = g_signal_connect(self->frame_clock, "paint",
+										   G_CALLBACK(audiolize_window_paint_cb), self);
+	self->after_paint_handler = g_signal_connect(self->frame_clock, "after-paint",
+												 G_CALLBACK(audiolize_window_after_paint_cb), self);
+}
+
+static void
+audiolize_window_unrealize(GtkWidget *widget)
+{
+	AudiolizeWindow *self = AUDIOLIZE_WINDOW(widget);
+
+	g_clear_signal_handler(&(self->paint_handler), self->frame_clock);
+	g_clear_signal_handler(&(self->after_paint_handler), self->frame_clock);
+	g_clear_object(&(self->frame_clock));
+
+	GTK_WIDGET_CLASS(audiolize_window_parent_class)->unrealize(widget);
+}
+
 static void
 audiolize_window_dispose(GObject *gobject)
 {
@@ -53,12 +121,7 @@ audiolize_window_dispose(GObject *gobject)
 static void
 audiolize_window_finalize(GObject *gobject)
 {
-	AudiolizeWindow *self = AUDIOLIZE_WINDOW(gobject);
-
 	g_print("Destroying...\n");
-	audiolize_fft_cancel_task(self->fft);
-	g_clear_object(&(self->fft));
-	audio_driver_close(&(self->audio_driver));
 
 	G_OBJECT_CLASS(audiolize_window_parent_class)->finalize(gobject);
 }
@@ -71,9 +134,19 @@ audiolize_window_class_init(AudiolizeWindowClass *klass)
 	G_OBJECT_CLASS(klass)->dispose = audiolize_window_dispose;
 	G_OBJECT_CLASS(klass)->finalize = audiolize_window_finalize;
 
+	widget_class->realize = audiolize_window_realize;
+	widget_class->unrealize = audiolize_window_unrealize;
+
+	g_type_ensure(AUDIOLIZE_TYPE_VISUALIZER);
+	g_type_ensure(AUDIOLIZE_TYPE_CAIRO_VIEW);
+	g_type_ensure(AUDIOLIZE_TYPE_PERFORMANCE_OVERLAY);
+
 	gtk_widget_class_set_template_from_resource(widget_class, "/io/bricksigma/Audiolize/audiolize-window.ui");
 	gtk_widget_class_bind_template_child(widget_class, AudiolizeWindow, devices_list);
-	gtk_widget_class_bind_template_child(widget_class, AudiolizeWindow, drawing_area);
+	gtk_widget_class_bind_template_child(widget_class, AudiolizeWindow, view_stack);
+	gtk_widget_class_bind_template_child(widget_class, AudiolizeWindow, visualizer);
+	gtk_widget_class_bind_template_child(widget_class, AudiolizeWindow, cairo_view);
+	gtk_widget_class_bind_template_child(widget_class, AudiolizeWindow, performance_overlay);
 }
 
 static void
@@ -119,26 +192,18 @@ device_factory_bind_cb(GtkSignalListItemFactory *self,
 	gtk_label_set_text(GTK_LABEL(label), gtk_string_object_get_string(name));
 }
 
-// Initialize the list of portaudio devices connected in the UI
+/**
+ * Initialize the list of portaudio devices connected in the UI.
+ *
+ * The list is shared with the application, it's filled in once the audio driver has loaded the devices.
+ */
 static void
-initialize_device_list(AudiolizeWindow *self)
+initialize_device_list(AudiolizeWindow *self, GListModel *devices)
 {
-	int num_devices;
-	GtkStringList *device_names;
 	GtkListItemFactory *factory;
 
-	num_devices = self->audio_driver->num_devices;
-
-	// Setup the list model for the drop down menu
-	device_names = gtk_string_list_new(NULL);
-	for (int i = 0; i < num_devices; i++)
-	{
-		gtk_string_list_append(device_names, self->audio_driver->devices[i]->name);
-	}
-
 	// Add the string list model to the drop down
-	gtk_drop_down_set_model(self->devices_list, G_LIST_MODEL(device_names));
-	g_object_unref(device_names);
+	gtk_drop_down_set_model(self->devices_list, devices);
 
 	// Let's also setup a custom list factory so that the text is cut short with ellipses
 	factory = gtk_signal_list_item_factory_new();
@@ -159,108 +224,62 @@ initialize_device_list(AudiolizeWindow *self)
 	g_object_unref(factory);
 }
 
-/**
- * Resize callback function for the drawing area.
- *
- * @param user_data should be the FFT struct pointer (`AudiolizeFFT **`) to do a NULL check
- * and ensure it exists
- */
-static void
-drawing_area_resize_cb(GtkDrawingArea *drawing_area,
-					   gint width,
-					   gint height,
-					   gpointer user_data)
-{
-	AudiolizeFFT **fft = user_data;
-
-	if (*fft == NULL)
-		return;
-
-	audiolize_fft_resize_surface(*fft, width, height);
-}
-
+// Initialize the window.
 static void
-audiolize_window_draw_function(GtkDrawingArea *drawing_area,
-							   cairo_t *cr,
-							   int width,
-							   int height,
-							   gpointer user_data)
+audiolize_window_init(AudiolizeWindow *self)
 {
-	// Pass a double pointer to check if it's NULL
-	AudiolizeFFT **fft = (AudiolizeFFT **)user_data;
+	g_autoptr(GPropertyAction) show_timings = NULL;
 
-	if (*fft == NULL)
-		return;
+	gtk_widget_init_template(GTK_WIDGET(self));
 
-	// Copy the FFT surface to the drawing area
-	audiolize_fft_paint_surface(*fft, cr, width, height);
+	// The overlay is toggled by its visibility, it only gathers timings while it's shown
+	show_timings = g_property_action_new("show-timings", self->performance_overlay, "visible");
+	g_action_map_add_action(G_ACTION_MAP(self), G_ACTION(show_timings));
 }
 
 /**
- * Used to connect the drawing area to the AudiolizeFFT's Cairo surface.
+ * Connect the window to the audio input and FFT of the application, or to the spectrum file it plays back.
  *
- * This should be called once the FFT object has been created/initialized.
+ * @note This MUST be called immediately after the window is created in the `audiolize_window_new` function.
  */
 static void
-audiolize_window_connect_drawing_area(AudiolizeWindow *self)
-{
-	if (self->fft == NULL)
-		return;
-
-	gtk_drawing_area_set_draw_func(self->drawing_area, audiolize_window_draw_function, &(self->fft), NULL);
-	g_signal_connect(self->drawing_area, "resize", G_CALLBACK(drawing_area_resize_cb), &(self->fft));
-}
-
-// Callback used to update the input stream device for portaudio.
-static void
-selected_device_changed_cb(GtkDropDown *drop_down,
-						   GParamSpec *pspec,
-						   AudiolizeWindow *self)
+audiolize_window_setup(AudiolizeWindow *self, AudiolizeApplication *app)
 {
-	guint selected = gtk_drop_down_get_selected(drop_down);
-
-	audio_driver_set_selected_device(self->audio_driver, selected);
+	AudiolizeSpectrumSource *source = audiolize_application_get_source(app);
+	GListModel *devices = audiolize_application_get_devices(app);
 
-	audiolize_fft_cancel_task(self->fft);
-	g_clear_object(&(self->fft));
-	self->fft = audiolize_fft_new(self->audio_driver->selected_device->defaultSampleRate,
-								  self->audio_driver->ring_buffer,
-								  self->drawing_area);
-
-	// Reconnect the drawing area to the new FFT object.
-	audiolize_window_connect_drawing_area(self);
-
-	// Redraw the surface again
-	gtk_widget_queue_resize(GTK_WIDGET(self->drawing_area));
-}
-
-// Initialize the window.
-static void
-audiolize_window_init(AudiolizeWindow *self)
-{
-	gtk_widget_init_template(GTK_WIDGET(self));
+	if (devices != NULL)
+	{
+		// Initialize the device list UI
+		initialize_device_list(self, devices);
 
-	// Initialize the audio driver
-	self->audio_driver = audio_driver_new();
-	if (self->audio_driver == NULL)
+		// The selected device is shared by every window, changing it here switches the input for all of them
+		g_object_bind_property(app, "device",
+							   self->devices_list, "selected",
+							   G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+	}
+	else
 	{
-		g_abort();
-		return;
+		// A spectrum file is played back, there is no input to choose
+		gtk_widget_set_visible(GTK_WIDGET(self->devices_list), FALSE);
 	}
 
-	// Initialize the device list UI
-	initialize_device_list(self);
+	// Both views read from the same source, only the visible one ever renders
+	audiolize_visualizer_set_source(self->visualizer, source);
+	audiolize_cairo_view_set_source(self->cairo_view, source);
 
-	// Setup a callback for when the selected device is changed
-	g_signal_connect_after(self->devices_list, "notify::selected", G_CALLBACK(selected_device_changed_cb), self);
+	// The bars are drawn as render nodes, the old Cairo surface path is kept around as a fallback
+	if (g_strcmp0(g_getenv("AUDIOLIZE_RENDERER"), "cairo") == 0)
+		gtk_stack_set_visible_child_name(self->view_stack, "cairo");
+}
 
-	// Open the input stream
-	audio_driver_open_stream(self->audio_driver);
+AudiolizeWindow *audiolize_window_new(AudiolizeApplication *app)
+{
+	AudiolizeWindow *window = AUDIOLIZE_WINDOW(g_object_new(AUDIOLIZE_TYPE_WINDOW,
+															 "application", app,
+															 NULL));
 
-	// Startup the FFT thread
-	self->fft = audiolize_fft_new(self->audio_driver->selected_device->defaultSampleRate,
-								  self->audio_driver->ring_buffer,
-								  self->drawing_area);
+	audiolize_window_setup(window, app);
 
-	audiolize_window_connect_drawing_area(self);
+	return window;
 }
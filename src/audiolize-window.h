@@ -19,6 +19,7 @@
 #pragma once
 
 #include <adwaita.h>
+#include "audiolize-application.h"
 
 G_BEGIN_DECLS
 
@@ -26,4 +27,7 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE (AudiolizeWindow, audiolize_window, AUDIOLIZE, WINDOW, AdwApplicationWindow)
 
+// Create a new window showing the audio input of `app`.
+AudiolizeWindow *audiolize_window_new(AudiolizeApplication *app);
+
 G_END_DECLS
@@ -0,0 +1,1072 @@
+/* analysis-core.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fft/analysis-core.h>
+#include <fft/band-kernel.h>
+#include <memory/allocation-guard.h>
+#include <memory/memory-arena.h>
+#include <probes/probes.h>
+
+#include <glib/gstdio.h>
+#include <math.h>
+#include <string.h>
+
+// Range of levels shown in dB, a band this far below the ceiling is at 0
+#define DYNAMIC_RANGE_DB (60.0f)
+
+// How far the ceiling stays above the loudest band when the gain is automatic, in dB
+#define AUTO_GAIN_HEADROOM_DB (3.0f)
+
+// How fast the automatic ceiling falls back after the music got quieter, in dB per second
+#define AUTO_GAIN_RELEASE_DB (6.0f)
+
+// Lowest automatic ceiling in dBFS, so silence and noise floors aren't blown up to full height
+#define AUTO_GAIN_MIN_CEILING_DB (-50.0f)
+
+// Smallest band power, keeps the logarithm of silent bands finite
+#define MIN_POWER (1e-12f)
+
+// Number of windows the multi-resolution analysis runs, each with a plan of its own
+#define MAX_TIERS (ANALYSIS_MAX_PLANS)
+
+// Length of the decimation filters in taps per unit of decimation. With a Blackman window this gives a
+// transition from a quarter to three quarters of the decimated sample rate, so nothing aliases below a quarter.
+#define DECIMATION_TAPS_PER_FACTOR (11)
+
+// Smallest window of a decimated tier in decimated samples, below this the bass would get too few bins
+#define MIN_TIER_WINDOW_SIZE (64)
+
+/**
+ * One of the windows of the multi-resolution analysis.
+ *
+ * Long windows only need the bass, so their input is low passed and decimated first which makes the FFT
+ * shorter by the same factor. Every tier has its own plan and band weights, the bands it doesn't take are empty.
+ * Its arrays are carved from the arena of the state it belongs to.
+ */
+typedef struct
+{
+    // Factor the input is decimated by, 1 for the input itself
+    int decimation;
+    // Number of decimated samples in each window
+    int window_size;
+    // Low pass filter applied before decimating, `taps` coefficients, NULL when `decimation` is 1
+    float *filter;
+    int taps;
+
+    // Sliding history of the last `window_size` decimated samples of each analysed channel, interleaved,
+    // NULL when `decimation` is 1 and the window is read straight from the history of the core
+    float *history;
+    // Coefficients of the window function, repeated for each analysed channel
+    float *window_coefficients;
+    // Array of interleaved samples to input to FFTW
+    float *samples;
+    // FFT output array, holding `window_size / 2 + 1` bins for each analysed channel one after the other
+    fftwf_complex *out;
+    fftwf_plan plan;
+
+    // Bin weights of the bands taken by this tier, the others have no bins
+    BandMatrix band_matrix;
+    // Scale turning the band powers into powers relative to a full scale sine wave
+    float power_scale;
+} AnalysisTier;
+
+// Windows of the multi-resolution tiers from the longest to the shortest, and the highest frequency of the bands
+// each one takes. The shortest takes whatever is left.
+static const struct
+{
+    AnalysisPreset window;
+    double top_frequency;
+} analysis_tier_layout[MAX_TIERS] = {
+    {ANALYSIS_PRESET_HIGH_RESOLUTION, 250},
+    {ANALYSIS_PRESET_BALANCED, 2000},
+    {ANALYSIS_PRESET_LOW_LATENCY, G_MAXDOUBLE},
+};
+
+/**
+ * Buffers, tables and plans of one shape of the analysis, carved from a single arena along with the state itself.
+ *
+ * The shape is everything their sizes depend on: the window size and the number of analysed channels, and the tiers
+ * of the multi-resolution analysis which also depend on the sample rate and hop size. A configuration of another
+ * shape gets a new state that is completely built before it replaces the old one, so processing never allocates.
+ */
+typedef struct
+{
+    // Arena the state was carved from
+    MemoryArena arena;
+
+    // Bin weights of each band, precomputed from the layout, sample rate and window size
+    BandMatrix band_matrix;
+
+    // Coefficients of the window function, repeated for each analysed channel so they line up with `history`
+    float *window_coefficients;
+
+    // Sliding history of the last `window_size` samples of each analysed channel, interleaved
+    float *history;
+
+    // FFT output array, holding `window_size / 2 + 1` bins for each analysed channel one after the other
+    fftwf_complex *out;
+    // FFTW plan
+    fftwf_plan fftw_plan;
+    // Whether `fftw_plan` or any plan of the tiers was estimated rather than measured or taken from wisdom
+    gboolean estimated_plan;
+    // Array of interleaved samples to input to FFTW
+    float *samples;
+
+    // Tiers of the multi-resolution analysis, none when a single window is used
+    AnalysisTier tiers[MAX_TIERS];
+    int tier_count;
+} AnalysisState;
+
+struct _AnalysisCore
+{
+    // Configuration in use
+    AnalysisConfig config;
+
+    // Channel mode actually in use, which differs from the configured one when the input can't support it
+    AnalysisChannelMode analysis_mode;
+    // Number of channels analysed by the batched plan and sent to the output
+    int analysis_channels;
+
+    // Arrays and plans for the current shape of the analysis, only replaced while configuring
+    AnalysisState *state;
+
+    // Center frequency of each band in Hz
+    float band_frequency[BAND_LAYOUT_MAX_BANDS];
+    // Gain of the frequency weighting for each band in dB
+    float band_weight_db[BAND_LAYOUT_MAX_BANDS];
+
+    // Level in dBFS shown at the top of the output
+    float ceiling_db;
+    // Kernel computing the weighted power of each band, chosen at runtime for the CPU
+    BandKernel band_kernel;
+
+    // Number of samples collected since the last analysis
+    int hop_fill;
+    // Time spent converting the samples collected since the last analysis, in nanoseconds
+    gint64 convert_time;
+
+    // Band levels of the last analysis frame
+    float levels[ANALYSIS_MAX_VALUES];
+    // Band powers of a single tier, before they are added to `levels`
+    float tier_levels[ANALYSIS_MAX_VALUES];
+};
+
+// The FFTW planner and wisdom functions are not thread safe, only `fftwf_execute` is.
+G_LOCK_DEFINE_STATIC(fftw_planner);
+
+// Get the path of the FFTW wisdom cache file. The result must be freed with `g_free`.
+static gchar *
+analysis_plan_get_wisdom_path(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), "audiolize", "fftwf-wisdom", NULL);
+}
+
+// Load the cached wisdom into FFTW. Only the first call does any work, the planner lock must be held.
+static void
+analysis_plan_import_wisdom(void)
+{
+    static gboolean imported = FALSE;
+    gchar *path;
+
+    if (imported)
+        return;
+
+    path = analysis_plan_get_wisdom_path();
+
+    // A missing or unreadable cache just means we have to plan from scratch
+    if (fftwf_import_wisdom_from_filename(path))
+        g_print("Loaded FFTW wisdom from %s\n", path);
+
+    g_free(path);
+    imported = TRUE;
+}
+
+void analysis_plan_export_wisdom(void)
+{
+    gchar *path;
+    gchar *dir;
+
+    path = analysis_plan_get_wisdom_path();
+    dir = g_path_get_dirname(path);
+
+    if (g_mkdir_with_parents(dir, 0755) != 0)
+        fprintf(stderr, "ERROR: Could not create FFTW wisdom directory %s\n", dir);
+    else
+    {
+        G_LOCK(fftw_planner);
+        if (!fftwf_export_wisdom_to_filename(path))
+            fprintf(stderr, "ERROR: Could not save FFTW wisdom to %s\n", path);
+        G_UNLOCK(fftw_planner);
+    }
+
+    g_free(dir);
+    g_free(path);
+}
+
+fftwf_plan analysis_plan_new(int n, int channels, unsigned int flags)
+{
+    fftwf_plan plan;
+    float *in;
+    fftwf_complex *out;
+    int bins = n / 2 + 1;
+
+    // Planning is done on scratch arrays since measuring planners overwrite their buffers,
+    // the plan must therefore be run with `fftwf_execute_dft_r2c` on arrays at least as aligned as `fftwf_malloc`'s.
+    in = (float *)fftwf_malloc(sizeof(float) * n * channels);
+    out = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * bins * channels);
+
+    G_LOCK(fftw_planner);
+    analysis_plan_import_wisdom();
+    // Looking wisdom up and estimating are quick anyway, only a measuring search ever reaches the limit
+    fftwf_set_timelimit(ANALYSIS_PLANNER_TIME_LIMIT);
+    plan = fftwf_plan_many_dft_r2c(1, &n, channels,
+                                   in, NULL, channels, 1,
+                                   out, NULL, 1, bins,
+                                   flags);
+    G_UNLOCK(fftw_planner);
+
+    fftwf_free(out);
+    fftwf_free(in);
+
+    return plan;
+}
+
+void analysis_plan_destroy(fftwf_plan plan)
+{
+    if (plan == NULL)
+        return;
+
+    G_LOCK(fftw_planner);
+    fftwf_destroy_plan(plan);
+    G_UNLOCK(fftw_planner);
+}
+
+// Window and hop sizes of the presets at `ANALYSIS_PRESET_SAMPLE_RATE`, indexed by `AnalysisPreset`
+static const struct
+{
+    int window_size;
+    int hop_size;
+} analysis_presets[] = {
+    [ANALYSIS_PRESET_LOW_LATENCY] = {512, 256},
+    [ANALYSIS_PRESET_BALANCED] = {2048, 512},
+    [ANALYSIS_PRESET_HIGH_RESOLUTION] = {8192, 1024},
+    // The window holds enough history for the longest tier, frames come as often as with the balanced preset
+    [ANALYSIS_PRESET_MULTI_RESOLUTION] = {8192, 512},
+};
+
+// Get the power of two closest to `size` in ratio, so 44.1 kHz keeps the sizes of 48 kHz.
+static int
+analysis_round_to_power_of_two(double size)
+{
+    int power = 1;
+
+    while (power * 2 <= size)
+        power *= 2;
+
+    // `size` lies between `power` and twice it, pick whichever is closer in ratio
+    return size * size > (double)power * power * 2 ? power * 2 : power;
+}
+
+void analysis_config_apply_preset(AnalysisConfig *config, AnalysisPreset preset)
+{
+    guint sample_rate = config->sample_rate != 0 ? config->sample_rate : ANALYSIS_PRESET_SAMPLE_RATE;
+    double scale = (double)sample_rate / ANALYSIS_PRESET_SAMPLE_RATE;
+
+    config->preset = preset;
+    config->window_size = analysis_round_to_power_of_two(analysis_presets[preset].window_size * scale);
+    config->window_size = CLAMP(config->window_size, ANALYSIS_MIN_WINDOW_SIZE, ANALYSIS_MAX_WINDOW_SIZE);
+
+    // Clamping the window mustn't lower the overlap, so the hop is limited to the same fraction of it
+    config->hop_size = analysis_round_to_power_of_two(analysis_presets[preset].hop_size * scale);
+    config->hop_size = MIN(config->hop_size, config->window_size / (analysis_presets[preset].window_size /
+                                                                    analysis_presets[preset].hop_size));
+}
+
+void analysis_config_init(AnalysisConfig *config, guint sample_rate, int input_channels)
+{
+    *config = (AnalysisConfig){
+        .sample_rate = sample_rate,
+        .input_channels = input_channels,
+        .channel_mode = ANALYSIS_CHANNELS_MONO,
+        .band_layout = BAND_LAYOUT_CLASSIC,
+        .bands = ANALYSIS_DEFAULT_BANDS,
+        .window_function = WINDOW_FUNCTION_HANN,
+        .weighting = BAND_WEIGHTING_NONE,
+        .auto_gain = TRUE,
+    };
+    analysis_config_apply_preset(config, ANALYSIS_PRESET_BALANCED);
+}
+
+/**
+ * Create a plan of a state for transforms of length `n` over the analysed channels.
+ *
+ * Cached wisdom is used when available. Otherwise the state starts with an estimated plan so the first frame
+ * isn't delayed, and it's up to the caller to replace it with a measured plan.
+ */
+static fftwf_plan
+analysis_core_plan_new(AnalysisCore *core, AnalysisState *state, int n)
+{
+    fftwf_plan plan = NULL;
+
+    if (ANALYSIS_PLANNER_FLAGS != 0)
+        plan = analysis_plan_new(n, core->analysis_channels, ANALYSIS_PLANNER_FLAGS | FFTW_WISDOM_ONLY);
+
+    if (plan == NULL)
+    {
+        plan = analysis_plan_new(n, core->analysis_channels, FFTW_ESTIMATE);
+        state->estimated_plan = state->estimated_plan || ANALYSIS_PLANNER_FLAGS != 0;
+    }
+
+    return plan;
+}
+
+// Fill in `size` window function coefficients for each of `channels` interleaved channels.
+static void
+analysis_fill_window(WindowFunction function, float *coefficients, int size, int channels)
+{
+    // Fill in the first channel's worth, then spread each coefficient out over every channel from the back
+    window_function_fill(function, coefficients, size);
+    for (int i = size - 1; i >= 0; i--)
+    {
+        for (int c = channels - 1; c >= 0; c--)
+            coefficients[i * channels + c] = coefficients[i];
+    }
+}
+
+// Compute the window function coefficients of a state for the current window size and number of analysed channels.
+static void
+analysis_core_compute_window(AnalysisCore *core, AnalysisState *state)
+{
+    if (state->tier_count > 0)
+    {
+        for (int t = 0; t < state->tier_count; t++)
+            analysis_fill_window(core->config.window_function, state->tiers[t].window_coefficients,
+                                 state->tiers[t].window_size, core->analysis_channels);
+        return;
+    }
+
+    analysis_fill_window(core->config.window_function, state->window_coefficients,
+                         core->config.window_size, core->analysis_channels);
+}
+
+/**
+ * Give every band to the longest tier whose top frequency it stays under, and empty it in the other tiers.
+ *
+ * Each tier lays the bands out for its own FFT, so the bands and their center frequencies are the same in all
+ * of them and only the bins differ.
+ */
+static void
+analysis_core_compute_tier_bands(AnalysisCore *core, AnalysisState *state)
+{
+    const BandMatrix *matrix = &state->band_matrix;
+    double hz_per_bin = (double)core->config.sample_rate / core->config.window_size;
+    float frequencies[BAND_LAYOUT_MAX_BANDS];
+    int band_tier[BAND_LAYOUT_MAX_BANDS];
+
+    for (int i = 0; i < matrix->bands; i++)
+    {
+        // Frequency of the highest bin of the band, in the spectrum of the longest window
+        double top = (matrix->band_start[i] + MAX(matrix->band_length[i], 1) - 1) * hz_per_bin;
+
+        band_tier[i] = 0;
+        while (band_tier[i] < state->tier_count - 1 && top > analysis_tier_layout[band_tier[i]].top_frequency)
+            band_tier[i]++;
+    }
+
+    for (int t = 0; t < state->tier_count; t++)
+    {
+        AnalysisTier *tier = &state->tiers[t];
+
+        band_layout_build_decimated(&tier->band_matrix, frequencies,
+                                    core->config.band_layout, core->config.bands, core->config.sample_rate,
+                                    tier->window_size, tier->decimation);
+
+        for (int i = 0; i < tier->band_matrix.bands; i++)
+        {
+            if (band_tier[i] != t)
+                tier->band_matrix.band_length[i] = 0;
+        }
+    }
+}
+
+// Compute the bin weights and frequency weighting of every band for the current layout, sample rate and window size.
+static void
+analysis_core_compute_band_table(AnalysisCore *core, AnalysisState *state)
+{
+    band_layout_build(&state->band_matrix, core->band_frequency,
+                      core->config.band_layout, core->config.bands,
+                      core->config.sample_rate, core->config.window_size);
+
+    for (int i = 0; i < state->band_matrix.bands; i++)
+        core->band_weight_db[i] = band_layout_get_weighting(core->config.weighting, core->band_frequency[i]);
+
+    if (state->tier_count > 0)
+        analysis_core_compute_tier_bands(core, state);
+}
+
+// Compute the low pass of a tier, a Blackman windowed sinc cut off at the nyquist frequency after decimation.
+static void
+analysis_tier_compute_filter(AnalysisTier *tier)
+{
+    double center = (tier->taps - 1) / 2.0;
+    double sum = 0;
+
+    for (int i = 0; i < tier->taps; i++)
+    {
+        double x = (i - center) / tier->decimation;
+        double phase = 2.0 * G_PI * i / (tier->taps - 1);
+        double sinc = x == 0 ? 1.0 : sin(G_PI * x) / (G_PI * x);
+
+        tier->filter[i] = sinc * (0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase));
+        sum += tier->filter[i];
+    }
+
+    // Unity gain at 0 Hz, so the decimated bands come out as loud as the others
+    for (int i = 0; i < tier->taps; i++)
+        tier->filter[i] /= sum;
+}
+
+/**
+ * Get how far the input of a tier can be decimated.
+ *
+ * The decimated sample rate stays at least four times the top frequency of the tier so the filter leaves its
+ * bands alone, the factor divides the hop so every hop adds whole decimated samples, and the history of the
+ * core has to reach back over the filter for the first new sample of a hop.
+ */
+static int
+analysis_core_get_tier_decimation(AnalysisCore *core, int window_size, double top_frequency)
+{
+    int hop_size = core->config.hop_size;
+    int decimation = 1;
+
+    while (TRUE)
+    {
+        int next = decimation * 2;
+        int taps = DECIMATION_TAPS_PER_FACTOR * next + 1;
+
+        if (next > hop_size || window_size < hop_size ||
+            core->config.sample_rate / (double)next < 4.0 * top_frequency ||
+            window_size / next < MIN_TIER_WINDOW_SIZE ||
+            hop_size - next + taps > core->config.window_size)
+            break;
+
+        decimation = next;
+    }
+
+    return decimation;
+}
+
+/**
+ * Size the tiers of the multi-resolution analysis for the current sample rate, hop size and window size.
+ *
+ * Every tier keeps the window duration of its preset, decimated as far as its bands allow. Their arrays are
+ * carved and filled in later, the bands are given out by `analysis_core_compute_band_table`.
+ */
+static void
+analysis_core_size_tiers(AnalysisCore *core, AnalysisState *state)
+{
+    AnalysisConfig tier_config = core->config;
+
+    for (int t = 0; t < MAX_TIERS; t++)
+    {
+        AnalysisTier *tier = &state->tiers[t];
+        int window_size;
+
+        analysis_config_apply_preset(&tier_config, analysis_tier_layout[t].window);
+        window_size = MIN(tier_config.window_size, core->config.window_size);
+
+        tier->decimation = analysis_core_get_tier_decimation(core, window_size, analysis_tier_layout[t].top_frequency);
+        tier->window_size = window_size / tier->decimation;
+        tier->power_scale = 4.0f / ((float)tier->window_size * (float)tier->window_size);
+        tier->taps = tier->decimation > 1 ? DECIMATION_TAPS_PER_FACTOR * tier->decimation + 1 : 0;
+    }
+
+    state->tier_count = MAX_TIERS;
+}
+
+/**
+ * Carve the arrays of a state out of an arena, for the current window size, analysed channels and tiers.
+ *
+ * This runs twice over the same state: once to measure the arena, then again once it has been allocated.
+ */
+static void
+analysis_core_carve_state(AnalysisCore *core, AnalysisState *state, MemoryArena *arena)
+{
+    int window_size = core->config.window_size;
+    int channels = core->analysis_channels;
+
+    state->history = memory_arena_carve_array(arena, float, window_size * channels);
+    band_layout_carve_matrix(&state->band_matrix, arena, window_size);
+
+    // The multi-resolution analysis runs on the arrays of its tiers instead of those of the whole window
+    if (state->tier_count > 0)
+    {
+        for (int t = 0; t < state->tier_count; t++)
+        {
+            AnalysisTier *tier = &state->tiers[t];
+
+            if (tier->decimation > 1)
+            {
+                tier->filter = memory_arena_carve_array(arena, float, tier->taps);
+                tier->history = memory_arena_carve_array(arena, float, tier->window_size * channels);
+            }
+
+            tier->window_coefficients = memory_arena_carve_array(arena, float, tier->window_size * channels);
+            tier->samples = memory_arena_carve_array(arena, float, tier->window_size * channels);
+            tier->out = memory_arena_carve_array(arena, fftwf_complex, (tier->window_size / 2 + 1) * channels);
+            band_layout_carve_matrix(&tier->band_matrix, arena, tier->window_size);
+        }
+        return;
+    }
+
+    state->window_coefficients = memory_arena_carve_array(arena, float, window_size * channels);
+    state->samples = memory_arena_carve_array(arena, float, window_size * channels);
+    state->out = memory_arena_carve_array(arena, fftwf_complex, (window_size / 2 + 1) * channels);
+}
+
+/**
+ * Build a state for the current configuration, with silent histories.
+ *
+ * Everything is sized and carved out of one allocation first, then the filters, window and band tables are
+ * computed and the plans made, one per tier or a single one for the whole window. The arrays are aligned beyond
+ * what `fftwf_malloc` guarantees, so the plans can run on them.
+ */
+static AnalysisState *
+analysis_core_new_state(AnalysisCore *core, gboolean multi_resolution)
+{
+    AnalysisState layout = {0};
+    AnalysisState *state;
+    MemoryArena arena;
+
+    if (multi_resolution)
+        analysis_core_size_tiers(core, &layout);
+
+    memory_arena_init(&arena);
+    memory_arena_carve(&arena, sizeof(AnalysisState));
+    analysis_core_carve_state(core, &layout, &arena);
+
+    if (!memory_arena_allocate(&arena))
+        g_error("Could not allocate %" G_GSIZE_FORMAT " bytes for the analysis", arena.used);
+
+    state = memory_arena_carve(&arena, sizeof(AnalysisState));
+    *state = layout;
+    analysis_core_carve_state(core, state, &arena);
+    state->arena = arena;
+
+    for (int t = 0; t < state->tier_count; t++)
+    {
+        AnalysisTier *tier = &state->tiers[t];
+
+        if (tier->decimation > 1)
+            analysis_tier_compute_filter(tier);
+        tier->plan = analysis_core_plan_new(core, state, tier->window_size);
+    }
+
+    if (state->tier_count == 0)
+        state->fftw_plan = analysis_core_plan_new(core, state, core->config.window_size);
+
+    analysis_core_compute_window(core, state);
+    analysis_core_compute_band_table(core, state);
+
+    return state;
+}
+
+static void
+analysis_state_free(AnalysisState *state)
+{
+    MemoryArena arena;
+
+    if (state == NULL)
+        return;
+
+    analysis_plan_destroy(state->fftw_plan);
+    for (int t = 0; t < state->tier_count; t++)
+        analysis_plan_destroy(state->tiers[t].plan);
+
+    // The state lives in its own arena, which has to be copied out before it's freed
+    arena = state->arena;
+    memory_arena_clear(&arena);
+}
+
+// Silence the histories of a state, so no audio from a previous input is mixed into the next windows.
+static void
+analysis_core_clear_history(AnalysisCore *core)
+{
+    AnalysisState *state = core->state;
+
+    memset(state->history, 0, sizeof(float) * core->config.window_size * core->analysis_channels);
+    for (int t = 0; t < state->tier_count; t++)
+    {
+        if (state->tiers[t].history != NULL)
+            memset(state->tiers[t].history, 0, sizeof(float) * state->tiers[t].window_size * core->analysis_channels);
+    }
+}
+
+gboolean analysis_core_configure(AnalysisCore *core, const AnalysisConfig *config)
+{
+    AnalysisConfig previous = core->config;
+    AnalysisChannelMode analysis_mode;
+    int input_channels, analysis_channels, window_size;
+    gboolean multi_resolution, resized, reshape;
+
+    g_return_val_if_fail((config->window_size % 2) == 0, FALSE);
+    g_return_val_if_fail(config->hop_size > 0 && config->hop_size <= config->window_size, FALSE);
+
+    input_channels = CLAMP(config->input_channels, 1, ANALYSIS_MAX_CHANNELS);
+    window_size = config->window_size;
+
+    // Mid/side needs a left and right channel, fall back to a mono mix when there is only one
+    analysis_mode = config->channel_mode;
+    if (analysis_mode == ANALYSIS_CHANNELS_MID_SIDE && input_channels < 2)
+        analysis_mode = ANALYSIS_CHANNELS_MONO;
+
+    switch (analysis_mode)
+    {
+    case ANALYSIS_CHANNELS_SEPARATE:
+        analysis_channels = input_channels;
+        break;
+    case ANALYSIS_CHANNELS_MID_SIDE:
+        analysis_channels = 2;
+        break;
+    case ANALYSIS_CHANNELS_MONO:
+    default:
+        analysis_channels = 1;
+        break;
+    }
+
+    // The multi-resolution analysis runs on the plans of its tiers instead of one for the whole window,
+    // and the decimation of the tiers also depends on the sample rate and hop
+    multi_resolution = config->preset == ANALYSIS_PRESET_MULTI_RESOLUTION;
+
+    resized = core->state == NULL ||
+              previous.window_size != window_size ||
+              core->analysis_channels != analysis_channels ||
+              multi_resolution != (core->state->tier_count > 0);
+    reshape = resized || (multi_resolution && (previous.sample_rate != config->sample_rate ||
+                                               previous.hop_size != config->hop_size));
+
+    core->config = *config;
+    core->config.input_channels = input_channels;
+    core->analysis_mode = analysis_mode;
+    core->analysis_channels = analysis_channels;
+
+    if (reshape)
+    {
+        AnalysisState *state = analysis_core_new_state(core, multi_resolution);
+
+        // The new state is complete, so swapping it in replaces the whole shape at once
+        analysis_state_free(core->state);
+        core->state = state;
+        core->hop_fill = 0;
+    }
+    else
+    {
+        if (previous.window_function != config->window_function)
+            analysis_core_compute_window(core, core->state);
+
+        // Don't mix audio from the previous input into the next windows
+        if (previous.sample_rate != config->sample_rate ||
+            previous.input_channels != input_channels ||
+            previous.channel_mode != config->channel_mode ||
+            previous.hop_size != config->hop_size)
+        {
+            analysis_core_clear_history(core);
+            core->hop_fill = 0;
+        }
+
+        analysis_core_compute_band_table(core, core->state);
+    }
+
+    if (resized || previous.auto_gain != config->auto_gain)
+        core->ceiling_db = config->auto_gain ? AUTO_GAIN_MIN_CEILING_DB : 0;
+
+    return reshape;
+}
+
+AnalysisCore *analysis_core_new(const AnalysisConfig *config)
+{
+    AnalysisCore *core = g_new0(AnalysisCore, 1);
+
+    core->band_kernel = band_kernel_get();
+    analysis_core_configure(core, config);
+
+    return core;
+}
+
+void analysis_core_free(AnalysisCore *core)
+{
+    if (core == NULL)
+        return;
+
+    analysis_state_free(core->state);
+    g_free(core);
+}
+
+void analysis_core_reset(AnalysisCore *core)
+{
+    analysis_core_clear_history(core);
+    core->hop_fill = 0;
+    core->convert_time = 0;
+    core->ceiling_db = core->config.auto_gain ? AUTO_GAIN_MIN_CEILING_DB : 0;
+}
+
+const AnalysisConfig *analysis_core_get_config(AnalysisCore *core)
+{
+    return &core->config;
+}
+
+int analysis_core_get_channels(AnalysisCore *core)
+{
+    return core->analysis_channels;
+}
+
+int analysis_core_get_buffered_frames(AnalysisCore *core)
+{
+    return core->hop_fill;
+}
+
+int analysis_core_get_bands(AnalysisCore *core)
+{
+    return core->state->band_matrix.bands;
+}
+
+const float *analysis_core_get_band_frequencies(AnalysisCore *core)
+{
+    return core->band_frequency;
+}
+
+gboolean analysis_core_is_plan_estimated(AnalysisCore *core)
+{
+    return core->state->estimated_plan;
+}
+
+int analysis_core_get_plan_count(AnalysisCore *core)
+{
+    return MAX(core->state->tier_count, 1);
+}
+
+int analysis_core_get_plan_size(AnalysisCore *core, int index)
+{
+    g_return_val_if_fail(index >= 0 && index < analysis_core_get_plan_count(core), 0);
+
+    if (core->state->tier_count > 0)
+        return core->state->tiers[index].window_size;
+
+    return core->config.window_size;
+}
+
+void analysis_core_swap_plans(AnalysisCore *core, fftwf_plan *plans)
+{
+    AnalysisState *state = core->state;
+    fftwf_plan previous;
+
+    if (state->tier_count == 0)
+    {
+        previous = state->fftw_plan;
+        state->fftw_plan = plans[0];
+        plans[0] = previous;
+    }
+
+    for (int t = 0; t < state->tier_count; t++)
+    {
+        previous = state->tiers[t].plan;
+        state->tiers[t].plan = plans[t];
+        plans[t] = previous;
+    }
+
+    state->estimated_plan = FALSE;
+}
+
+/**
+ * Turn the band powers of every analysed channel into levels from 0 to 1.
+ *
+ * The powers are scaled by `power_scale` to be relative to a full scale sine wave, converted to dBFS, weighted, and
+ * mapped from `DYNAMIC_RANGE_DB` below the ceiling up to the ceiling. With automatic gain the ceiling jumps up to the
+ * loudest band straight away and falls back slowly.
+ */
+static void
+analysis_core_normalize(AnalysisCore *core, float *output, int bands, float power_scale)
+{
+    float peak_db = -G_MAXFLOAT;
+    float floor_db;
+
+    for (int c = 0; c < core->analysis_channels; c++)
+    {
+        float *channel_output = output + c * bands;
+
+        for (int i = 0; i < bands; i++)
+        {
+            float level_db = 10.0f * log10f(channel_output[i] * power_scale + MIN_POWER) + core->band_weight_db[i];
+
+            channel_output[i] = level_db;
+            peak_db = MAX(peak_db, level_db);
+        }
+    }
+
+    if (core->config.auto_gain)
+    {
+        float release = AUTO_GAIN_RELEASE_DB * core->config.hop_size / (float)core->config.sample_rate;
+
+        core->ceiling_db = MAX(core->ceiling_db - release, peak_db + AUTO_GAIN_HEADROOM_DB);
+        core->ceiling_db = MAX(core->ceiling_db, AUTO_GAIN_MIN_CEILING_DB);
+    }
+    else
+    {
+        core->ceiling_db = 0;
+    }
+
+    floor_db = core->ceiling_db - DYNAMIC_RANGE_DB;
+    for (int i = 0; i < core->analysis_channels * bands; i++)
+        output[i] = CLAMP((output[i] - floor_db) / DYNAMIC_RANGE_DB, 0.0f, 1.0f);
+}
+
+// Run the fourier transform over the current analysis window and reduce it to band levels in `levels`.
+static void
+analysis_core_analyze_window(AnalysisCore *core)
+{
+    AnalysisState *state = core->state;
+    float *restrict samples;
+    const float *restrict history;
+    const float *restrict coefficients;
+    int bins, bands, depth;
+    gint64 start = probe_now(), end;
+
+    // Copy the analysis window over while applying the window function, FFTW reads its input from `samples`.
+    // Both tables are interleaved the same way, so this is a flat multiply the compiler can vectorize.
+    samples = state->samples;
+    history = state->history;
+    coefficients = state->window_coefficients;
+    for (int i = 0; i < core->config.window_size * core->analysis_channels; i++)
+        samples[i] = history[i] * coefficients[i];
+
+    end = probe_now();
+    probe_record(PROBE_CONVERT, core->convert_time + end - start);
+    core->convert_time = 0;
+    start = end;
+
+    // Execute the fourier transform of every channel at once on the input data, see `allocation_guard_suspend`
+    // for why it runs unguarded
+    depth = allocation_guard_suspend();
+    fftwf_execute_dft_r2c(state->fftw_plan, state->samples, state->out);
+    allocation_guard_resume(depth);
+
+    end = probe_now();
+    probe_record(PROBE_FFT, end - start);
+    start = end;
+
+    // Reduce the bins of every band in one pass over the sparse weight matrix
+    bins = core->config.window_size / 2 + 1;
+    bands = state->band_matrix.bands;
+    for (int c = 0; c < core->analysis_channels; c++)
+        core->band_kernel((const float *)(state->out + c * bins), &state->band_matrix, core->levels + c * bands);
+
+    // A full scale sine wave has a magnitude of half the window size
+    analysis_core_normalize(core, core->levels, bands,
+                            4.0f / ((float)core->config.window_size * (float)core->config.window_size));
+
+    probe_record_since(PROBE_BAND_REDUCTION, start);
+}
+
+/**
+ * Low pass and decimate the hop that just came into the history of the core, appending it to a tier's history.
+ *
+ * Only the decimated samples are computed, so the filter costs `taps / decimation` per input sample.
+ */
+static void
+analysis_core_decimate_tier(AnalysisCore *core, AnalysisTier *tier)
+{
+    int channels = core->analysis_channels;
+    int count = core->config.hop_size / tier->decimation;
+    const float *filter = tier->filter;
+    float *history = tier->history;
+
+    memmove(history, history + count * channels, sizeof(float) * (tier->window_size - count) * channels);
+
+    for (int j = 0; j < count; j++)
+    {
+        // Newest input sample of the filter, the filter is symmetric so it's run backwards from there
+        const float *newest = core->state->history + (core->config.window_size - 1 - (count - 1 - j) * tier->decimation) * channels;
+        float *dest = history + (tier->window_size - count + j) * channels;
+
+        for (int c = 0; c < channels; c++)
+        {
+            float sum = 0;
+
+            for (int k = 0; k < tier->taps; k++)
+                sum += filter[k] * newest[c - k * channels];
+
+            dest[c] = sum;
+        }
+    }
+}
+
+// Run the transforms of every tier over their windows and stitch their bands together into `levels`.
+static void
+analysis_core_analyze_tiers(AnalysisCore *core)
+{
+    AnalysisState *state = core->state;
+    int channels = core->analysis_channels;
+    int bands = state->band_matrix.bands;
+    int depth;
+    gint64 start = probe_now(), end;
+
+    for (int t = 0; t < state->tier_count; t++)
+    {
+        AnalysisTier *tier = &state->tiers[t];
+        float *restrict samples = tier->samples;
+        const float *restrict coefficients = tier->window_coefficients;
+        const float *restrict source;
+
+        // The tier that isn't decimated reads the end of the history of the core
+        if (tier->decimation > 1)
+        {
+            analysis_core_decimate_tier(core, tier);
+            source = tier->history;
+        }
+        else
+        {
+            source = state->history + (core->config.window_size - tier->window_size) * channels;
+        }
+
+        for (int i = 0; i < tier->window_size * channels; i++)
+            samples[i] = source[i] * coefficients[i];
+    }
+
+    end = probe_now();
+    probe_record(PROBE_CONVERT, core->convert_time + end - start);
+    core->convert_time = 0;
+    start = end;
+
+    depth = allocation_guard_suspend();
+    for (int t = 0; t < state->tier_count; t++)
+        fftwf_execute_dft_r2c(state->tiers[t].plan, state->tiers[t].samples, state->tiers[t].out);
+    allocation_guard_resume(depth);
+
+    end = probe_now();
+    probe_record(PROBE_FFT, end - start);
+    start = end;
+
+    // Every band has bins in a single tier and is empty in the others, so adding the scaled powers of
+    // all tiers up stitches the spectrum together
+    memset(core->levels, 0, sizeof(float) * channels * bands);
+    for (int t = 0; t < state->tier_count; t++)
+    {
+        AnalysisTier *tier = &state->tiers[t];
+        int bins = tier->window_size / 2 + 1;
+
+        for (int c = 0; c < channels; c++)
+            core->band_kernel((const float *)(tier->out + c * bins), &tier->band_matrix, core->tier_levels + c * bands);
+
+        for (int i = 0; i < channels * bands; i++)
+            core->levels[i] += core->tier_levels[i] * tier->power_scale;
+    }
+
+    analysis_core_normalize(core, core->levels, bands, 1.0f);
+
+    probe_record_since(PROBE_BAND_REDUCTION, start);
+}
+
+/**
+ * Convert interleaved input frames into the analysed channels.
+ *
+ * @param `input` `count` frames of `input_channels` interleaved samples
+ * @param `dest` room for `count` frames of `analysis_channels` interleaved samples
+ */
+static void
+analysis_core_collect_samples(AnalysisCore *core, const float *input, float *dest, int count)
+{
+    int channels = core->config.input_channels;
+
+    switch (core->analysis_mode)
+    {
+    case ANALYSIS_CHANNELS_SEPARATE:
+        // The batched plan reads the channels interleaved, so the frames can be copied as they are
+        memcpy(dest, input, sizeof(float) * count * channels);
+        break;
+
+    case ANALYSIS_CHANNELS_MID_SIDE:
+        for (int i = 0; i < count; i++)
+        {
+            float left = input[i * channels];
+            float right = input[i * channels + 1];
+
+            dest[i * 2] = (left + right) / 2;
+            dest[i * 2 + 1] = (left - right) / 2;
+        }
+        break;
+
+    case ANALYSIS_CHANNELS_MONO:
+    default:
+        // Get the average of all the channels
+        for (int i = 0; i < count; i++)
+        {
+            float sample = 0;
+
+            for (int c = 0; c < channels; c++)
+                sample += input[i * channels + c];
+
+            dest[i] = sample / channels;
+        }
+        break;
+    }
+}
+
+void analysis_core_process(AnalysisCore *core,
+                           const float *input,
+                           int frames,
+                           AnalysisFrameFunc func,
+                           gpointer user_data)
+{
+    AnalysisState *state = core->state;
+    int window_size = core->config.window_size;
+    int hop_size = core->config.hop_size;
+    int channels = core->analysis_channels;
+    int frame = 0;
+
+    // Append the new samples to the end of the history, running an analysis every time a full hop is collected
+    while (frame < frames)
+    {
+        int count = MIN(frames - frame, hop_size - core->hop_fill);
+        int offset = (window_size - hop_size) + core->hop_fill;
+        gint64 start = probe_now();
+
+        analysis_core_collect_samples(core,
+                                      input + frame * core->config.input_channels,
+                                      state->history + offset * channels,
+                                      count);
+        core->convert_time += probe_now() - start;
+
+        frame += count;
+        core->hop_fill += count;
+
+        if (core->hop_fill < hop_size)
+            break;
+
+        if (state->tier_count > 0)
+            analysis_core_analyze_tiers(core);
+        else
+            analysis_core_analyze_window(core);
+        func(core->levels, channels, state->band_matrix.bands, user_data);
+
+        // Slide the window forward by one hop to make room for the next set of samples
+        memmove(state->history,
+                state->history + hop_size * channels,
+                sizeof(float) * (window_size - hop_size) * channels);
+        core->hop_fill = 0;
+    }
+}
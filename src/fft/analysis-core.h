@@ -0,0 +1,243 @@
+/* analysis-core.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANALYSIS_CORE_H
+#define ANALYSIS_CORE_H
+
+#include <glib.h>
+#include <fftw3.h>
+#include <fft/band-layout.h>
+#include <fft/window-function.h>
+
+G_BEGIN_DECLS
+
+// Largest number of interleaved input channels the analysis accepts
+#define ANALYSIS_MAX_CHANNELS (8)
+
+// Largest number of values in a single analysis frame
+#define ANALYSIS_MAX_VALUES (ANALYSIS_MAX_CHANNELS * BAND_LAYOUT_MAX_BANDS)
+
+// Sample rate the sizes of the presets are given at, they're scaled to the actual sample rate
+#define ANALYSIS_PRESET_SAMPLE_RATE (48000)
+
+// Smallest and largest analysis windows a preset picks, whatever the sample rate
+#define ANALYSIS_MIN_WINDOW_SIZE (256)
+#define ANALYSIS_MAX_WINDOW_SIZE (65536)
+
+// Largest number of transforms run for each analysis frame, the multi-resolution preset runs one per window
+#define ANALYSIS_MAX_PLANS (3)
+
+// Number of bands used by the layouts that don't have a fixed number of bands, until another number is set
+#define ANALYSIS_DEFAULT_BANDS (64)
+
+// Planner rigor used for plans that are worth measuring, cached as wisdom so it only has to be paid once.
+// Set to 0 to stay on estimated plans.
+#define ANALYSIS_PLANNER_FLAGS (FFTW_PATIENT)
+
+// Longest a measuring planner searches for a plan, in seconds. The planner lock is held for the whole search and
+// reconfiguring the core needs it too, so this is also the longest a reconfiguration waits on a background plan.
+#define ANALYSIS_PLANNER_TIME_LIMIT (0.2)
+
+// How the channels of the audio input are analysed.
+typedef enum
+{
+    // Analyse the average of all the channels
+    ANALYSIS_CHANNELS_MONO,
+    // Analyse every channel on its own
+    ANALYSIS_CHANNELS_SEPARATE,
+    // Analyse the mid (sum) and side (difference) of the first two channels
+    ANALYSIS_CHANNELS_MID_SIDE,
+} AnalysisChannelMode;
+
+/**
+ * Trade-off between frequency resolution and latency.
+ *
+ * Each preset keeps the duration of the analysis window and the time between two analysis frames the same
+ * at every sample rate, so a high sample rate doesn't cost resolution in the bass.
+ */
+typedef enum
+{
+    // 512 sample windows every 256 samples at 48 kHz, about 94 Hz per bin and a frame every 5 ms
+    ANALYSIS_PRESET_LOW_LATENCY,
+    // 2048 sample windows every 512 samples at 48 kHz, about 23 Hz per bin and a frame every 11 ms
+    ANALYSIS_PRESET_BALANCED,
+    // 8192 sample windows every 1024 samples at 48 kHz, about 6 Hz per bin and a frame every 21 ms
+    ANALYSIS_PRESET_HIGH_RESOLUTION,
+    // Bands up to 250 Hz from 8192 sample windows, up to 2 kHz from 2048 and the rest from 512 at 48 kHz, with a
+    // frame every 11 ms. The longer windows run on decimated input, which keeps their FFTs short.
+    ANALYSIS_PRESET_MULTI_RESOLUTION,
+} AnalysisPreset;
+
+// Everything the analysis of an audio stream depends on.
+typedef struct
+{
+    // Sample rate of the audio input
+    guint sample_rate;
+    // Number of interleaved channels in the audio input
+    int input_channels;
+    // How the input channels are turned into analysed channels
+    AnalysisChannelMode channel_mode;
+    // Preset `window_size` and `hop_size` were picked with, see `analysis_config_apply_preset`
+    AnalysisPreset preset;
+    // Number of samples in each analysis window, must be even. With the multi-resolution preset this is the
+    // longest window, the shorter ones are picked by the core.
+    int window_size;
+    // Number of new samples between two analysis windows, at most `window_size`.
+    // Consecutive windows overlap by `window_size - hop_size` samples.
+    int hop_size;
+    // How the spectrum is split up into bands
+    BandLayout band_layout;
+    // Number of bands asked for, the layout may not use it
+    int bands;
+    // Window function applied to every analysis window
+    WindowFunction window_function;
+    // Frequency weighting applied to the bands
+    BandWeighting weighting;
+    // Whether the ceiling follows the loudness of the input, or stays at 0 dBFS
+    gboolean auto_gain;
+} AnalysisConfig;
+
+/**
+ * The analysis of an audio stream into band levels, without any threads, timers or UI.
+ *
+ * Interleaved frames go in, and a frame of levels from 0 to 1 comes out every hop. The live FFT thread and the
+ * offline analysis both run on top of it, so they always produce the same output for the same input.
+ */
+typedef struct _AnalysisCore AnalysisCore;
+
+/**
+ * Called with every analysis frame.
+ *
+ * @param `levels` `bands` levels from 0 to 1 for each analysed channel one after the other, only valid during the call
+ */
+typedef void (*AnalysisFrameFunc)(const float *levels, int channels, int bands, gpointer user_data);
+
+// Fill in the defaults used by the application for an input, the window follows the balanced preset.
+void analysis_config_init(AnalysisConfig *config, guint sample_rate, int input_channels);
+
+/**
+ * Pick the window and hop sizes of a preset for the sample rate of `config`.
+ *
+ * Both are powers of two, the closest to the durations of the preset. A sample rate of 0 is taken as
+ * `ANALYSIS_PRESET_SAMPLE_RATE`, so the preset has to be applied again once the actual sample rate is known.
+ */
+void analysis_config_apply_preset(AnalysisConfig *config, AnalysisPreset preset);
+
+/**
+ * Create a new analysis core.
+ *
+ * The core starts on estimated plans unless there is matching wisdom, see `analysis_core_is_plan_estimated`.
+ */
+AnalysisCore *analysis_core_new(const AnalysisConfig *config);
+
+void analysis_core_free(AnalysisCore *core);
+
+/**
+ * Apply a new configuration.
+ *
+ * All the buffers, tables and plans of the core are carved from a single arena. A new arena is only built when
+ * the window size, the number of analysed channels or the multi-resolution tiers change, and it replaces the old
+ * one once it's complete. Otherwise the tables are recomputed in place, and the history is only cleared when the
+ * input changes. Processing never allocates.
+ *
+ * @return TRUE if the plans were replaced, any plan made for the old shape is of no use anymore
+ */
+gboolean analysis_core_configure(AnalysisCore *core, const AnalysisConfig *config);
+
+/**
+ * Forget all the audio fed to the core so far, as if it had just been created.
+ *
+ * This clears the history and the automatic gain, so the next input can be analysed on its own.
+ */
+void analysis_core_reset(AnalysisCore *core);
+
+// Get the configuration in use.
+const AnalysisConfig *analysis_core_get_config(AnalysisCore *core);
+
+/**
+ * Feed interleaved input frames to the analysis.
+ *
+ * `func` is called once for every hop completed by the input, which may be zero or several times.
+ *
+ * @param `input` `frames` frames of `input_channels` interleaved samples
+ */
+void analysis_core_process(AnalysisCore *core,
+                           const float *input,
+                           int frames,
+                           AnalysisFrameFunc func,
+                           gpointer user_data);
+
+// Get the number of channels in each analysis frame.
+int analysis_core_get_channels(AnalysisCore *core);
+
+/**
+ * Get the number of input frames fed since the last analysis frame.
+ *
+ * The next analysis frame is produced once `hop_size` minus this many more input frames are fed.
+ */
+int analysis_core_get_buffered_frames(AnalysisCore *core);
+
+// Get the number of bands of each channel in an analysis frame.
+int analysis_core_get_bands(AnalysisCore *core);
+
+// Get the center frequency of each band in Hz, `analysis_core_get_bands` values.
+const float *analysis_core_get_band_frequencies(AnalysisCore *core);
+
+// Whether any plan of the core was estimated, so plans made with `ANALYSIS_PLANNER_FLAGS` would beat them.
+gboolean analysis_core_is_plan_estimated(AnalysisCore *core);
+
+// Get the number of transforms the core runs for each analysis frame, at most `ANALYSIS_MAX_PLANS`.
+int analysis_core_get_plan_count(AnalysisCore *core);
+
+/**
+ * Get the length of one of the transforms of the core.
+ *
+ * Every transform runs over `analysis_core_get_channels` channels at once.
+ *
+ * @param `index` index of the transform, less than `analysis_core_get_plan_count`
+ */
+int analysis_core_get_plan_size(AnalysisCore *core, int index);
+
+/**
+ * Replace all the plans of the core at once, without taking the planner lock.
+ *
+ * @param `plans` one plan for each transform, in the order of `analysis_core_get_plan_size`, see `analysis_plan_new`.
+ * Set to the previous plans, which the caller must destroy with `analysis_plan_destroy`.
+ */
+void analysis_core_swap_plans(AnalysisCore *core, fftwf_plan *plans);
+
+/**
+ * Create a batched real to complex plan running `channels` transforms of length `n` at once.
+ *
+ * The input holds the channels interleaved, the output holds the bins of each channel one after the other.
+ * Cached wisdom is loaded before the first plan is made, and measuring planners stop at the best plan they found
+ * within `ANALYSIS_PLANNER_TIME_LIMIT`.
+ *
+ * @return the plan, or NULL if `flags` contains `FFTW_WISDOM_ONLY` and there was no matching wisdom
+ */
+fftwf_plan analysis_plan_new(int n, int channels, unsigned int flags);
+
+// Destroy a plan, NULL is ignored.
+void analysis_plan_destroy(fftwf_plan plan);
+
+// Save all of FFTW's accumulated wisdom to the cache file.
+void analysis_plan_export_wisdom(void);
+
+G_END_DECLS
+
+#endif // ANALYSIS_CORE_H
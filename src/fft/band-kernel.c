@@ -0,0 +1,259 @@
+/* band-kernel.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fft/band-kernel.h>
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BAND_KERNEL_X86 (1)
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define BAND_KERNEL_NEON (1)
+#elif defined(__arm__) && defined(__linux__) && (defined(__ARM_NEON) || (defined(__ARM_FP) && !defined(__clang__)))
+// Not every 32-bit ARM board has Advanced SIMD, GCC builds the kernel for it anyway and it's only picked at run time
+#include <arm_neon.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#define BAND_KERNEL_NEON (1)
+#endif
+
+// Weighted power of `length` bins starting at `start`, computed one bin at a time.
+static inline float
+band_sum_scalar(const float *spectrum, const float *weights, int start, int length, float sum)
+{
+    for (int j = 0; j < length; j++)
+    {
+        float re = spectrum[(start + j) * 2];
+        float im = spectrum[(start + j) * 2 + 1];
+
+        sum += weights[j] * (re * re + im * im);
+    }
+
+    return sum;
+}
+
+static void
+band_kernel_scalar(const float *spectrum,
+                   const BandMatrix *matrix,
+                   float *output)
+{
+    for (int i = 0; i < matrix->bands; i++)
+        output[i] = band_sum_scalar(spectrum, matrix->weights + matrix->weight_start[i],
+                                    matrix->band_start[i], matrix->band_length[i], 0);
+}
+
+#ifdef BAND_KERNEL_X86
+
+// Sum of the four lanes of `v`.
+__attribute__((target("sse2"))) static inline float
+band_hsum_sse2(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse2"))) static void
+band_kernel_sse2(const float *spectrum,
+                 const BandMatrix *matrix,
+                 float *output)
+{
+    for (int i = 0; i < matrix->bands; i++)
+    {
+        const float *bins = spectrum + matrix->band_start[i] * 2;
+        const float *weights = matrix->weights + matrix->weight_start[i];
+        int length = matrix->band_length[i];
+        int j = 0;
+        __m128 sum = _mm_setzero_ps();
+
+        // Four bins per iteration: split them into their real and imaginary parts, square and weigh them
+        for (; j + 4 <= length; j += 4)
+        {
+            __m128 a = _mm_loadu_ps(bins + j * 2);
+            __m128 b = _mm_loadu_ps(bins + j * 2 + 4);
+            __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128 sq = _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+
+            sum = _mm_add_ps(sum, _mm_mul_ps(sq, _mm_loadu_ps(weights + j)));
+        }
+
+        output[i] = band_sum_scalar(bins, weights + j, j, length - j, band_hsum_sse2(sum));
+    }
+}
+
+__attribute__((target("avx"))) static void
+band_kernel_avx(const float *spectrum,
+                const BandMatrix *matrix,
+                float *output)
+{
+    for (int i = 0; i < matrix->bands; i++)
+    {
+        const float *bins = spectrum + matrix->band_start[i] * 2;
+        const float *weights = matrix->weights + matrix->weight_start[i];
+        int length = matrix->band_length[i];
+        int j = 0;
+        __m256 sum = _mm256_setzero_ps();
+        __m128 sum_half;
+
+        // Eight bins per iteration. The lanes are swapped around first so the horizontal add
+        // leaves the squared magnitudes in bin order, lined up with the weights.
+        for (; j + 8 <= length; j += 8)
+        {
+            __m256 a = _mm256_loadu_ps(bins + j * 2);
+            __m256 b = _mm256_loadu_ps(bins + j * 2 + 8);
+            __m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+            __m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+            __m256 sq = _mm256_hadd_ps(_mm256_mul_ps(lo, lo), _mm256_mul_ps(hi, hi));
+
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(sq, _mm256_loadu_ps(weights + j)));
+        }
+
+        sum_half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        output[i] = band_sum_scalar(bins, weights + j, j, length - j, band_hsum_sse2(sum_half));
+    }
+}
+
+#endif // BAND_KERNEL_X86
+
+#ifdef BAND_KERNEL_NEON
+
+#if defined(__arm__) && !defined(__ARM_NEON)
+#define BAND_KERNEL_NEON_TARGET __attribute__((target("fpu=neon")))
+#else
+#define BAND_KERNEL_NEON_TARGET
+#endif
+
+// Add `a * b` to `sum`, 32-bit ARM only has the unfused multiply-add.
+BAND_KERNEL_NEON_TARGET static inline float32x4_t
+band_mla_neon(float32x4_t sum, float32x4_t a, float32x4_t b)
+{
+#ifdef __aarch64__
+    return vfmaq_f32(sum, a, b);
+#else
+    return vmlaq_f32(sum, a, b);
+#endif
+}
+
+// Sum of the four lanes of `v`, 32-bit ARM has no add across the lanes.
+BAND_KERNEL_NEON_TARGET static inline float
+band_hsum_neon(float32x4_t v)
+{
+#ifdef __aarch64__
+    return vaddvq_f32(v);
+#else
+    float32x2_t half = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+#endif
+}
+
+BAND_KERNEL_NEON_TARGET static void
+band_kernel_neon(const float *spectrum,
+                 const BandMatrix *matrix,
+                 float *output)
+{
+    for (int i = 0; i < matrix->bands; i++)
+    {
+        const float *bins = spectrum + matrix->band_start[i] * 2;
+        const float *weights = matrix->weights + matrix->weight_start[i];
+        int length = matrix->band_length[i];
+        int j = 0;
+        float32x4_t sum = vdupq_n_f32(0);
+
+        // Four bins per iteration, the structured load splits the real and imaginary parts for us
+        for (; j + 4 <= length; j += 4)
+        {
+            float32x4x2_t parts = vld2q_f32(bins + j * 2);
+            float32x4_t sq = band_mla_neon(vmulq_f32(parts.val[0], parts.val[0]), parts.val[1], parts.val[1]);
+
+            sum = band_mla_neon(sum, sq, vld1q_f32(weights + j));
+        }
+
+        output[i] = band_sum_scalar(bins, weights + j, j, length - j, band_hsum_neon(sum));
+    }
+}
+
+#endif // BAND_KERNEL_NEON
+
+typedef struct
+{
+    BandKernel kernel;
+    const char *name;
+} BandKernelChoice;
+
+static const BandKernelChoice *
+band_kernel_choose(void)
+{
+    static const BandKernelChoice scalar = {band_kernel_scalar, "scalar"};
+
+#ifdef BAND_KERNEL_X86
+    static const BandKernelChoice sse2 = {band_kernel_sse2, "sse2"};
+    static const BandKernelChoice avx = {band_kernel_avx, "avx"};
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))
+        return &avx;
+    if (__builtin_cpu_supports("sse2"))
+        return &sse2;
+#endif
+
+#ifdef BAND_KERNEL_NEON
+    // Advanced SIMD is mandatory on AArch64, 32-bit ARM reports it in the hardware capabilities
+    static const BandKernelChoice neon = {band_kernel_neon, "neon"};
+
+#ifdef __aarch64__
+    return &neon;
+#else
+    if (getauxval(AT_HWCAP) & HWCAP_NEON)
+        return &neon;
+#endif
+#endif
+
+    return &scalar;
+}
+
+static const BandKernelChoice *
+band_kernel_get_choice(void)
+{
+    static const BandKernelChoice *choice = NULL;
+    const BandKernelChoice *current;
+
+    // Racing threads all pick the same kernel, so no lock is needed
+    current = __atomic_load_n(&choice, __ATOMIC_ACQUIRE);
+    if (current == NULL)
+    {
+        current = band_kernel_choose();
+        __atomic_store_n(&choice, current, __ATOMIC_RELEASE);
+    }
+
+    return current;
+}
+
+BandKernel band_kernel_get(void)
+{
+    return band_kernel_get_choice()->kernel;
+}
+
+const char *band_kernel_get_name(void)
+{
+    return band_kernel_get_choice()->name;
+}
@@ -0,0 +1,61 @@
+/* band-kernel.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAND_KERNEL_H
+#define BAND_KERNEL_H
+
+/**
+ * Sparse matrix of bin weights, one row per band.
+ *
+ * Every band covers a contiguous run of bins, so a row only needs the first bin, the number of bins and
+ * where its weights start. The weights of all bands are stored back to back in `weights`.
+ */
+typedef struct
+{
+    // Number of bands (rows)
+    int bands;
+    // Index of the first bin of each band
+    int *band_start;
+    // Number of bins in each band, 0 for bands above the nyquist frequency
+    int *band_length;
+    // Index of the first weight of each band in `weights`
+    int *weight_start;
+    // Weight of every bin of every band
+    float *weights;
+    // Number of weights `weights` has room for
+    int capacity;
+} BandMatrix;
+
+/**
+ * Kernel computing the weighted sum of the squared magnitudes in each band of an FFT output.
+ *
+ * @param `spectrum` interleaved real and imaginary parts of the FFT output bins
+ * @param `matrix` weights of the bins in each band
+ * @param `output` weighted power of each band, 0 for empty bands
+ */
+typedef void (*BandKernel)(const float *spectrum,
+                           const BandMatrix *matrix,
+                           float *output);
+
+// Get the fastest band kernel supported by the CPU. The choice is made once and cached.
+BandKernel band_kernel_get(void);
+
+// Get the name of the kernel returned by `band_kernel_get`.
+const char *band_kernel_get_name(void);
+
+#endif // BAND_KERNEL_H
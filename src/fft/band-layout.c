@@ -0,0 +1,274 @@
+/* band-layout.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fft/band-layout.h>
+
+#include <math.h>
+#include <string.h>
+
+// Lowest frequency covered by the log, mel and third octave layouts
+#define LOWEST_FREQUENCY (20.0)
+
+// Highest frequency covered by the log, mel and third octave layouts, if the sample rate allows it
+#define HIGHEST_FREQUENCY (20000.0)
+
+// Number of classic bands
+#define CLASSIC_BANDS (7)
+
+// Number of ISO third octave bands between 20 Hz and 20 kHz
+#define THIRD_OCTAVE_BANDS (31)
+
+// Lower frequency of each classic band, each band ends where the next one starts
+static const double CLASSIC_RANGES[CLASSIC_BANDS] = {
+    60, 150, 400, 1000, 2400, 6000, 14000};
+
+// State shared by the functions adding the bands of a layout to a matrix.
+typedef struct
+{
+    BandMatrix *matrix;
+    // Number of bins per Hz
+    double bins_per_hz;
+    // Index of the nyquist bin, which is never part of a band
+    int nyquist_bin;
+    // Number of weights written so far
+    int weights;
+} BandBuilder;
+
+// Let a band take the bin closest to its center, for bands narrower than a bin.
+static void
+band_builder_add_nearest(BandBuilder *builder, int band, double center)
+{
+    BandMatrix *matrix = builder->matrix;
+    int bin = (int)lround(center * builder->bins_per_hz);
+
+    matrix->weight_start[band] = builder->weights;
+
+    if (bin >= builder->nyquist_bin)
+    {
+        matrix->band_start[band] = 0;
+        matrix->band_length[band] = 0;
+        return;
+    }
+
+    matrix->band_start[band] = MAX(bin, 1);
+    matrix->band_length[band] = 1;
+    matrix->weights[builder->weights++] = 1;
+}
+
+// Add a band weighing every bin above `low` up to and including `high` equally.
+static void
+band_builder_add_rectangle(BandBuilder *builder, int band, double low, double high, double center)
+{
+    BandMatrix *matrix = builder->matrix;
+    int start = (int)floor(low * builder->bins_per_hz) + 1;
+    int end = (int)floor(high * builder->bins_per_hz) + 1;
+
+    end = MIN(end, builder->nyquist_bin);
+    if (end <= start)
+    {
+        band_builder_add_nearest(builder, band, center);
+        return;
+    }
+
+    matrix->band_start[band] = start;
+    matrix->band_length[band] = end - start;
+    matrix->weight_start[band] = builder->weights;
+
+    for (int bin = start; bin < end; bin++)
+        matrix->weights[builder->weights++] = 1;
+}
+
+// Add a band rising from 0 at `low` to 1 at `center` and falling back to 0 at `high`.
+static void
+band_builder_add_triangle(BandBuilder *builder, int band, double low, double center, double high)
+{
+    BandMatrix *matrix = builder->matrix;
+    int start = (int)floor(low * builder->bins_per_hz) + 1;
+    int end = (int)ceil(high * builder->bins_per_hz);
+
+    end = MIN(end, builder->nyquist_bin);
+    if (end <= start)
+    {
+        band_builder_add_nearest(builder, band, center);
+        return;
+    }
+
+    matrix->band_start[band] = start;
+    matrix->band_length[band] = end - start;
+    matrix->weight_start[band] = builder->weights;
+
+    for (int bin = start; bin < end; bin++)
+    {
+        double frequency = bin / builder->bins_per_hz;
+
+        if (frequency <= center)
+            matrix->weights[builder->weights++] = (frequency - low) / (center - low);
+        else
+            matrix->weights[builder->weights++] = (high - frequency) / (high - center);
+    }
+}
+
+static double
+hz_to_mel(double hz)
+{
+    return 2595.0 * log10(1.0 + hz / 700.0);
+}
+
+static double
+mel_to_hz(double mel)
+{
+    return 700.0 * (pow(10.0, mel / 2595.0) - 1.0);
+}
+
+int band_layout_get_bands(BandLayout layout, int bands)
+{
+    switch (layout)
+    {
+    case BAND_LAYOUT_CLASSIC:
+        return CLASSIC_BANDS;
+    case BAND_LAYOUT_THIRD_OCTAVE:
+        return THIRD_OCTAVE_BANDS;
+    case BAND_LAYOUT_LINEAR:
+    case BAND_LAYOUT_LOG:
+    case BAND_LAYOUT_MEL:
+    default:
+        return CLAMP(bands, 1, BAND_LAYOUT_MAX_BANDS);
+    }
+}
+
+void band_layout_build(BandMatrix *matrix,
+                       float *frequencies,
+                       BandLayout layout,
+                       int bands,
+                       guint sample_rate,
+                       int window_size)
+{
+    band_layout_build_decimated(matrix, frequencies, layout, bands, sample_rate, window_size, 1);
+}
+
+void band_layout_build_decimated(BandMatrix *matrix,
+                                 float *frequencies,
+                                 BandLayout layout,
+                                 int bands,
+                                 guint sample_rate,
+                                 int window_size,
+                                 int decimation)
+{
+    BandBuilder builder;
+    double nyquist = sample_rate / 2.0;
+    double highest = MIN(HIGHEST_FREQUENCY, nyquist);
+
+    bands = band_layout_get_bands(layout, bands);
+
+    g_return_if_fail(matrix->capacity >= BAND_LAYOUT_MAX_WEIGHTS(window_size));
+
+    matrix->bands = bands;
+    memset(matrix->band_start, 0, sizeof(int) * bands);
+    memset(matrix->band_length, 0, sizeof(int) * bands);
+    memset(matrix->weight_start, 0, sizeof(int) * bands);
+
+    builder.matrix = matrix;
+    // The bands are laid out for the input, the bins are those of the decimated signal
+    builder.bins_per_hz = (double)window_size * decimation / (double)sample_rate;
+    builder.nyquist_bin = window_size / 2;
+    builder.weights = 0;
+
+    for (int i = 0; i < bands; i++)
+    {
+        double low, high, center;
+
+        switch (layout)
+        {
+        case BAND_LAYOUT_LINEAR:
+            low = nyquist * i / bands;
+            high = nyquist * (i + 1) / bands;
+            center = (low + high) / 2;
+            band_builder_add_rectangle(&builder, i, low, high, center);
+            break;
+        case BAND_LAYOUT_LOG:
+            low = LOWEST_FREQUENCY * pow(highest / LOWEST_FREQUENCY, (double)i / bands);
+            high = LOWEST_FREQUENCY * pow(highest / LOWEST_FREQUENCY, (double)(i + 1) / bands);
+            center = sqrt(low * high);
+            band_builder_add_rectangle(&builder, i, low, high, center);
+            break;
+        case BAND_LAYOUT_MEL:
+        {
+            // Each filter reaches from the center of the filter below it to the center of the one above it
+            double mel_low = hz_to_mel(LOWEST_FREQUENCY);
+            double mel_step = (hz_to_mel(highest) - mel_low) / (bands + 1);
+
+            low = mel_to_hz(mel_low + mel_step * i);
+            center = mel_to_hz(mel_low + mel_step * (i + 1));
+            high = mel_to_hz(mel_low + mel_step * (i + 2));
+            band_builder_add_triangle(&builder, i, low, center, high);
+            break;
+        }
+        case BAND_LAYOUT_THIRD_OCTAVE:
+            // Centered on 1 kHz, the lowest band is centered on about 20 Hz
+            center = 1000.0 * pow(2.0, (i - 17) / 3.0);
+            low = center * pow(2.0, -1.0 / 6.0);
+            high = center * pow(2.0, 1.0 / 6.0);
+            band_builder_add_rectangle(&builder, i, low, high, center);
+            break;
+        case BAND_LAYOUT_CLASSIC:
+        default:
+            low = CLASSIC_RANGES[i];
+            high = i + 1 < CLASSIC_BANDS ? CLASSIC_RANGES[i + 1] : nyquist;
+            center = sqrt(low * high);
+            band_builder_add_rectangle(&builder, i, low, high, center);
+            break;
+        }
+
+        frequencies[i] = center;
+    }
+}
+
+void band_layout_carve_matrix(BandMatrix *matrix, MemoryArena *arena, int window_size)
+{
+    matrix->bands = 0;
+    matrix->band_start = memory_arena_carve_array(arena, int, BAND_LAYOUT_MAX_BANDS);
+    matrix->band_length = memory_arena_carve_array(arena, int, BAND_LAYOUT_MAX_BANDS);
+    matrix->weight_start = memory_arena_carve_array(arena, int, BAND_LAYOUT_MAX_BANDS);
+    matrix->capacity = BAND_LAYOUT_MAX_WEIGHTS(window_size);
+    matrix->weights = memory_arena_carve_array(arena, float, matrix->capacity);
+}
+
+float band_layout_get_weighting(BandWeighting weighting, double frequency)
+{
+    // Squared pole frequencies of the IEC 61672 weighting curves
+    const double F1 = 20.598997 * 20.598997;
+    const double F2 = 107.65265 * 107.65265;
+    const double F3 = 737.86223 * 737.86223;
+    const double F4 = 12194.217 * 12194.217;
+    double f2 = frequency * frequency;
+    double response;
+
+    switch (weighting)
+    {
+    case BAND_WEIGHTING_A:
+        response = F4 * f2 * f2 / ((f2 + F1) * sqrt((f2 + F2) * (f2 + F3)) * (f2 + F4));
+        // Normalized to 0 dB at 1 kHz
+        return 20.0 * log10(response) + 2.0;
+    case BAND_WEIGHTING_C:
+        response = F4 * f2 / ((f2 + F1) * (f2 + F4));
+        return 20.0 * log10(response) + 0.06;
+    case BAND_WEIGHTING_NONE:
+    default:
+        return 0;
+    }
+}
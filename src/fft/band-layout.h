@@ -0,0 +1,117 @@
+/* band-layout.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAND_LAYOUT_H
+#define BAND_LAYOUT_H
+
+#include <glib.h>
+#include <fft/band-kernel.h>
+#include <memory/memory-arena.h>
+
+G_BEGIN_DECLS
+
+// Largest number of bands in any layout.
+#define BAND_LAYOUT_MAX_BANDS (256)
+
+// Largest number of weights in the matrix of any layout for an FFT of `window_size`.
+// Every bin is part of at most two overlapping bands, plus one extra bin for each band narrower than a bin.
+#define BAND_LAYOUT_MAX_WEIGHTS(window_size) ((window_size) + BAND_LAYOUT_MAX_BANDS)
+
+// How the spectrum is split up into bands.
+typedef enum
+{
+    // The seven hand tuned bands from 60 Hz upwards
+    BAND_LAYOUT_CLASSIC,
+    // Bands of equal width from 0 Hz up to the nyquist frequency
+    BAND_LAYOUT_LINEAR,
+    // Bands of equal width on a logarithmic frequency scale from 20 Hz to 20 kHz
+    BAND_LAYOUT_LOG,
+    // Overlapping triangular filters of equal width on the mel scale from 20 Hz to 20 kHz
+    BAND_LAYOUT_MEL,
+    // The 31 ISO third octave bands from 20 Hz to 20 kHz
+    BAND_LAYOUT_THIRD_OCTAVE,
+} BandLayout;
+
+// Frequency weighting applied to the band levels.
+typedef enum
+{
+    // Leave every band as it is
+    BAND_WEIGHTING_NONE,
+    // IEC 61672 A-weighting, close to how loud quiet sounds are perceived
+    BAND_WEIGHTING_A,
+    // IEC 61672 C-weighting, close to how loud very loud sounds are perceived
+    BAND_WEIGHTING_C,
+} BandWeighting;
+
+/**
+ * Get the number of bands a layout ends up with.
+ *
+ * @param `bands` number of bands asked for, only used by the layouts that don't have a fixed number of bands
+ */
+int band_layout_get_bands(BandLayout layout, int bands);
+
+/**
+ * Carve the arrays of a matrix out of an arena, with room for any layout of an FFT of up to `window_size`.
+ *
+ * The matrix has no bands until it is filled in by `band_layout_build`, its arrays are freed with the arena.
+ */
+void band_layout_carve_matrix(BandMatrix *matrix, MemoryArena *arena, int window_size);
+
+/**
+ * Compute the bin weights of a band layout for an FFT, replacing whatever `matrix` held before.
+ *
+ * Bands narrower than a bin take the bin closest to their center, so no band is left empty
+ * unless it lies above the nyquist frequency. Nothing is allocated, the matrix is filled in place.
+ *
+ * @param `matrix` matrix to fill in, carved by `band_layout_carve_matrix` for at least `window_size`
+ * @param `frequencies` array of at least `BAND_LAYOUT_MAX_BANDS` floats set to the center frequency of each band
+ * @param `layout` layout to compute
+ * @param `bands` number of bands to ask for, see `band_layout_get_bands`
+ * @param `sample_rate` sample rate of the analysed audio
+ * @param `window_size` length of the FFT
+ */
+void band_layout_build(BandMatrix *matrix,
+                       float *frequencies,
+                       BandLayout layout,
+                       int bands,
+                       guint sample_rate,
+                       int window_size);
+
+/**
+ * Compute the bin weights of a band layout for an FFT of the input decimated by `decimation`.
+ *
+ * The bands are the same as those `band_layout_build` lays out for `sample_rate`, bands above the nyquist
+ * frequency of the decimated signal are left empty.
+ *
+ * @param `window_size` length of the FFT, in decimated samples
+ * @param `decimation` factor the sample rate of the FFT input is divided by, 1 for the input itself
+ */
+void band_layout_build_decimated(BandMatrix *matrix,
+                                 float *frequencies,
+                                 BandLayout layout,
+                                 int bands,
+                                 guint sample_rate,
+                                 int window_size,
+                                 int decimation);
+
+// Get the gain of a frequency weighting at `frequency` in dB.
+float band_layout_get_weighting(BandWeighting weighting, double frequency);
+
+G_END_DECLS
+
+#endif // BAND_LAYOUT_H
@@ -17,37 +17,34 @@
  */
 
 #include <fft/fft.h>
+#include <fft/band-kernel.h>
+#include <fft/spectrum-mailbox.h>
+#include <fft/thread-scheduling.h>
+#include <memory/allocation-guard.h>
+#include <probes/probes.h>
 
-#include <fftw3.h>
 #include <portaudio-common/pa_ringbuffer.h>
 #include <audio-driver/audio-driver.h>
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
 
-// Number of frequency bins to output.
-#define FREQUENCIES (7)
+// Every channel the audio driver can capture must fit in an analysis frame
+G_STATIC_ASSERT(MAX_CHANNELS <= ANALYSIS_MAX_CHANNELS);
 
-// Nyquist bin value (should be half of the sampling frame)
-#define NYQUIST_BIN (FRAMES_PER_BUFFER / 2)
-
-// Defines the number of samples to skip
-#define SKIP_SAMPLES (6)
-
-// Rendering FPS
-#define FPS (60)
-
-// Frequency ranges for each bar
-const unsigned int FREQUENCY_RANGES[FREQUENCIES] = {
-    60, 150, 400, 1000, 2400, 6000, 14000};
-
-// Multipler used to adjust the height of each bar accordingly
-const double FREQUENCY_MULTIPLIER[FREQUENCIES] = {
-    1.5f, 1.5f, 2.5f, 3.0f, 7.5f, 12.5f, 45.0f};
-
-// Max height controller for a bar
-const double MAX_HEIGHT = 0.8f;
+// Plans for every transform of the analysis, in the order of `analysis_core_get_plan_size`.
+typedef struct
+{
+    fftwf_plan plans[ANALYSIS_MAX_PLANS];
+    int count;
+} AudiolizeFFTPlans;
 
 /**
  * Struct used to handle the fourier transform thread and data.
+ *
+ * The analysis itself is done by an `AnalysisCore`, this object feeds it from the audio ring buffer on its own
+ * thread and hands its frames over to the views.
  */
 struct _AudiolizeFFT
 {
@@ -55,373 +52,574 @@ struct _AudiolizeFFT
 
     // Cancellable used for closing the thread.
     GCancellable *canellable;
-
-    // Sample rate of audio data
-    guint sample_rate;
+    // Thread the analysis runs on for the whole lifetime of the object, NULL once it has been joined
+    GThread *thread;
+
+    // Lock and condition used to pause the FFT thread while the object is reconfigured
+    GMutex pause_mutex;
+    GCond pause_cond;
+    // Set by `audiolize_fft_reconfigure` when the FFT thread should pause, protected by `pause_mutex`
+    gboolean pause_requested;
+    // Set by the FFT thread once it has paused, protected by `pause_mutex`
+    gboolean paused;
+    // Whether the FFT thread is running and able to acknowledge a pause, protected by `pause_mutex`
+    gboolean running;
+    // Number of nested `audiolize_fft_pause` calls, only used from the main thread
+    int pause_depth;
+
+    // Whether the FFT thread should run with real-time priority, only changed while the FFT thread is paused
+    gboolean realtime;
+    // CPUs the FFT thread is restricted to like "0,2-3", NULL for every CPU, only changed while the thread is paused
+    char *cpu_affinity;
+    // Set when `realtime` or `cpu_affinity` changed and the FFT thread has to apply them to itself
+    gboolean scheduling_changed;
+
+    // Number of analysis frames computed by the FFT thread, updated atomically
+    guint analysed_frames;
+
+    // Configuration of the analysis, only changed while the FFT thread is paused
+    AnalysisConfig config;
+    // Analysis of the audio input, only used by the FFT thread while it runs
+    AnalysisCore *core;
 
     // Ring buffer reference for input audio data
     PaUtilRingBuffer *audio_rb;
 
-    // Holds the element being read from the input ring buffer
-    AudioData *input_data;
-
-    // FFT output array
-    fftw_complex *out;
-    // FFTW plan
-    fftw_plan fftw_plan;
-    // Array of samples to input to FFTW
-    double *samples;
-
-    // Ring buffer used for rendering output
-    PaUtilRingBuffer *out_rb;
-    // Data array for output ring buffer
-    double *rb_data;
-
-    // Cairo surface for drawing to
-    cairo_surface_t *surface;
+    // Event file descriptor signalled by the audio driver when new data is written to `audio_rb`
+    int wakeup_fd;
+
+    // Estimated capture time of the last frame of the block being analysed in nanoseconds, 0 if it isn't known
+    gint64 block_capture_time;
+    // Number of frames in the block being analysed, it's read straight from the ring buffer
+    int block_frames;
+    // Index of the frame in the block that completes the next analysis frame
+    int next_hop_end;
+
+    // Increased every time the plans of `core` are replaced, protected by `pause_mutex`.
+    // Lets the background planner tell that the plans it measured are out of date.
+    guint plan_generation;
+    // Measured plans waiting to be swapped in by the FFT thread, written once by the background planner
+    AudiolizeFFTPlans *pending_plans;
+    // Plans replaced by `pending_plans`, kept until the next reallocation so the FFT thread never takes the planner lock
+    AudiolizeFFTPlans *retired_plans;
+
+    // Latest analysis frame, written by the FFT thread and read by the views on the main thread
+    SpectrumMailbox *mailbox;
+    // Sender streaming every frame to remote displays, NULL when not streaming. Only changed while the thread is paused
+    BandStreamSender *sender;
+
+    // Time between analysis frames in microseconds, views take this long to animate towards a new frame
+    double animation_period;
+
+    // Sequence number of the newest frame picked up by a view, only used from the main thread
+    guint64 picked_sequence;
+};
 
-    // Next set of bars to render in the next frame
-    int bar_heights[FREQUENCIES];
+static void audiolize_fft_spectrum_source_init(AudiolizeSpectrumSourceInterface *iface);
 
-    /**
-     * Frame rate difference to recording speed.
-     *
-     * Calculated as:
-```python
-audio_hz = (SAMPLE_SIZE/SAMPLE_RATE)*SKIP_FRAMES
+G_DEFINE_FINAL_TYPE_WITH_CODE(AudiolizeFFT, audiolize_fft, G_TYPE_OBJECT,
+                              G_IMPLEMENT_INTERFACE(AUDIOLIZE_TYPE_SPECTRUM_SOURCE, audiolize_fft_spectrum_source_init))
 
-fps_diff = FPS*audio_hz
-```
-     */
-    double fps_diff;
+// Transforms the background plans are measured for.
+typedef struct
+{
+    int sizes[ANALYSIS_MAX_PLANS];
+    int count;
+    int channels;
+    guint generation;
+} AudiolizeFFTPlanShape;
 
-    // Source ID of the rendering timeout
-    guint timeout_id;
+// Destroy a set of plans, NULL is ignored.
+static void
+audiolize_fft_plans_free(AudiolizeFFTPlans *plans)
+{
+    if (plans == NULL)
+        return;
 
-    // Weak reference to GtkDrawingArea to send draw update signal to
-    GtkDrawingArea *drawing_area;
-};
+    for (int i = 0; i < plans->count; i++)
+        analysis_plan_destroy(plans->plans[i]);
+    g_free(plans);
+}
 
-G_DEFINE_FINAL_TYPE(AudiolizeFFT, audiolize_fft, G_TYPE_OBJECT)
+// Whether the object was reconfigured to another shape since `shape` was taken.
+static gboolean
+audiolize_fft_is_shape_stale(AudiolizeFFT *self, const AudiolizeFFTPlanShape *shape)
+{
+    gboolean stale;
 
-// Compute the bar heights for the next frame. This must be done on the main thread to avoid a race condition
-static gboolean audiolize_fft_compute_bar_heights(gpointer user_data);
+    g_mutex_lock(&self->pause_mutex);
+    stale = self->plan_generation != shape->generation;
+    g_mutex_unlock(&self->pause_mutex);
 
-// Render the frame
-static gboolean audiolize_fft_render(gpointer user_data);
+    return stale;
+}
 
+// Thread used to measure better plans than the estimated ones the FFT thread started with.
 static void
-audiolize_fft_thread_cb(GTask *task,
-                        gpointer source_object,
-                        gpointer task_data,
-                        GCancellable *cancellable)
+audiolize_fft_planner_thread_cb(GTask *task,
+                                gpointer source_object,
+                                gpointer task_data,
+                                GCancellable *cancellable)
 {
-    AudiolizeFFT *self;
-    ring_buffer_size_t elements_read, elements_written;
-    // Counter used to skip every Nth sample, this helps slow down the "jumps" in the bars
-    unsigned int counter;
-
-    // This is used for converting the desired frequency to the set bin index
-    double fs_n;
+    AudiolizeFFT *self = source_object;
+    AudiolizeFFTPlanShape *shape = task_data;
+    AudiolizeFFTPlans *plans;
 
-    double output[FREQUENCIES];
-    // Holds the computed amplitude of each K-bin (frequency bin)
-    double mapped_samples[NYQUIST_BIN];
+    plans = g_new0(AudiolizeFFTPlans, 1);
 
-    self = (AudiolizeFFT *)source_object;
-    fs_n = ((double)FRAMES_PER_BUFFER / (double)(self->sample_rate));
+    // Each reconfiguration starts a planner of its own, only the newest one has to take the planner lock.
+    // The plans that already had wisdom are found straight away.
+    for (int i = 0; i < shape->count; i++)
+    {
+        if (audiolize_fft_is_shape_stale(self, shape))
+            break;
 
-    counter = 0;
+        plans->plans[i] = analysis_plan_new(shape->sizes[i], shape->channels, ANALYSIS_PLANNER_FLAGS);
+        if (plans->plans[i] == NULL)
+            break;
+        plans->count++;
+    }
 
-    while (true)
+    if (plans->count < shape->count)
     {
-        int last_frequency;
-        int low_bin;
-        int high_bin;
-        double max_amplitude;
+        audiolize_fft_plans_free(plans);
+        return;
+    }
 
-        if (g_cancellable_is_cancelled(self->canellable))
-            break;
+    analysis_plan_export_wisdom();
 
-        elements_read = PaUtil_ReadRingBuffer(self->audio_rb, self->input_data, 1);
-        if (elements_read == 0)
-            continue;
+    // Hand the plans over to the FFT thread, it swaps them in before its next transform.
+    // The object may have been reconfigured to a different shape while planning, in which case the plans are useless.
+    g_mutex_lock(&self->pause_mutex);
+    if (self->plan_generation == shape->generation)
+    {
+        g_atomic_pointer_set(&self->pending_plans, plans);
+        plans = NULL;
+    }
+    g_mutex_unlock(&self->pause_mutex);
 
-        if ((++counter % SKIP_SAMPLES) != 0)
-            continue;
+    audiolize_fft_plans_free(plans);
+}
 
-        // Get the average of the left and right samples
-        for (int i = 0; i < FRAMES_PER_BUFFER; i++)
-        {
-            // NOTE: Only using left-side of samples
-            double sample = (double)(self->input_data[i * 2]); //  + self->input_data[i * 2 + 1]
-            sample /= 2;
-            self->samples[i] = sample;
-        }
+// Drop the plans made for the previous shape of the analysis.
+static void
+audiolize_fft_clear_plans(AudiolizeFFT *self)
+{
+    audiolize_fft_plans_free(g_atomic_pointer_exchange(&self->pending_plans, NULL));
+    audiolize_fft_plans_free(self->retired_plans);
+    self->retired_plans = NULL;
+}
 
-        // Execute the fourier transform on the input data
-        fftw_execute(self->fftw_plan);
+/**
+ * Start measuring better plans in the background if the core is running on estimated ones.
+ *
+ * This way the first frame isn't delayed by planning, the measured plans are swapped in once they're all ready.
+ * The multi-resolution analysis gets a plan for each of its windows.
+ */
+static void
+audiolize_fft_setup_plan(AudiolizeFFT *self)
+{
+    AudiolizeFFTPlanShape *shape;
+    GTask *task;
 
-        // Compute the amplitude of the FFT output
-        for (int i = 0; i < NYQUIST_BIN; i++)
-        {
-            mapped_samples[i] =
-                sqrt((self->out[i][0] * self->out[i][0]) +
-                     (self->out[i][1] * self->out[i][1])) /
-                FRAMES_PER_BUFFER;
-        }
+    if (!analysis_core_is_plan_estimated(self->core))
+        return;
 
-        last_frequency = FREQUENCY_RANGES[0];
-        for (int i = 1; i < FREQUENCIES; i++)
-        {
-            low_bin = (int)floor(last_frequency * fs_n);
-            high_bin = (int)floor(FREQUENCY_RANGES[i] * fs_n);
+    shape = g_new(AudiolizeFFTPlanShape, 1);
+    shape->count = analysis_core_get_plan_count(self->core);
+    for (int i = 0; i < shape->count; i++)
+        shape->sizes[i] = analysis_core_get_plan_size(self->core, i);
+    shape->channels = analysis_core_get_channels(self->core);
+    shape->generation = self->plan_generation;
 
-            max_amplitude = 0;
-            for (int j = low_bin + 1; j <= high_bin; j++)
-            {
-                if (mapped_samples[j] > max_amplitude)
-                    max_amplitude = mapped_samples[j];
-            }
-            output[i - 1] = max_amplitude;
+    task = g_task_new(self, NULL, NULL, NULL);
+    g_task_set_task_data(task, shape, g_free);
+    g_task_run_in_thread(task, audiolize_fft_planner_thread_cb);
+    g_object_unref(task);
+}
 
-            last_frequency = FREQUENCY_RANGES[i];
-        }
+/**
+ * Block until the audio ring buffer has been written to or the thread is cancelled.
+ *
+ * The wakeup counter is drained before returning so the next call blocks again,
+ * the caller must therefore read the ring buffer until it is empty after this returns.
+ *
+ * @param `cancel_fd` poll descriptor of the thread's cancellable
+ * @return TRUE if the thread was woken up rather than cancelled
+ */
+static gboolean
+audiolize_fft_wait_for_audio(AudiolizeFFT *self, GPollFD *cancel_fd)
+{
+    GPollFD fds[2];
+    uint64_t events;
 
-        low_bin = (int)floor(last_frequency * fs_n);
-        high_bin = NYQUIST_BIN;
+    fds[0] = (GPollFD){.fd = self->wakeup_fd, .events = G_IO_IN, .revents = 0};
+    fds[1] = *cancel_fd;
 
-        max_amplitude = 0;
-        for (int j = low_bin + 1; j < high_bin; j++)
-        {
-            if (mapped_samples[j] > max_amplitude)
-                max_amplitude = mapped_samples[j];
-        }
-        output[FREQUENCIES - 1] = max_amplitude;
+    if (g_poll(fds, 2, -1) <= 0)
+        return FALSE;
 
-        // Send the output data to the ring buffer
-        elements_written = PaUtil_WriteRingBuffer(self->out_rb, output, 1);
+    if (!(fds[0].revents & G_IO_IN))
+        return FALSE;
 
-        if (elements_written == 1)
-            g_main_context_invoke(g_main_context_get_thread_default(),
-                                  audiolize_fft_compute_bar_heights, self);
+    if (read(self->wakeup_fd, &events, sizeof(events)) < 0)
+    {
+        // Another reader drained the counter first, nothing to do.
     }
+
+    return TRUE;
 }
 
+/**
+ * Work out when the newest frame of the block about to be read from the ring buffer was captured.
+ *
+ * The audio callback only timestamps the newest frame it wrote, every frame still in the ring buffer after
+ * that one was captured a frame period earlier.
+ *
+ * @note Must be called before the block is released from the ring buffer.
+ */
 static void
-audiolize_fft_finished_cb(GObject *source_object,
-                          GAsyncResult *result,
-                          gpointer data)
+audiolize_fft_stamp_block(AudiolizeFFT *self, int frames)
 {
-    g_print("Thread closed\n");
+    gint64 write_time, capture_time;
+    int remaining;
+
+    probes_get_audio_written(&write_time, &capture_time);
+
+    remaining = PaUtil_GetRingBufferReadAvailable(self->audio_rb) / self->config.input_channels - frames;
+
+    self->block_frames = frames;
+    self->next_hop_end = self->config.hop_size - analysis_core_get_buffered_frames(self->core);
+    self->block_capture_time = 0;
+    if (capture_time != 0)
+        self->block_capture_time = capture_time - (gint64)remaining * 1000000000 / self->config.sample_rate;
 }
 
+/**
+ * Acknowledge a pause request and block until the object has been reconfigured.
+ *
+ * @note Must only be called from the FFT thread.
+ */
 static void
-audiolize_fft_init(AudiolizeFFT *self)
+audiolize_fft_pause_point(AudiolizeFFT *self)
+{
+    g_mutex_lock(&self->pause_mutex);
+
+    self->paused = TRUE;
+    g_cond_broadcast(&self->pause_cond);
+
+    // The thread may be cancelled while paused, for example when the application quits during a device switch
+    while (self->pause_requested && !g_cancellable_is_cancelled(self->canellable))
+        g_cond_wait(&self->pause_cond, &self->pause_mutex);
+
+    self->paused = FALSE;
+
+    g_mutex_unlock(&self->pause_mutex);
+}
+
+// Mark the FFT thread as stopped so reconfiguring never waits on a thread that's gone.
+static void
+audiolize_fft_thread_stopped(AudiolizeFFT *self)
 {
+    g_mutex_lock(&self->pause_mutex);
+    self->running = FALSE;
+    g_cond_broadcast(&self->pause_cond);
+    g_mutex_unlock(&self->pause_mutex);
 }
 
-// Clear the surface and fill it with a color.
+// Publish an analysis frame to the mailbox, replacing any frame the views haven't picked up yet.
 static void
-audiolize_fft_clear_surface(AudiolizeFFT *self)
+audiolize_fft_publish_frame_cb(const float *levels, int channels, int bands, gpointer user_data)
 {
-    cairo_t *cr;
+    AudiolizeFFT *self = user_data;
+    SpectrumFrame *frame;
+    gint64 capture_time;
+
+    frame = spectrum_mailbox_begin_write(self->mailbox);
+    memcpy(frame->values, levels, sizeof(float) * channels * bands);
+    frame->timestamp = g_get_monotonic_time();
+
+    // The frame ends with the input frame that completed its hop, somewhere in the block
+    frame->capture_time = 0;
+    if (self->block_capture_time != 0)
+        frame->capture_time = self->block_capture_time - (gint64)(self->block_frames - self->next_hop_end) *
+                                                             1000000000 / self->config.sample_rate;
+    self->next_hop_end += self->config.hop_size;
+    frame->channels = channels;
+    frame->bands = bands;
+    capture_time = frame->capture_time;
+    spectrum_mailbox_publish(self->mailbox);
+
+    // Remote displays get the capture time on the wall clock, the monotonic clock means nothing on another machine
+    if (self->sender != NULL)
+    {
+        if (capture_time != 0)
+            capture_time = g_get_real_time() - (probe_now() - capture_time) / 1000;
 
-    cr = cairo_create(self->surface);
-    cairo_set_source_rgba(cr, 0, 0, 0, 0);
-    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-    cairo_paint(cr);
-    cairo_destroy(cr);
+        band_stream_sender_push(self->sender, levels, channels, bands, (guint)lrint(self->animation_period),
+                                capture_time);
+    }
+
+    g_atomic_int_inc(&self->analysed_frames);
 }
 
-void audiolize_fft_resize_surface(AudiolizeFFT *self,
-                                  gint width,
-                                  gint height)
+/**
+ * Analyse the next `frames` frames in place in the ring buffer, then release them to the audio driver.
+ *
+ * The frames may wrap around the end of the ring buffer, which splits them into two regions. When the number
+ * of channels doesn't divide the size of the ring buffer a frame can straddle the wrap, that single frame is
+ * put back together on the stack. Everything else is converted straight into the analysis window.
+ */
+static void
+audiolize_fft_process_ring_buffer(AudiolizeFFT *self, int frames)
 {
-    if (self->surface != NULL)
+    int channels = self->config.input_channels;
+    ring_buffer_size_t size1, size2;
+    void *data1, *data2;
+    AudioData straddling[MAX_CHANNELS];
+    int head, tail;
+
+    PaUtil_GetRingBufferReadRegions(self->audio_rb, frames * channels, &data1, &size1, &data2, &size2);
+
+    // Whole frames at the end of the ring buffer, and samples of a frame cut off by the wrap
+    head = size1 / channels;
+    tail = size1 % channels;
+
+    if (head > 0)
+        analysis_core_process(self->core, data1, head, audiolize_fft_publish_frame_cb, self);
+
+    if (tail > 0)
     {
-        cairo_surface_destroy(self->surface);
-        self->surface = NULL;
+        memcpy(straddling, (AudioData *)data1 + head * channels, sizeof(AudioData) * tail);
+        memcpy(straddling + tail, data2, sizeof(AudioData) * (channels - tail));
+        analysis_core_process(self->core, straddling, 1, audiolize_fft_publish_frame_cb, self);
+
+        data2 = (AudioData *)data2 + (channels - tail);
+        size2 -= channels - tail;
     }
 
-    // Setup the Cairo surface for rendering
-    self->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-                                               width,
-                                               height);
+    if (size2 > 0)
+        analysis_core_process(self->core, data2, size2 / channels, audiolize_fft_publish_frame_cb, self);
 
-    audiolize_fft_clear_surface(self);
+    // Only now can the audio callback write over the frames
+    PaUtil_AdvanceRingBufferReadIndex(self->audio_rb, frames * channels);
 }
 
-static gboolean
-audiolize_fft_compute_bar_heights(gpointer user_data)
+/**
+ * Apply the requested priority and CPU affinity to the FFT thread.
+ *
+ * Neither is fatal, the analysis keeps running at normal priority on any CPU when they are refused.
+ *
+ * @note Must only be called from the FFT thread, while no reconfiguration is in progress.
+ */
+static void
+audiolize_fft_apply_scheduling(AudiolizeFFT *self)
 {
-    AudiolizeFFT *self;
-    int height;
-    double fft_output[FREQUENCIES];
-    ring_buffer_size_t elements_read;
+    ThreadScheduling scheduling;
 
-    self = user_data;
+    self->scheduling_changed = FALSE;
 
-    elements_read = PaUtil_ReadRingBuffer(self->out_rb, fft_output, 1);
-    if (elements_read == 0)
-        return G_SOURCE_REMOVE;
+    scheduling = thread_scheduling_set_realtime(self->realtime);
+    if (self->realtime && scheduling == THREAD_SCHEDULING_NORMAL)
+        fprintf(stderr, "ERROR: Real-time priority was refused, the FFT thread keeps its normal priority\n");
+    else
+        g_print("Running the FFT thread with %s\n", thread_scheduling_get_description(scheduling));
 
-    // Ensure the surface exists before rendering
-    if (self->surface == NULL)
-        return G_SOURCE_REMOVE;
+    thread_scheduling_set_affinity(self->cpu_affinity);
+}
+
+static gpointer
+audiolize_fft_thread_func(gpointer data)
+{
+    AudiolizeFFT *self = data;
 
-    height = cairo_image_surface_get_height(self->surface);
+    // Used to wake the thread up when it is cancelled while waiting for audio
+    GPollFD cancel_fd;
 
-    // Draw the FFT graph
-    // g_print("[");
-    for (int i = 0; i < FREQUENCIES; i++)
+    if (!g_cancellable_make_pollfd(self->canellable, &cancel_fd))
     {
-        int bar_height;
-        // Let's scale the FFT output values up by x10 to easier reflect amplitudes
-        fft_output[i] *= 10;
-        // We can now multiply it by the max height of the surface we'd like to use
-        fft_output[i] *= height * FREQUENCY_MULTIPLIER[i] * MAX_HEIGHT;
+        fprintf(stderr, "ERROR: Could not create a poll descriptor for the FFT thread!\n");
+        audiolize_fft_thread_stopped(self);
+        return NULL;
+    }
 
-        bar_height = (int)ceil(fft_output[i]);
+    while (true)
+    {
+        int frames;
+        AudiolizeFFTPlans *plans;
 
-        self->bar_heights[i] = bar_height;
+        if (g_cancellable_is_cancelled(self->canellable))
+            break;
 
-        // g_print("%d,", bar_height);
-    }
-    // g_print("]\n");
+        if (g_atomic_int_get(&self->pause_requested))
+        {
+            audiolize_fft_pause_point(self);
+            continue;
+        }
 
-    return G_SOURCE_REMOVE;
-}
+        // Only changed while the thread was paused, so it can be read without the lock
+        if (self->scheduling_changed)
+            audiolize_fft_apply_scheduling(self);
 
-static gboolean
-audiolize_fft_render(gpointer user_data)
-{
-    // The current height of the bars from the last render
-    static int current_bar_heights[FREQUENCIES] = {0};
-    AudiolizeFFT *self;
-    int width, height, bar_width;
-    cairo_t *cr;
+        // Read as many whole frames as are available, up to a block at a time
+        frames = PaUtil_GetRingBufferReadAvailable(self->audio_rb) / self->config.input_channels;
+        frames = MIN(frames, FRAMES_PER_BUFFER);
+        if (frames == 0)
+        {
+            // Sleep until the audio driver has written more data instead of spinning on the ring buffer
+            if (audiolize_fft_wait_for_audio(self, &cancel_fd))
+            {
+                gint64 write_time, capture_time;
 
-    // Padding between bars
-    const int PADDING = 6;
+                probes_get_audio_written(&write_time, &capture_time);
+                probe_record_since(PROBE_WAKEUP, write_time);
+            }
+            continue;
+        }
 
-    self = user_data;
+        // Analysing a block never allocates, everything it needs was sized when the analysis was configured.
+        // Only the transforms themselves are left to FFTW, see `allocation_guard_suspend`.
+        allocation_guard_enter();
 
-    // Ensure the surface exists before rendering
-    if (self->surface == NULL)
-        return G_SOURCE_REMOVE;
+        audiolize_fft_stamp_block(self, frames);
 
-    width = cairo_image_surface_get_width(self->surface);
-    height = cairo_image_surface_get_height(self->surface);
+        // Swap in the measured plans as soon as the background planner has finished with them. The estimated
+        // plans take their place in the same set, so retiring them doesn't allocate.
+        plans = g_atomic_pointer_exchange(&self->pending_plans, NULL);
+        if (plans != NULL)
+        {
+            analysis_core_swap_plans(self->core, plans->plans);
+            self->retired_plans = plans;
+        }
 
-    bar_width = width / FREQUENCIES;
+        audiolize_fft_process_ring_buffer(self, frames);
 
-    cr = cairo_create(self->surface);
+        allocation_guard_leave();
+    }
 
-    audiolize_fft_clear_surface(self);
+    g_cancellable_release_fd(self->canellable);
+    audiolize_fft_thread_stopped(self);
 
-    // Draw the FFT graph
-    for (int i = 0; i < FREQUENCIES; i++)
-    {
-        int bar_height = current_bar_heights[i];
-        double bar_diff = self->bar_heights[i] - bar_height;
+    return NULL;
+}
+
+static void
+audiolize_fft_init(AudiolizeFFT *self)
+{
+    g_mutex_init(&self->pause_mutex);
+    g_cond_init(&self->pause_cond);
+}
+
+int audiolize_fft_read_levels(AudiolizeFFT *self, guint64 *sequence, float *levels, gint64 *capture_time)
+{
+    const SpectrumFrame *frame;
+    int bars;
 
-        bar_diff /= self->fps_diff;
-        bar_height += bar_diff;
+    // Views may already have picked the newest frame up, so look at its sequence number instead of `is_new`
+    frame = spectrum_mailbox_read(self->mailbox, NULL);
+    if (frame == NULL || frame->sequence <= *sequence)
+        return 0;
 
-        current_bar_heights[i] = bar_height;
+    // The FFT thread already normalized the levels, views only have to scale them to their height
+    bars = frame->channels * frame->bands;
+    memcpy(levels, frame->values, sizeof(float) * bars);
 
-        cairo_set_source_rgb(cr, 1, 0, 0);
-        cairo_rectangle(cr, (i * bar_width) + PADDING, height - bar_height, bar_width - (PADDING * 2), bar_height);
-        cairo_fill(cr);
+    // Every frame is only timed once, by the first view that picks it up
+    if (frame->sequence > self->picked_sequence)
+    {
+        probe_record(PROBE_HANDOFF, (g_get_monotonic_time() - frame->timestamp) * 1000);
+        self->picked_sequence = frame->sequence;
     }
 
-    // Only call the draw queue is the drawing area still exists
-    if (self->drawing_area != NULL)
-        gtk_widget_queue_draw(GTK_WIDGET(self->drawing_area));
+    *sequence = frame->sequence;
+    *capture_time = frame->capture_time;
 
-    cairo_destroy(cr);
+    return bars;
+}
 
-    return G_SOURCE_CONTINUE;
+double audiolize_fft_get_frame_interval(AudiolizeFFT *self)
+{
+    return self->animation_period;
 }
 
-void audiolize_fft_paint_surface(AudiolizeFFT *self,
-                                 cairo_t *cr,
-                                 int width,
-                                 int height)
+static int
+audiolize_fft_source_read_levels(AudiolizeSpectrumSource *source,
+                                 guint64 *sequence,
+                                 float *levels,
+                                 gint64 *capture_time)
 {
-    cairo_set_source_surface(cr, self->surface, 0, 0);
-    cairo_paint(cr);
+    return audiolize_fft_read_levels(AUDIOLIZE_FFT(source), sequence, levels, capture_time);
 }
 
-// Used to set the drawing area to NULL on destruction.
-// This is mainly needed if the app is being closed but the fft thread is still running.
-static void
-unref_drawing_area(gpointer data,
-                   GObject *disposed_object)
+static double
+audiolize_fft_source_get_frame_interval(AudiolizeSpectrumSource *source)
 {
-    AudiolizeFFT *self = data;
+    return audiolize_fft_get_frame_interval(AUDIOLIZE_FFT(source));
+}
 
-    self->drawing_area = NULL;
+static void
+audiolize_fft_spectrum_source_init(AudiolizeSpectrumSourceInterface *iface)
+{
+    iface->read_levels = audiolize_fft_source_read_levels;
+    iface->get_frame_interval = audiolize_fft_source_get_frame_interval;
 }
 
 /**
- * Setup the FFT object fully: this involves allocating memory and starting the FFT thread.
+ * Apply `config` to the analysis core.
  *
- * @note This MUST be called immediately after the object is created in the `audiolize_fft_new` function.
+ * @note The FFT thread must be paused or not started yet.
  */
 static void
-audiolize_fft_setup(AudiolizeFFT *self, guint sample_rate, gpointer audio_rb, GtkDrawingArea *drawing_area)
+audiolize_fft_apply_config(AudiolizeFFT *self)
 {
-    ring_buffer_size_t rb_size;
-    GTask *task;
-    double audio_hz;
-
-    self->sample_rate = sample_rate;
-
-    audio_hz = ((double)FRAMES_PER_BUFFER / (double)sample_rate) * SKIP_SAMPLES;
-    self->fps_diff = audio_hz * FPS;
-
-    self->audio_rb = audio_rb;
-
-    // Setup output ring buffer
-    self->rb_data = (double *)g_malloc(sizeof(double) * FREQUENCIES * RING_BUFFER_SIZE);
-    self->out_rb = (PaUtilRingBuffer *)g_new0(PaUtilRingBuffer, 1);
-    rb_size = PaUtil_InitializeRingBuffer(self->out_rb,
-                                          sizeof(double) * FREQUENCIES,
-                                          RING_BUFFER_SIZE,
-                                          self->rb_data);
-
-    if (rb_size < 0)
+    if (analysis_core_configure(self->core, &self->config))
     {
-        fprintf(stderr, "ERROR: Could not initialize output ring buffer!\n");
-        g_free(self->rb_data);
-        g_free(self->out_rb);
-        return;
+        // Updated before dropping the pending plan, so a background planner still running can't hand in a stale one
+        g_mutex_lock(&self->pause_mutex);
+        self->plan_generation++;
+        g_mutex_unlock(&self->pause_mutex);
+
+        audiolize_fft_clear_plans(self);
+        audiolize_fft_setup_plan(self);
     }
 
-    // Allocate memory for the input data from the ringn buffer
-    self->input_data = (AudioData *)g_malloc(AUDIO_FRAME_SIZE);
+    // The core clamps the number of channels to what it supports
+    self->config.input_channels = analysis_core_get_config(self->core)->input_channels;
 
-    // Setup allocations for FFTW
-    self->samples = (double *)fftw_malloc(sizeof(double) * FRAMES_PER_BUFFER);
-    self->out = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * FRAMES_PER_BUFFER);
-    self->fftw_plan = fftw_plan_dft_r2c_1d(FRAMES_PER_BUFFER, self->samples, self->out, FFTW_MEASURE);
+    self->animation_period = (double)self->config.hop_size * G_USEC_PER_SEC / (double)self->config.sample_rate;
+}
 
-    // Set the drawing surface to NULL and create a weak reference to the drawing area
-    self->surface = NULL;
-    g_object_weak_ref(G_OBJECT(drawing_area), unref_drawing_area, self);
-    self->drawing_area = drawing_area;
+/**
+ * Setup the FFT object fully: this involves allocating memory and starting the FFT thread.
+ *
+ * @note This MUST be called immediately after the object is created in the `audiolize_fft_new` function.
+ */
+static void
+audiolize_fft_setup(AudiolizeFFT *self,
+                    guint sample_rate,
+                    int channels,
+                    gpointer audio_rb,
+                    int wakeup_fd)
+{
+    self->wakeup_fd = wakeup_fd;
+    self->audio_rb = audio_rb;
+    g_print("Using the %s band kernel\n", band_kernel_get_name());
 
-    self->timeout_id = g_timeout_add((guint)ceil((1000.0f / FPS)), audiolize_fft_render, self);
+    // Setup the output mailbox
+    self->mailbox = spectrum_mailbox_new(AUDIOLIZE_FFT_MAX_BARS);
 
-    // Start the thread for handling the audio data
-    self->canellable = g_cancellable_new();
-    task = g_task_new(self, self->canellable, audiolize_fft_finished_cb, NULL);
-    // g_task_set_return_on_cancel(task, true); // Ensure the thread closes when cancelled
+    // Setup the analysis with the default settings, measuring a better plan in the background if there was no wisdom
+    analysis_config_init(&self->config, sample_rate, channels);
+    self->core = analysis_core_new(&self->config);
+    self->config = *analysis_core_get_config(self->core);
+    self->animation_period = (double)self->config.hop_size * G_USEC_PER_SEC / (double)self->config.sample_rate;
+    audiolize_fft_setup_plan(self);
 
-    g_task_run_in_thread(task, audiolize_fft_thread_cb);
-    g_object_unref(task);
+    // Start the thread for handling the audio data. It's a thread of its own rather than one borrowed from
+    // GLib's pool, so its priority and affinity stay with the analysis and never leak into unrelated tasks.
+    self->running = TRUE;
+    self->canellable = g_cancellable_new();
+    self->thread = g_thread_new("audiolize-fft", audiolize_fft_thread_func, self);
 }
 
 static void
@@ -432,25 +630,20 @@ audiolize_fft_finalize(GObject *gobject)
     g_print("Closing FFT object\n");
 
     self = AUDIOLIZE_FFT(gobject);
-    g_object_unref(self->canellable);
 
-    // Remove the timeout instance
-    g_source_remove(self->timeout_id);
-
-    if (self->surface != NULL)
-    {
-        cairo_surface_destroy(self->surface);
-        self->surface = NULL;
-    }
+    // The thread doesn't hold a reference, so it may still be running if it was never cancelled
+    audiolize_fft_cancel_task(self);
+    g_object_unref(self->canellable);
+    g_free(self->cpu_affinity);
 
-    fftw_destroy_plan(self->fftw_plan);
-    fftw_free(self->out);
-    fftw_free(self->samples);
+    audiolize_fft_clear_plans(self);
+    analysis_core_free(self->core);
+    g_clear_pointer(&(self->sender), band_stream_sender_free);
 
-    g_free(self->input_data);
+    g_mutex_clear(&self->pause_mutex);
+    g_cond_clear(&self->pause_cond);
 
-    g_free(self->rb_data);
-    g_free(self->out_rb);
+    spectrum_mailbox_free(self->mailbox);
 
     G_OBJECT_CLASS(audiolize_fft_parent_class)->finalize(gobject);
 }
@@ -461,22 +654,164 @@ audiolize_fft_class_init(AudiolizeFFTClass *klass)
     GObjectClass *object_class = G_OBJECT_CLASS(klass);
 
     object_class->finalize = audiolize_fft_finalize;
-
-    // Ensure the nyquist frequency is exactly half of the frame per buffer
-    g_assert(FRAMES_PER_BUFFER == (NYQUIST_BIN * 2));
 }
 
 void audiolize_fft_cancel_task(AudiolizeFFT *self)
 {
+    if (self->thread == NULL)
+        return;
+
+    // The cancellable wakes the thread up if it's waiting for audio, so this only waits for the current block
     g_cancellable_cancel(self->canellable);
+
+    // It may also be paused, waiting on the condition instead
+    g_mutex_lock(&self->pause_mutex);
+    g_cond_broadcast(&self->pause_cond);
+    g_mutex_unlock(&self->pause_mutex);
+
+    g_thread_join(self->thread);
+    self->thread = NULL;
+
+    g_print("Thread closed\n");
+}
+
+void audiolize_fft_pause(AudiolizeFFT *self)
+{
+    const uint64_t event = 1;
+
+    if (self->pause_depth++ > 0)
+        return;
+
+    g_mutex_lock(&self->pause_mutex);
+
+    // Wake the FFT thread up in case it's waiting for audio
+    g_atomic_int_set(&self->pause_requested, TRUE);
+    if (write(self->wakeup_fd, &event, sizeof(event)) < 0)
+        fprintf(stderr, "ERROR: Could not wake up the FFT thread!\n");
+
+    while (self->running && !self->paused)
+        g_cond_wait(&self->pause_cond, &self->pause_mutex);
+
+    g_mutex_unlock(&self->pause_mutex);
+}
+
+void audiolize_fft_resume(AudiolizeFFT *self)
+{
+    g_return_if_fail(self->pause_depth > 0);
+
+    if (--self->pause_depth > 0)
+        return;
+
+    g_mutex_lock(&self->pause_mutex);
+    g_atomic_int_set(&self->pause_requested, FALSE);
+    g_cond_broadcast(&self->pause_cond);
+    g_mutex_unlock(&self->pause_mutex);
+}
+
+void audiolize_fft_reconfigure(AudiolizeFFT *self, guint sample_rate, int channels, gpointer audio_rb)
+{
+    audiolize_fft_pause(self);
+
+    self->config.sample_rate = sample_rate;
+    self->config.input_channels = channels;
+    self->audio_rb = audio_rb;
+    // The window keeps its duration rather than its size in samples
+    analysis_config_apply_preset(&self->config, self->config.preset);
+    audiolize_fft_apply_config(self);
+
+    // Discard whatever is left in the ring buffer, it may have been written with a different number of channels.
+    // Only the reader side is touched, so this is safe while the audio callback keeps writing.
+    PaUtil_AdvanceRingBufferReadIndex(audio_rb, PaUtil_GetRingBufferReadAvailable(audio_rb));
+
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_get_stats(AudiolizeFFT *self, AudiolizeFFTStats *stats)
+{
+    stats->analysed_frames = g_atomic_int_get(&self->analysed_frames);
 }
 
-AudiolizeFFT *audiolize_fft_new(guint sample_rate, gpointer audio_rb, GtkDrawingArea *drawing_area)
+void audiolize_fft_set_channel_mode(AudiolizeFFT *self, AnalysisChannelMode mode)
+{
+    audiolize_fft_pause(self);
+    self->config.channel_mode = mode;
+    audiolize_fft_apply_config(self);
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_set_preset(AudiolizeFFT *self, AnalysisPreset preset)
+{
+    audiolize_fft_pause(self);
+    analysis_config_apply_preset(&self->config, preset);
+    audiolize_fft_apply_config(self);
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_set_band_layout(AudiolizeFFT *self, BandLayout layout, int bands)
+{
+    // Only the weights change, the buffers and plans stay as they are
+    audiolize_fft_pause(self);
+    self->config.band_layout = layout;
+    self->config.bands = bands;
+    audiolize_fft_apply_config(self);
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_set_weighting(AudiolizeFFT *self, BandWeighting weighting)
+{
+    audiolize_fft_pause(self);
+    self->config.weighting = weighting;
+    audiolize_fft_apply_config(self);
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_set_window_function(AudiolizeFFT *self, WindowFunction function)
+{
+    audiolize_fft_pause(self);
+    self->config.window_function = function;
+    audiolize_fft_apply_config(self);
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_set_auto_gain(AudiolizeFFT *self, gboolean auto_gain)
+{
+    audiolize_fft_pause(self);
+    self->config.auto_gain = auto_gain;
+    audiolize_fft_apply_config(self);
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_set_scheduling(AudiolizeFFT *self, gboolean realtime, const char *cpu_affinity)
+{
+    // An empty list means every CPU, like no list at all
+    if (cpu_affinity != NULL && cpu_affinity[0] == '\0')
+        cpu_affinity = NULL;
+
+    audiolize_fft_pause(self);
+    self->realtime = realtime;
+    g_free(self->cpu_affinity);
+    self->cpu_affinity = g_strdup(cpu_affinity);
+    self->scheduling_changed = TRUE;
+    audiolize_fft_resume(self);
+}
+
+void audiolize_fft_set_sender(AudiolizeFFT *self, BandStreamSender *sender)
+{
+    audiolize_fft_pause(self);
+    g_clear_pointer(&(self->sender), band_stream_sender_free);
+    self->sender = sender;
+    audiolize_fft_resume(self);
+}
+
+AudiolizeFFT *audiolize_fft_new(guint sample_rate,
+                                int channels,
+                                gpointer audio_rb,
+                                int wakeup_fd)
 {
     AudiolizeFFT *fft = AUDIOLIZE_FFT(g_object_new(AUDIOLIZE_TYPE_FFT,
                                                    NULL));
 
-    audiolize_fft_setup(fft, sample_rate, audio_rb, drawing_area);
+    audiolize_fft_setup(fft, sample_rate, channels, audio_rb, wakeup_fd);
 
     return fft;
-}
\ No newline at end of file
+}
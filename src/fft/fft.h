@@ -20,31 +20,142 @@
 #define FFT_H
 
 #include <gtk/gtk.h>
+#include <fft/analysis-core.h>
+#include <fft/spectrum-source.h>
+#include <network/band-stream.h>
 
 G_BEGIN_DECLS
 
+// Largest number of bars in a single analysis frame.
+#define AUDIOLIZE_FFT_MAX_BARS (ANALYSIS_MAX_VALUES)
+
 #define AUDIOLIZE_TYPE_FFT (audiolize_fft_get_type())
 
 G_DECLARE_FINAL_TYPE(AudiolizeFFT, audiolize_fft, AUDIOLIZE, FFT, GObject)
 
+// FFT counters, all of them only ever increase while the object exists.
+typedef struct
+{
+    // Number of analysis frames computed. Frames the renderer never picked up are replaced, not dropped.
+    guint analysed_frames;
+} AudiolizeFFTStats;
+
 /**
  * Create a new FFT struct and start its thread.
  *
  * @param `sample_rate` sample rate of the audio input
+ * @param `channels` number of interleaved channels in the audio input
  * @param `audio_rb` ring buffer pointer for the incomming audio data from portaudio
- * @param `drawing_area` drawing area widget
+ * @param `wakeup_fd` event file descriptor signalled whenever `audio_rb` is written to
+ *
+ * The FFT object doesn't draw anything itself, any number of views can show its output through
+ * `audiolize_fft_read_levels`, or through the `AudiolizeSpectrumSource` interface it implements.
+ * It starts with the defaults of `analysis_config_init`.
  */
-AudiolizeFFT *audiolize_fft_new(guint sample_rate, gpointer audio_rb, GtkDrawingArea *drawing_area);
+AudiolizeFFT *audiolize_fft_new(guint sample_rate,
+                                int channels,
+                                gpointer audio_rb,
+                                int wakeup_fd);
 
-// Resizes the Cairo surface for rendering.
-void audiolize_fft_resize_surface(AudiolizeFFT *self, gint width, gint height);
+/**
+ * Copy the bar levels of the newest analysis frame, as fractions of the view height from 0 to 1.
+ *
+ * Every view keeps its own `sequence`, so any number of views can read the same frame.
+ * This must only be called from the main thread.
+ *
+ * @param `sequence` sequence number of the last frame read by the view, 0 if it never read one.
+ * Updated whenever a newer frame is returned.
+ * @param `levels` array of at least `AUDIOLIZE_FFT_MAX_BARS` floats to write the levels to
+ * @param `capture_time` set to the `probe_now` time the audio of the frame was captured at, 0 if it isn't known
+ *
+ * @returns the number of bars written to `levels`, or 0 if there is no frame newer than `sequence`
+ */
+int audiolize_fft_read_levels(AudiolizeFFT *self, guint64 *sequence, float *levels, gint64 *capture_time);
 
-// Copies the surface to the drawing area. Doesn't actually update the surface.
-void audiolize_fft_paint_surface(AudiolizeFFT *self, cairo_t *cr, int width, int height);
+// Time between two analysis frames in microseconds, views should take this long to animate towards new levels.
+double audiolize_fft_get_frame_interval(AudiolizeFFT *self);
 
-// Cancel the FFT thread.
+// Cancel the FFT thread and wait for it to finish, the FFT object is finalized the same way.
 void audiolize_fft_cancel_task(AudiolizeFFT *self);
 
+/**
+ * Pause the FFT thread and block until it has stopped reading the audio ring buffer.
+ *
+ * Calls can be nested, the thread only continues once every pause is matched by `audiolize_fft_resume`.
+ */
+void audiolize_fft_pause(AudiolizeFFT *self);
+
+// Let the FFT thread continue after `audiolize_fft_pause`.
+void audiolize_fft_resume(AudiolizeFFT *self);
+
+/**
+ * Switch the FFT object over to a new audio input without restarting its thread.
+ *
+ * The FFT thread is paused while the configuration is swapped and resumed afterwards.
+ *
+ * @param `sample_rate` sample rate of the new audio input
+ * @param `channels` number of interleaved channels in the new audio input
+ * @param `audio_rb` ring buffer pointer for the incomming audio data from portaudio
+ */
+void audiolize_fft_reconfigure(AudiolizeFFT *self, guint sample_rate, int channels, gpointer audio_rb);
+
+/**
+ * Change the priority and CPU affinity of the FFT thread.
+ *
+ * The thread applies them to itself, asking RTKit or the realtime portal for real-time priority when it isn't
+ * allowed to switch on its own. Refusals are only logged: the analysis keeps running at normal priority.
+ *
+ * @param `realtime` whether the FFT thread should run with SCHED_FIFO priority
+ * @param `cpu_affinity` CPUs to run the FFT thread on like "0,2-3", NULL or empty for every CPU
+ */
+void audiolize_fft_set_scheduling(AudiolizeFFT *self, gboolean realtime, const char *cpu_affinity);
+
+/**
+ * Stream every analysis frame to remote displays, on top of handing it to the views.
+ *
+ * Frames are sent from the FFT thread as they're published, so the analysis runs once for any number of displays.
+ *
+ * @param `sender` sender to push the frames to, owned by the object from now on. NULL to stop streaming.
+ */
+void audiolize_fft_set_sender(AudiolizeFFT *self, BandStreamSender *sender);
+
+/**
+ * Change how the channels of the audio input are analysed.
+ *
+ * Mid/side analysis falls back to a mono mix for single channel inputs.
+ */
+void audiolize_fft_set_channel_mode(AudiolizeFFT *self, AnalysisChannelMode mode);
+
+/**
+ * Change the trade-off between frequency resolution and latency, the balanced preset is used until this is called.
+ *
+ * The window and hop sizes follow the sample rate of the input, also when it's switched over to another one.
+ */
+void audiolize_fft_set_preset(AudiolizeFFT *self, AnalysisPreset preset);
+
+/**
+ * Change how the spectrum is split up into bands.
+ *
+ * @param `bands` number of bands for the linear, log and mel layouts, the other layouts have a fixed number of bands
+ */
+void audiolize_fft_set_band_layout(AudiolizeFFT *self, BandLayout layout, int bands);
+
+// Change the window function applied to the analysis windows, Hann is used until this is called.
+void audiolize_fft_set_window_function(AudiolizeFFT *self, WindowFunction function);
+
+// Change the frequency weighting applied to the band levels.
+void audiolize_fft_set_weighting(AudiolizeFFT *self, BandWeighting weighting);
+
+/**
+ * Choose whether the levels follow the loudness of the input.
+ *
+ * With automatic gain the loudest recent band is shown close to the top of the view, otherwise the top is 0 dBFS.
+ */
+void audiolize_fft_set_auto_gain(AudiolizeFFT *self, gboolean auto_gain);
+
+// Get a snapshot of the FFT counters.
+void audiolize_fft_get_stats(AudiolizeFFT *self, AudiolizeFFTStats *stats);
+
 G_END_DECLS
 
 #endif // FFT_H
\ No newline at end of file
@@ -0,0 +1,126 @@
+/* spectrum-mailbox.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fft/spectrum-mailbox.h>
+#include <memory/memory-arena.h>
+
+// Set in `middle` when the frame it refers to hasn't been taken by the reader yet
+#define SLOT_NEW (4)
+// Mask of the frame index in `middle`
+#define SLOT_INDEX (3)
+
+struct _SpectrumMailbox
+{
+    // The three frames swapped between the writer and reader, each on cache lines of its own so the writer
+    // filling one never slows the reader down on another
+    SpectrumFrame *frames[3];
+    // Arena the frames are carved from
+    MemoryArena arena;
+    // Largest number of band values a frame can hold
+    int max_values;
+
+    // Index of the frame owned by the writer
+    int back;
+    // Index of the frame shared between the writer and reader, combined with `SLOT_NEW`. Only accessed atomically.
+    gint middle;
+    // Index of the frame owned by the reader
+    int front;
+
+    // Sequence number of the next frame to publish, only used by the writer
+    guint64 next_sequence;
+    // Whether anything was ever published, only used by the reader
+    gboolean has_frame;
+};
+
+SpectrumMailbox *spectrum_mailbox_new(int max_values)
+{
+    SpectrumMailbox *mailbox;
+    gsize frame_size = sizeof(SpectrumFrame) + sizeof(float) * max_values;
+
+    mailbox = g_new0(SpectrumMailbox, 1);
+    mailbox->max_values = max_values;
+
+    memory_arena_init(&mailbox->arena);
+    for (int i = 0; i < 3; i++)
+        memory_arena_carve(&mailbox->arena, frame_size);
+
+    if (!memory_arena_allocate(&mailbox->arena))
+        g_error("Could not allocate the spectrum mailbox");
+
+    for (int i = 0; i < 3; i++)
+        mailbox->frames[i] = memory_arena_carve(&mailbox->arena, frame_size);
+
+    mailbox->back = 0;
+    mailbox->middle = 1;
+    mailbox->front = 2;
+
+    // Sequence 0 is left for readers that never saw a frame
+    mailbox->next_sequence = 1;
+
+    return mailbox;
+}
+
+void spectrum_mailbox_free(SpectrumMailbox *mailbox)
+{
+    if (mailbox == NULL)
+        return;
+
+    memory_arena_clear(&mailbox->arena);
+    g_free(mailbox);
+}
+
+int spectrum_mailbox_get_max_values(SpectrumMailbox *mailbox)
+{
+    return mailbox->max_values;
+}
+
+SpectrumFrame *spectrum_mailbox_begin_write(SpectrumMailbox *mailbox)
+{
+    return mailbox->frames[mailbox->back];
+}
+
+void spectrum_mailbox_publish(SpectrumMailbox *mailbox)
+{
+    gint previous;
+
+    mailbox->frames[mailbox->back]->sequence = mailbox->next_sequence++;
+
+    // Hand our frame over and take whichever frame was shared, the reader has either finished with it or never saw it
+    previous = g_atomic_int_exchange(&mailbox->middle, mailbox->back | SLOT_NEW);
+    mailbox->back = previous & SLOT_INDEX;
+}
+
+const SpectrumFrame *spectrum_mailbox_read(SpectrumMailbox *mailbox, gboolean *is_new)
+{
+    gboolean fresh;
+
+    fresh = (g_atomic_int_get(&mailbox->middle) & SLOT_NEW) != 0;
+
+    if (fresh)
+    {
+        gint previous = g_atomic_int_exchange(&mailbox->middle, mailbox->front);
+
+        mailbox->front = previous & SLOT_INDEX;
+        mailbox->has_frame = TRUE;
+    }
+
+    if (is_new != NULL)
+        *is_new = fresh;
+
+    return mailbox->has_frame ? mailbox->frames[mailbox->front] : NULL;
+}
@@ -0,0 +1,82 @@
+/* spectrum-mailbox.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPECTRUM_MAILBOX_H
+#define SPECTRUM_MAILBOX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// A single analysis frame: the band values of every analysed channel.
+typedef struct _SpectrumFrame
+{
+    // Number of the frame, increasing by one for every frame published
+    guint64 sequence;
+    // Monotonic time at which the frame was analysed, in microseconds
+    gint64 timestamp;
+    // Monotonic time at which the newest sample of the frame was captured, in nanoseconds, 0 if it isn't known
+    gint64 capture_time;
+    // Number of analysed channels in the frame
+    int channels;
+    // Number of bands of each channel
+    int bands;
+    // Band values, `bands` values for each channel one after the other
+    float values[];
+} SpectrumFrame;
+
+/**
+ * Single-slot mailbox holding the latest spectrum frame.
+ *
+ * This is a triple buffer: one writer thread and one reader thread each own a frame, and a third frame
+ * is swapped between them atomically. The writer never waits for the reader and the reader always gets
+ * the newest frame, older frames are simply overwritten instead of being queued.
+ */
+typedef struct _SpectrumMailbox SpectrumMailbox;
+
+// Create a new mailbox for frames of up to `max_values` band values.
+SpectrumMailbox *spectrum_mailbox_new(int max_values);
+
+void spectrum_mailbox_free(SpectrumMailbox *mailbox);
+
+// Get the largest number of band values a frame can hold.
+int spectrum_mailbox_get_max_values(SpectrumMailbox *mailbox);
+
+/**
+ * Get the frame the writer should fill in next.
+ *
+ * @note Must only be called from the writer thread, the frame is only valid until `spectrum_mailbox_publish`.
+ */
+SpectrumFrame *spectrum_mailbox_begin_write(SpectrumMailbox *mailbox);
+
+// Publish the frame returned by `spectrum_mailbox_begin_write`, replacing any frame the reader hasn't taken yet.
+void spectrum_mailbox_publish(SpectrumMailbox *mailbox);
+
+/**
+ * Get the newest published frame.
+ *
+ * @note Must only be called from the reader thread, the frame stays valid until the next call.
+ *
+ * @param `is_new` set to whether a frame was published since the last call, may be NULL
+ * @return the newest frame, or NULL if nothing was ever published
+ */
+const SpectrumFrame *spectrum_mailbox_read(SpectrumMailbox *mailbox, gboolean *is_new);
+
+G_END_DECLS
+
+#endif // SPECTRUM_MAILBOX_H
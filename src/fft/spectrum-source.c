@@ -0,0 +1,43 @@
+/* spectrum-source.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fft/spectrum-source.h>
+
+G_DEFINE_INTERFACE(AudiolizeSpectrumSource, audiolize_spectrum_source, G_TYPE_OBJECT)
+
+static void
+audiolize_spectrum_source_default_init(AudiolizeSpectrumSourceInterface *iface)
+{
+}
+
+int audiolize_spectrum_source_read_levels(AudiolizeSpectrumSource *self,
+                                          guint64 *sequence,
+                                          float *levels,
+                                          gint64 *capture_time)
+{
+    g_return_val_if_fail(AUDIOLIZE_IS_SPECTRUM_SOURCE(self), 0);
+
+    return AUDIOLIZE_SPECTRUM_SOURCE_GET_IFACE(self)->read_levels(self, sequence, levels, capture_time);
+}
+
+double audiolize_spectrum_source_get_frame_interval(AudiolizeSpectrumSource *self)
+{
+    g_return_val_if_fail(AUDIOLIZE_IS_SPECTRUM_SOURCE(self), 1);
+
+    return AUDIOLIZE_SPECTRUM_SOURCE_GET_IFACE(self)->get_frame_interval(self);
+}
@@ -0,0 +1,69 @@
+/* spectrum-source.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPECTRUM_SOURCE_H
+#define SPECTRUM_SOURCE_H
+
+#include <glib-object.h>
+#include <fft/analysis-core.h>
+
+G_BEGIN_DECLS
+
+// Largest number of bars a source hands out at once.
+#define AUDIOLIZE_SPECTRUM_SOURCE_MAX_BARS (ANALYSIS_MAX_VALUES)
+
+#define AUDIOLIZE_TYPE_SPECTRUM_SOURCE (audiolize_spectrum_source_get_type())
+
+G_DECLARE_INTERFACE(AudiolizeSpectrumSource, audiolize_spectrum_source, AUDIOLIZE, SPECTRUM_SOURCE, GObject)
+
+/**
+ * Anything the views can take bar levels from: the live FFT, or a precomputed spectrum file.
+ */
+struct _AudiolizeSpectrumSourceInterface
+{
+    GTypeInterface parent_iface;
+
+    int (*read_levels)(AudiolizeSpectrumSource *self, guint64 *sequence, float *levels, gint64 *capture_time);
+    double (*get_frame_interval)(AudiolizeSpectrumSource *self);
+};
+
+/**
+ * Copy the bar levels of the newest frame, as fractions of the view height from 0 to 1.
+ *
+ * Every view keeps its own `sequence`, so any number of views can read the same frame.
+ * This must only be called from the main thread.
+ *
+ * @param `sequence` sequence number of the last frame read by the view, 0 if it never read one.
+ * Updated whenever a newer frame is returned.
+ * @param `levels` array of at least `AUDIOLIZE_SPECTRUM_SOURCE_MAX_BARS` floats to write the levels to
+ * @param `capture_time` set to the `probe_now` time the audio of the frame was captured at whenever a frame is
+ * returned, 0 if it isn't known. Views keep it until their frame is painted to time the latency of what they show.
+ *
+ * @returns the number of bars written to `levels`, or 0 if there is no frame newer than `sequence`
+ */
+int audiolize_spectrum_source_read_levels(AudiolizeSpectrumSource *self,
+                                          guint64 *sequence,
+                                          float *levels,
+                                          gint64 *capture_time);
+
+// Time between two frames in microseconds, views should take this long to animate towards new levels.
+double audiolize_spectrum_source_get_frame_interval(AudiolizeSpectrumSource *self);
+
+G_END_DECLS
+
+#endif // SPECTRUM_SOURCE_H
@@ -0,0 +1,265 @@
+/* thread-scheduling.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Needed for the CPU set macros, pthread_setaffinity_np and the gettid system call
+#define _GNU_SOURCE
+
+#include <fft/thread-scheduling.h>
+
+#include <gio/gio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define RTKIT_NAME "org.freedesktop.RealtimeKit1"
+#define RTKIT_PATH "/org/freedesktop/RealtimeKit1"
+
+#define PORTAL_NAME "org.freedesktop.portal.Desktop"
+#define PORTAL_PATH "/org/freedesktop/portal/desktop"
+#define PORTAL_INTERFACE "org.freedesktop.portal.Realtime"
+
+// How long to wait for RTKit or the portal to answer, in milliseconds
+#define DBUS_TIMEOUT (2000)
+
+const char *
+thread_scheduling_get_description(ThreadScheduling scheduling)
+{
+    switch (scheduling)
+    {
+    case THREAD_SCHEDULING_SCHED_FIFO:
+        return "real-time priority";
+    case THREAD_SCHEDULING_RTKIT:
+        return "real-time priority from RTKit";
+    case THREAD_SCHEDULING_PORTAL:
+        return "real-time priority from the realtime portal";
+    case THREAD_SCHEDULING_NORMAL:
+    default:
+        return "normal priority";
+    }
+}
+
+// Read an integer property of RTKit or the portal, returns `fallback` if it can't be read.
+static gint64
+thread_scheduling_get_property(GDBusConnection *bus,
+                               const char *name,
+                               const char *path,
+                               const char *interface,
+                               const char *property,
+                               gint64 fallback)
+{
+    GVariant *reply, *value;
+    gint64 result = fallback;
+
+    reply = g_dbus_connection_call_sync(bus, name, path, "org.freedesktop.DBus.Properties", "Get",
+                                        g_variant_new("(ss)", interface, property), G_VARIANT_TYPE("(v)"),
+                                        G_DBUS_CALL_FLAGS_NONE, DBUS_TIMEOUT, NULL, NULL);
+    if (reply == NULL)
+        return fallback;
+
+    g_variant_get(reply, "(v)", &value);
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_INT32))
+        result = g_variant_get_int32(value);
+    else if (g_variant_is_of_type(value, G_VARIANT_TYPE_INT64))
+        result = g_variant_get_int64(value);
+
+    g_variant_unref(value);
+    g_variant_unref(reply);
+    return result;
+}
+
+// Ask RTKit, or the realtime portal when `portal` is set, to make the calling thread real-time.
+static gboolean
+thread_scheduling_request_realtime(gboolean portal, int priority)
+{
+    const char *name = portal ? PORTAL_NAME : RTKIT_NAME;
+    const char *path = portal ? PORTAL_PATH : RTKIT_PATH;
+    const char *interface = portal ? PORTAL_INTERFACE : RTKIT_NAME;
+    guint64 tid = syscall(SYS_gettid);
+    GError *error = NULL;
+    GDBusConnection *bus;
+    GVariant *parameters, *reply;
+    struct rlimit limit;
+    gint64 rttime, max_priority;
+
+    bus = g_bus_get_sync(portal ? G_BUS_TYPE_SESSION : G_BUS_TYPE_SYSTEM, NULL, &error);
+    if (bus == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not connect to %s: %s\n", name, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    // Both refuse threads that could lock up the system, so the CPU time they may take without blocking
+    // has to be limited first. Only the soft limit is lowered, an unprivileged process can never raise the
+    // hard limit again, which would keep the whole process on this limit after switching back.
+    rttime = thread_scheduling_get_property(bus, name, path, interface, "RTTimeUSecMax", 200000);
+    if (getrlimit(RLIMIT_RTTIME, &limit) != 0)
+        fprintf(stderr, "ERROR: Could not get the real-time CPU time limit: %s\n", strerror(errno));
+    else if (limit.rlim_cur > (rlim_t)rttime)
+    {
+        limit.rlim_cur = rttime;
+        if (setrlimit(RLIMIT_RTTIME, &limit) != 0)
+            fprintf(stderr, "ERROR: Could not limit the real-time CPU time: %s\n", strerror(errno));
+    }
+
+    max_priority = thread_scheduling_get_property(bus, name, path, interface, "MaxRealtimePriority", priority);
+    priority = MIN(priority, (int)max_priority);
+
+    parameters = portal ? g_variant_new("(ttu)", (guint64)getpid(), tid, (guint32)priority)
+                                  : g_variant_new("(tu)", tid, (guint32)priority);
+    reply = g_dbus_connection_call_sync(bus, name, path, interface,
+                                        portal ? "MakeThreadRealtimeWithPID" : "MakeThreadRealtime",
+                                        parameters, NULL, G_DBUS_CALL_FLAGS_NONE, DBUS_TIMEOUT, NULL, &error);
+    g_object_unref(bus);
+
+    if (reply == NULL)
+    {
+        fprintf(stderr, "ERROR: %s refused real-time priority: %s\n", name, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    g_variant_unref(reply);
+    return TRUE;
+}
+
+ThreadScheduling
+thread_scheduling_set_realtime(gboolean realtime)
+{
+    struct sched_param param = {.sched_priority = 0};
+    gboolean sandboxed;
+
+    if (!realtime)
+    {
+        // Lowering the priority is always allowed, whoever raised it
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        return THREAD_SCHEDULING_NORMAL;
+    }
+
+    param.sched_priority = THREAD_SCHEDULING_REALTIME_PRIORITY;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0)
+        return THREAD_SCHEDULING_SCHED_FIFO;
+
+    // Without privileges, ask the daemon that hands out real-time priority. The sandbox can't reach RTKit on
+    // the system bus and has its own thread ids, so it goes through the portal which translates them.
+    sandboxed = g_file_test("/.flatpak-info", G_FILE_TEST_EXISTS);
+    if (thread_scheduling_request_realtime(sandboxed, THREAD_SCHEDULING_REALTIME_PRIORITY))
+        return sandboxed ? THREAD_SCHEDULING_PORTAL : THREAD_SCHEDULING_RTKIT;
+
+    return THREAD_SCHEDULING_NORMAL;
+}
+
+// Parse a CPU list like "0,2-3" into `cpus`, which may be NULL to only validate it.
+static gboolean
+thread_scheduling_parse_cpu_list(const char *list, cpu_set_t *cpus)
+{
+    const char *cursor = list;
+    char *end;
+    guint64 first, last;
+
+    if (cpus != NULL)
+        CPU_ZERO(cpus);
+
+    while (*cursor != '\0')
+    {
+        while (g_ascii_isspace(*cursor))
+            cursor++;
+        if (*cursor == '\0')
+            break;
+
+        first = g_ascii_strtoull(cursor, &end, 10);
+        if (end == cursor)
+            return FALSE;
+        last = first;
+        cursor = end;
+
+        if (*cursor == '-')
+        {
+            cursor++;
+            last = g_ascii_strtoull(cursor, &end, 10);
+            if (end == cursor || last < first)
+                return FALSE;
+            cursor = end;
+        }
+
+        if (last >= CPU_SETSIZE)
+            return FALSE;
+
+        if (cpus != NULL)
+        {
+            for (guint64 cpu = first; cpu <= last; cpu++)
+                CPU_SET(cpu, cpus);
+        }
+
+        while (g_ascii_isspace(*cursor))
+            cursor++;
+        if (*cursor == ',')
+            cursor++;
+        else if (*cursor != '\0')
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean
+thread_scheduling_is_valid_cpu_list(const char *cpus)
+{
+    return cpus == NULL || thread_scheduling_parse_cpu_list(cpus, NULL);
+}
+
+gboolean
+thread_scheduling_set_affinity(const char *cpus)
+{
+    cpu_set_t set;
+    int error;
+
+    if (cpus == NULL)
+        cpus = "";
+
+    if (!thread_scheduling_parse_cpu_list(cpus, &set))
+    {
+        fprintf(stderr, "ERROR: Invalid CPU list \"%s\"\n", cpus);
+        return FALSE;
+    }
+
+    if (CPU_COUNT(&set) == 0)
+    {
+        // The main thread keeps the affinity the process was started with, the sandbox or a launcher like
+        // taskset may have narrowed it
+        if (sched_getaffinity(getpid(), sizeof(set), &set) != 0)
+        {
+            fprintf(stderr, "ERROR: Could not get the CPU affinity of the process: %s\n", strerror(errno));
+            return FALSE;
+        }
+    }
+
+    error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0)
+    {
+        fprintf(stderr, "ERROR: Could not set the CPU affinity to \"%s\": %s\n", cpus, strerror(error));
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,69 @@
+/* thread-scheduling.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_SCHEDULING_H
+#define THREAD_SCHEDULING_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Real-time priority asked for, RTKit grants up to 20 by default which leaves room for the audio server above
+#define THREAD_SCHEDULING_REALTIME_PRIORITY (10)
+
+// How a thread ended up being scheduled.
+typedef enum
+{
+    // Normal time sharing, either because it was asked for or because real-time scheduling was refused
+    THREAD_SCHEDULING_NORMAL,
+    // SCHED_FIFO set by the process itself, when it's allowed to
+    THREAD_SCHEDULING_SCHED_FIFO,
+    // SCHED_FIFO granted by RTKit over the system bus
+    THREAD_SCHEDULING_RTKIT,
+    // SCHED_FIFO granted by the realtime portal, from inside the Flatpak sandbox
+    THREAD_SCHEDULING_PORTAL,
+} ThreadScheduling;
+
+// Get a description of how a thread is scheduled, for the logs.
+const char *thread_scheduling_get_description(ThreadScheduling scheduling);
+
+/**
+ * Switch the calling thread to real-time scheduling, or back to normal.
+ *
+ * The thread is first switched directly, which only works with the right privileges. Otherwise RTKit is asked
+ * to do it, or the realtime portal inside of Flatpak. Nothing is fatal: if every way is refused the thread
+ * simply keeps its normal priority.
+ *
+ * @note This blocks on D-Bus, so it must not be called from a thread that has to stay responsive.
+ */
+ThreadScheduling thread_scheduling_set_realtime(gboolean realtime);
+
+// Whether a CPU list like "0,2-3" is valid, an empty list is valid and means every CPU.
+gboolean thread_scheduling_is_valid_cpu_list(const char *cpus);
+
+/**
+ * Restrict the calling thread to a list of CPUs like "0,2-3".
+ *
+ * @param `cpus` CPUs to run on, NULL or empty to run on every CPU the process may run on
+ * @return FALSE if the list is invalid or the affinity couldn't be set
+ */
+gboolean thread_scheduling_set_affinity(const char *cpus);
+
+G_END_DECLS
+
+#endif // THREAD_SCHEDULING_H
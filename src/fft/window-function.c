@@ -0,0 +1,95 @@
+/* window-function.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fft/window-function.h>
+
+#include <math.h>
+
+// Sum of cosines window: a0 - a1 cos(x) + a2 cos(2x) - a3 cos(3x) + ...
+static double
+window_function_cosine_sum(const double *terms, int count, double x)
+{
+    double value = 0;
+
+    for (int k = 0; k < count; k++)
+        value += ((k % 2) == 0 ? 1 : -1) * terms[k] * cos(k * x);
+
+    return value;
+}
+
+// Zeroth order modified Bessel function of the first kind, from its power series.
+static double
+window_function_bessel_i0(double x)
+{
+    double sum = 1, term = 1;
+
+    for (int k = 1; k < 64 && term > sum * 1e-12; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+
+    return sum;
+}
+
+void window_function_fill(WindowFunction function, float *coefficients, int size)
+{
+    static const double HANN[] = {0.5, 0.5};
+    static const double BLACKMAN_HARRIS[] = {0.35875, 0.48829, 0.14128, 0.01168};
+    static const double FLAT_TOP[] = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+    double sum = 0;
+
+    for (int i = 0; i < size; i++)
+    {
+        // The periodic form of each window, which is what a DFT of a continuous signal wants
+        double x = 2.0 * G_PI * i / size;
+        double value;
+
+        switch (function)
+        {
+        case WINDOW_FUNCTION_HANN:
+            value = window_function_cosine_sum(HANN, G_N_ELEMENTS(HANN), x);
+            break;
+        case WINDOW_FUNCTION_BLACKMAN_HARRIS:
+            value = window_function_cosine_sum(BLACKMAN_HARRIS, G_N_ELEMENTS(BLACKMAN_HARRIS), x);
+            break;
+        case WINDOW_FUNCTION_FLAT_TOP:
+            value = window_function_cosine_sum(FLAT_TOP, G_N_ELEMENTS(FLAT_TOP), x);
+            break;
+        case WINDOW_FUNCTION_KAISER:
+        {
+            double r = 2.0 * i / size - 1.0;
+
+            value = window_function_bessel_i0(WINDOW_FUNCTION_KAISER_BETA * sqrt(1.0 - r * r)) /
+                    window_function_bessel_i0(WINDOW_FUNCTION_KAISER_BETA);
+            break;
+        }
+        case WINDOW_FUNCTION_RECTANGULAR:
+        default:
+            value = 1;
+            break;
+        }
+
+        coefficients[i] = value;
+        sum += value;
+    }
+
+    // Undo the coherent gain of the window
+    for (int i = 0; i < size; i++)
+        coefficients[i] *= size / sum;
+}
@@ -0,0 +1,56 @@
+/* window-function.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WINDOW_FUNCTION_H
+#define WINDOW_FUNCTION_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Window function the analysis windows are multiplied with before the FFT.
+typedef enum
+{
+    // No window at all, leaks the most but has the narrowest peaks
+    WINDOW_FUNCTION_RECTANGULAR,
+    // Good all round choice with little leakage
+    WINDOW_FUNCTION_HANN,
+    // Four term Blackman-Harris, very little leakage at the cost of wider peaks
+    WINDOW_FUNCTION_BLACKMAN_HARRIS,
+    // Kaiser window with a beta of `WINDOW_FUNCTION_KAISER_BETA`
+    WINDOW_FUNCTION_KAISER,
+    // Flat top window, the most accurate amplitudes with the widest peaks
+    WINDOW_FUNCTION_FLAT_TOP,
+} WindowFunction;
+
+// Shape parameter of the Kaiser window
+#define WINDOW_FUNCTION_KAISER_BETA (8.6)
+
+/**
+ * Fill `coefficients` with a window function.
+ *
+ * The coefficients are scaled to a mean of 1, so a sine wave keeps its amplitude whichever window is used.
+ *
+ * @param `coefficients` array of `size` floats to fill in
+ * @param `size` length of the window
+ */
+void window_function_fill(WindowFunction function, float *coefficients, int size);
+
+G_END_DECLS
+
+#endif // WINDOW_FUNCTION_H
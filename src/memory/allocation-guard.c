@@ -0,0 +1,134 @@
+/* allocation-guard.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <memory/allocation-guard.h>
+
+#ifdef AUDIOLIZE_ALLOCATION_GUARD
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The allocator of glibc, which the functions below forward to once they have checked the calling thread
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *memory, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *memory);
+
+// Number of guarded sections the calling thread is in
+static _Thread_local int guard_depth;
+
+void allocation_guard_enter(void)
+{
+    guard_depth++;
+}
+
+void allocation_guard_leave(void)
+{
+    guard_depth--;
+}
+
+int allocation_guard_suspend(void)
+{
+    int depth = guard_depth;
+
+    guard_depth = 0;
+    return depth;
+}
+
+void allocation_guard_resume(int depth)
+{
+    guard_depth = depth;
+}
+
+// Abort if the calling thread is in a guarded section.
+static void
+allocation_guard_check(void)
+{
+    static const char message[] = "ERROR: The heap was used in a real-time section!\n";
+
+    if (G_LIKELY(guard_depth <= 0))
+        return;
+
+    // Reported without stdio, which may allocate. The section is left so aborting can allocate as it likes.
+    guard_depth = 0;
+    if (write(STDERR_FILENO, message, sizeof(message) - 1) < 0)
+    {
+        // Nowhere left to report it, the abort still shows up in a debugger or core dump
+    }
+    abort();
+}
+
+void *malloc(size_t size)
+{
+    allocation_guard_check();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocation_guard_check();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *memory, size_t size)
+{
+    allocation_guard_check();
+    return __libc_realloc(memory, size);
+}
+
+void free(void *memory)
+{
+    if (memory == NULL)
+        return;
+
+    allocation_guard_check();
+    __libc_free(memory);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    allocation_guard_check();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    allocation_guard_check();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memory, size_t alignment, size_t size)
+{
+    void *result;
+
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    allocation_guard_check();
+    result = __libc_memalign(alignment, size);
+    if (result == NULL)
+        return ENOMEM;
+
+    *memory = result;
+    return 0;
+}
+
+#endif // AUDIOLIZE_ALLOCATION_GUARD
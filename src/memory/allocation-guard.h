@@ -0,0 +1,71 @@
+/* allocation-guard.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALLOCATION_GUARD_H
+#define ALLOCATION_GUARD_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Debug check that the real-time paths never touch the heap.
+ *
+ * Between `allocation_guard_enter` and `allocation_guard_leave` any `malloc`, `free` or one of their relatives
+ * called on the same thread aborts the application, whoever calls it. This is how the audio callback and the
+ * FFT thread are kept allocation free: their buffers all come from arenas sized before they run.
+ *
+ * The guard is only built into debug builds, where `AUDIOLIZE_ALLOCATION_GUARD` is defined, and costs nothing
+ * elsewhere. Sections nest. A rare path such as reporting an error suspends the guard around itself instead of
+ * leaving it, since it may also run outside of any section.
+ *
+ * `fftwf_execute_dft_r2c` is the one call of the guarded paths that is always suspended. FFTW's buffered solvers
+ * take their scratch buffers from the heap when they don't fit on the stack, and which solvers a measured plan
+ * ends up with can't be told from outside. Restricting the planner to solvers that never buffer would give
+ * slower plans everywhere, so the transforms are trusted to FFTW instead.
+ */
+#ifdef AUDIOLIZE_ALLOCATION_GUARD
+
+// Start a section of the calling thread in which the heap must not be used.
+void allocation_guard_enter(void);
+
+// End the section started by the matching `allocation_guard_enter`.
+void allocation_guard_leave(void);
+
+/**
+ * Let the calling thread use the heap until `allocation_guard_resume`, whether it's in a guarded section or not.
+ *
+ * @return the number of sections the thread was in, to hand to `allocation_guard_resume`
+ */
+int allocation_guard_suspend(void);
+
+// Put the sections suspended by `allocation_guard_suspend` back.
+void allocation_guard_resume(int depth);
+
+#else
+
+#define allocation_guard_enter() ((void)0)
+#define allocation_guard_leave() ((void)0)
+#define allocation_guard_suspend() (0)
+#define allocation_guard_resume(depth) ((void)(depth))
+
+#endif
+
+G_END_DECLS
+
+#endif // ALLOCATION_GUARD_H
@@ -0,0 +1,69 @@
+/* memory-arena.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <memory/memory-arena.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+void memory_arena_init(MemoryArena *arena)
+{
+    arena->data = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+gpointer memory_arena_carve(MemoryArena *arena, gsize size)
+{
+    gsize offset = (arena->used + MEMORY_ARENA_ALIGNMENT - 1) & ~(gsize)(MEMORY_ARENA_ALIGNMENT - 1);
+
+    arena->used = offset + size;
+    if (arena->data == NULL)
+        return NULL;
+
+    // The regions carved after allocating must be the ones that were measured
+    g_return_val_if_fail(arena->used <= arena->size, NULL);
+
+    return arena->data + offset;
+}
+
+gboolean memory_arena_allocate(MemoryArena *arena)
+{
+    void *data;
+    gsize size = MAX(arena->used, MEMORY_ARENA_ALIGNMENT);
+
+    g_return_val_if_fail(arena->data == NULL, FALSE);
+
+    if (posix_memalign(&data, MEMORY_ARENA_ALIGNMENT, size) != 0)
+        return FALSE;
+
+    // Zeroed once for all of the regions, which also faults every page in before the arena is used
+    memset(data, 0, size);
+
+    arena->data = data;
+    arena->size = size;
+    arena->used = 0;
+
+    return TRUE;
+}
+
+void memory_arena_clear(MemoryArena *arena)
+{
+    free(arena->data);
+    memory_arena_init(arena);
+}
@@ -0,0 +1,75 @@
+/* memory-arena.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Alignment of every region carved from an arena, a cache line and wide enough for any SIMD load
+#define MEMORY_ARENA_ALIGNMENT (64)
+
+/**
+ * A single aligned block of memory, carved into the arrays of something that is sized up front.
+ *
+ * An arena is laid out in two passes of the same code. Carving from an arena that isn't allocated yet only adds up
+ * the space needed, then `memory_arena_allocate` gets all of it at once and carving starts over from the front.
+ * Every region starts on its own `MEMORY_ARENA_ALIGNMENT` boundary, so two regions never share a cache line.
+ * The regions are only ever freed together, with `memory_arena_clear`.
+ */
+typedef struct
+{
+    // Memory the regions are carved from, NULL while the arena is only measured
+    guint8 *data;
+    // Size of `data` in bytes
+    gsize size;
+    // Number of bytes carved so far, including the padding between regions
+    gsize used;
+} MemoryArena;
+
+// Setup an arena that isn't allocated yet, ready to be measured.
+void memory_arena_init(MemoryArena *arena);
+
+/**
+ * Carve the next region out of an arena.
+ *
+ * @return the region filled with zeros, or NULL while the arena is only measured
+ */
+gpointer memory_arena_carve(MemoryArena *arena, gsize size);
+
+// Carve an array of `count` elements of `type` out of an arena, see `memory_arena_carve`.
+#define memory_arena_carve_array(arena, type, count) \
+    ((type *)memory_arena_carve((arena), sizeof(type) * (gsize)(count)))
+
+/**
+ * Allocate all the space measured so far, carving then starts over from the front.
+ *
+ * The same regions must be carved again in the same order.
+ *
+ * @return FALSE if the memory couldn't be allocated, the arena is then left as it was
+ */
+gboolean memory_arena_allocate(MemoryArena *arena);
+
+// Free the memory of an arena and all the regions carved from it, it can then be measured again.
+void memory_arena_clear(MemoryArena *arena);
+
+G_END_DECLS
+
+#endif // MEMORY_ARENA_H
@@ -0,0 +1,334 @@
+/* band-stream.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <network/band-stream.h>
+#include <memory/allocation-guard.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+// Address frames are streamed to.
+typedef struct
+{
+    // Address as it was given, for error messages
+    char *name;
+    GSocket *socket;
+    GSocketAddress *address;
+    // `address` converted for `sendto`, so sending never has to go through GIO, which reports errors by allocating
+    struct sockaddr_storage native_address;
+    gsize native_address_size;
+    // Whether sending to it failed last time, so a destination that's down is only reported once
+    gboolean failing;
+} BandStreamDestination;
+
+struct _BandStreamSender
+{
+    SpectrumFileFormat format;
+    BandStreamDestination *destinations;
+    int destination_count;
+
+    // Datagram being filled, `size` bytes of it are used and it holds no frame while that's 0
+    guint8 packet[BAND_STREAM_MAX_DATAGRAM_SIZE];
+    gsize size;
+    // Header of the datagram being filled
+    BandStreamHeader header;
+    // Monotonic time the first frame of the datagram was queued at
+    gint64 batch_start;
+    // Sequence number of the next frame
+    guint64 sequence;
+};
+
+static void
+band_stream_put_u16(guint8 *data, guint16 value)
+{
+    value = GUINT16_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static void
+band_stream_put_u32(guint8 *data, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static void
+band_stream_put_u64(guint8 *data, guint64 value)
+{
+    value = GUINT64_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static guint16
+band_stream_get_u16(const guint8 *data)
+{
+    guint16 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT16_FROM_LE(value);
+}
+
+static guint32
+band_stream_get_u32(const guint8 *data)
+{
+    guint32 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT32_FROM_LE(value);
+}
+
+static guint64
+band_stream_get_u64(const guint8 *data)
+{
+    guint64 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT64_FROM_LE(value);
+}
+
+// Size of a frame in a datagram with this header, in bytes.
+static gsize
+band_stream_get_frame_size(const BandStreamHeader *header)
+{
+    return BAND_STREAM_FRAME_HEADER_SIZE +
+           (gsize)header->channels * header->bands * spectrum_file_format_get_size(header->format);
+}
+
+gboolean band_stream_parse_header(const guint8 *data, gsize size, BandStreamHeader *header)
+{
+    guint format;
+
+    if (size < BAND_STREAM_HEADER_SIZE ||
+        memcmp(data, BAND_STREAM_MAGIC, 4) != 0 ||
+        band_stream_get_u16(data + 4) != BAND_STREAM_VERSION)
+        return FALSE;
+
+    format = band_stream_get_u16(data + 6);
+    if (format > SPECTRUM_FILE_FORMAT_U8)
+        return FALSE;
+
+    header->format = format;
+    header->channels = band_stream_get_u16(data + 8);
+    header->bands = band_stream_get_u16(data + 10);
+    header->frame_interval = band_stream_get_u32(data + 12);
+    header->frames = band_stream_get_u32(data + 16);
+    header->sequence = band_stream_get_u64(data + 24);
+
+    if (header->channels < 1 || header->channels > ANALYSIS_MAX_CHANNELS ||
+        header->bands < 1 || header->bands > BAND_LAYOUT_MAX_BANDS ||
+        header->frames < 1)
+        return FALSE;
+
+    return header->frames <= (size - BAND_STREAM_HEADER_SIZE) / band_stream_get_frame_size(header);
+}
+
+void band_stream_read_frame(const guint8 *data,
+                            const BandStreamHeader *header,
+                            guint index,
+                            gint64 *capture_time,
+                            float *levels)
+{
+    const guint8 *frame = data + BAND_STREAM_HEADER_SIZE + index * band_stream_get_frame_size(header);
+
+    g_return_if_fail(index < header->frames);
+
+    *capture_time = (gint64)band_stream_get_u64(frame);
+    spectrum_file_dequantize(header->format, frame + BAND_STREAM_FRAME_HEADER_SIZE,
+                             header->channels * header->bands, levels);
+}
+
+/**
+ * Resolve a destination and open a socket for it.
+ *
+ * @return FALSE if the address couldn't be resolved or the socket couldn't be opened
+ */
+static gboolean
+band_stream_destination_open(BandStreamDestination *destination, const char *name)
+{
+    GSocketConnectable *connectable;
+    GSocketAddressEnumerator *enumerator;
+    GError *error = NULL;
+
+    destination->name = g_strdup(name);
+
+    connectable = g_network_address_parse(name, BAND_STREAM_DEFAULT_PORT, &error);
+    if (connectable != NULL)
+    {
+        enumerator = g_socket_connectable_enumerate(connectable);
+        destination->address = g_socket_address_enumerator_next(enumerator, NULL, &error);
+        g_object_unref(enumerator);
+        g_object_unref(connectable);
+    }
+
+    if (destination->address == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not resolve stream destination %s: %s\n",
+                name, error != NULL ? error->message : "No address found");
+        g_clear_error(&error);
+        return FALSE;
+    }
+
+    destination->socket = g_socket_new(g_socket_address_get_family(destination->address),
+                                       G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error);
+    if (destination->socket == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not open a socket for %s: %s\n", name, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    destination->native_address_size = g_socket_address_get_native_size(destination->address);
+    if (!g_socket_address_to_native(destination->address, &destination->native_address,
+                                    sizeof(destination->native_address), &error))
+    {
+        fprintf(stderr, "ERROR: Could not use the address of %s: %s\n", name, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    // Frames are sent from the FFT thread, a busy network must never hold it up
+    g_socket_set_blocking(destination->socket, FALSE);
+    if (g_socket_address_get_family(destination->address) == G_SOCKET_FAMILY_IPV4)
+        g_socket_set_broadcast(destination->socket, TRUE);
+
+    return TRUE;
+}
+
+BandStreamSender *band_stream_sender_new(const char *const *destinations, SpectrumFileFormat format)
+{
+    BandStreamSender *sender;
+
+    sender = g_new0(BandStreamSender, 1);
+    sender->format = format;
+    sender->destination_count = g_strv_length((gchar **)destinations);
+    sender->destinations = g_new0(BandStreamDestination, sender->destination_count);
+
+    for (int i = 0; i < sender->destination_count; i++)
+    {
+        if (!band_stream_destination_open(&sender->destinations[i], destinations[i]))
+        {
+            band_stream_sender_free(sender);
+            return NULL;
+        }
+    }
+
+    return sender;
+}
+
+void band_stream_sender_free(BandStreamSender *sender)
+{
+    for (int i = 0; i < sender->destination_count; i++)
+    {
+        g_free(sender->destinations[i].name);
+        g_clear_object(&(sender->destinations[i].socket));
+        g_clear_object(&(sender->destinations[i].address));
+    }
+
+    g_free(sender->destinations);
+    g_free(sender);
+}
+
+// Send the datagram being filled to every destination.
+static void
+band_stream_sender_flush(BandStreamSender *sender)
+{
+    if (sender->size == 0)
+        return;
+
+    memcpy(sender->packet, BAND_STREAM_MAGIC, 4);
+    band_stream_put_u16(sender->packet + 4, BAND_STREAM_VERSION);
+    band_stream_put_u16(sender->packet + 6, sender->header.format);
+    band_stream_put_u16(sender->packet + 8, sender->header.channels);
+    band_stream_put_u16(sender->packet + 10, sender->header.bands);
+    band_stream_put_u32(sender->packet + 12, sender->header.frame_interval);
+    band_stream_put_u32(sender->packet + 16, sender->header.frames);
+    band_stream_put_u32(sender->packet + 20, 0);
+    band_stream_put_u64(sender->packet + 24, sender->header.sequence);
+
+    for (int i = 0; i < sender->destination_count; i++)
+    {
+        BandStreamDestination *destination = &sender->destinations[i];
+
+        if (sendto(g_socket_get_fd(destination->socket), sender->packet, sender->size, MSG_NOSIGNAL,
+                   (const struct sockaddr *)&destination->native_address, destination->native_address_size) >= 0)
+        {
+            destination->failing = FALSE;
+            continue;
+        }
+
+        // A full send buffer only drops this datagram, the receivers see the gap in the sequence numbers
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !destination->failing)
+        {
+            // Reporting may allocate, which only happens once until the destination works again.
+            // The guard is suspended rather than left, pushing frames from outside a guarded section is fine too.
+            int depth = allocation_guard_suspend();
+
+            fprintf(stderr, "ERROR: Could not stream to %s: %s\n", destination->name, g_strerror(errno));
+            allocation_guard_resume(depth);
+            destination->failing = TRUE;
+        }
+    }
+
+    sender->sequence += sender->header.frames;
+    sender->size = 0;
+}
+
+void band_stream_sender_push(BandStreamSender *sender,
+                             const float *levels,
+                             int channels,
+                             int bands,
+                             guint frame_interval,
+                             gint64 capture_time)
+{
+    BandStreamHeader header = {
+        .format = sender->format,
+        .channels = channels,
+        .bands = bands,
+        .frame_interval = frame_interval,
+        .frames = 0,
+        .sequence = sender->sequence,
+    };
+    gsize frame_size = band_stream_get_frame_size(&header);
+    gint64 now = g_get_monotonic_time();
+
+    // Only frames of the same shape can share a datagram, and only as many as fit
+    if (sender->size > 0 &&
+        (sender->header.channels != channels || sender->header.bands != bands ||
+         sender->header.frame_interval != frame_interval || sender->size + frame_size > BAND_STREAM_PACKET_SIZE))
+        band_stream_sender_flush(sender);
+
+    if (sender->size == 0)
+    {
+        sender->header = header;
+        sender->size = BAND_STREAM_HEADER_SIZE;
+        sender->batch_start = now;
+    }
+
+    band_stream_put_u64(sender->packet + sender->size, capture_time);
+    spectrum_file_quantize(sender->format, levels, channels * bands,
+                           sender->packet + sender->size + BAND_STREAM_FRAME_HEADER_SIZE);
+    sender->size += frame_size;
+    sender->header.frames++;
+
+    // Keep the datagram for the next frame only if that one still comes in time, and fits
+    if (sender->batch_start + BAND_STREAM_BATCH_INTERVAL < now + (gint64)frame_interval ||
+        sender->size + frame_size > BAND_STREAM_PACKET_SIZE)
+        band_stream_sender_flush(sender);
+}
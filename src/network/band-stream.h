@@ -0,0 +1,130 @@
+/* band-stream.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAND_STREAM_H
+#define BAND_STREAM_H
+
+#include <gio/gio.h>
+#include <fft/analysis-core.h>
+#include <offline/spectrum-file.h>
+
+G_BEGIN_DECLS
+
+/**
+ * UDP datagram of analysis frames, sent to remote displays.
+ *
+ * All fields are little endian. Every datagram starts with a `BAND_STREAM_HEADER_SIZE` byte header:
+ *
+ *   offset  size  field
+ *        0     4  magic, `BAND_STREAM_MAGIC`
+ *        4     2  version, `BAND_STREAM_VERSION`
+ *        6     2  `SpectrumFileFormat` of the values
+ *        8     2  number of channels in a frame
+ *       10     2  number of bands of each channel
+ *       12     4  time between frames in microseconds
+ *       16     4  number of frames in the datagram
+ *       20     4  reserved, 0
+ *       24     8  sequence number of the first frame, increased by one for every frame sent
+ *
+ * The header is followed by the frames. Each one starts with the wall clock time its audio was captured at, in
+ * microseconds since the Unix epoch as a 64 bit integer or 0 if it isn't known, followed by its values laid out
+ * like a frame of a spectrum file.
+ */
+#define BAND_STREAM_MAGIC "ALZS"
+#define BAND_STREAM_VERSION (1)
+#define BAND_STREAM_HEADER_SIZE (32)
+#define BAND_STREAM_FRAME_HEADER_SIZE (8)
+
+// Datagrams are filled up to this size so they fit in an Ethernet frame, a frame larger than that is sent alone
+#define BAND_STREAM_PACKET_SIZE (1400)
+
+// Size of the largest datagram, a single frame of every value as a float
+#define BAND_STREAM_MAX_DATAGRAM_SIZE \
+    (BAND_STREAM_HEADER_SIZE + BAND_STREAM_FRAME_HEADER_SIZE + sizeof(float) * ANALYSIS_MAX_VALUES)
+
+// Longest a frame waits for more frames to share its datagram in microseconds, about a display refresh
+#define BAND_STREAM_BATCH_INTERVAL (8000)
+
+// UDP port used when an address doesn't give one
+#define BAND_STREAM_DEFAULT_PORT (5113)
+
+// Header of a datagram.
+typedef struct
+{
+    SpectrumFileFormat format;
+    int channels;
+    int bands;
+    guint frame_interval;
+    guint frames;
+    guint64 sequence;
+} BandStreamHeader;
+
+/**
+ * Check a received datagram and read its header.
+ *
+ * @return FALSE if the datagram isn't one of ours, or is cut short
+ */
+gboolean band_stream_parse_header(const guint8 *data, gsize size, BandStreamHeader *header);
+
+/**
+ * Read a frame of a datagram checked with `band_stream_parse_header`.
+ *
+ * @param `index` index of the frame in the datagram, must be less than `header->frames`
+ * @param `capture_time` set to the wall clock time the audio of the frame was captured at, 0 if it isn't known
+ * @param `levels` room for `channels * bands` levels
+ */
+void band_stream_read_frame(const guint8 *data,
+                            const BandStreamHeader *header,
+                            guint index,
+                            gint64 *capture_time,
+                            float *levels);
+
+// Sender batching analysis frames into datagrams.
+typedef struct _BandStreamSender BandStreamSender;
+
+/**
+ * Create a sender, resolving every destination straight away.
+ *
+ * @param `destinations` NULL terminated array of `HOST[:PORT]` addresses, broadcast and multicast ones included
+ * @param `format` how the levels are quantized
+ * @return the sender, or NULL if any of the destinations couldn't be resolved
+ */
+BandStreamSender *band_stream_sender_new(const char *const *destinations, SpectrumFileFormat format);
+
+void band_stream_sender_free(BandStreamSender *sender);
+
+/**
+ * Queue an analysis frame, sending the datagram it's in once it's full or has waited long enough.
+ *
+ * The sockets never block, a datagram the network can't take right away is dropped. Nothing is allocated either
+ * unless a destination starts failing, so this is safe to call from the FFT thread.
+ *
+ * @param `levels` `channels * bands` levels from 0 to 1
+ * @param `frame_interval` time between frames in microseconds
+ * @param `capture_time` wall clock time the audio of the frame was captured at in microseconds, 0 if it isn't known
+ */
+void band_stream_sender_push(BandStreamSender *sender,
+                             const float *levels,
+                             int channels,
+                             int bands,
+                             guint frame_interval,
+                             gint64 capture_time);
+
+G_END_DECLS
+
+#endif // BAND_STREAM_H
@@ -0,0 +1,594 @@
+/* offline-analysis.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <offline/offline-analysis.h>
+#include <offline/spectrum-file.h>
+#include <offline/wav-reader.h>
+
+#include <glib/gstdio.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Number of frames decoded from the input file at once
+#define READ_FRAMES (16384)
+
+// Size of the CSV output buffer, so lines are written in large blocks
+#define CSV_BUFFER_SIZE (1 << 20)
+
+// Shortest and longest chunk a file is split into, in seconds of audio.
+// Files are split into one chunk per worker within these limits, so short files don't drown in warm up overhead
+// and long files don't hold too many frames in memory while they wait to be written.
+#define MIN_CHUNK_SECONDS (60)
+#define MAX_CHUNK_SECONDS (300)
+
+// Audio analysed before a chunk to warm the automatic gain up, in seconds.
+// The ceiling falls by `AUTO_GAIN_RELEASE_DB` per second down to its lowest level 50 dB below full scale, so after
+// this long no earlier band up to 7 dBFS can still raise it and the chunk continues the gain exactly.
+#define GAIN_WARM_UP_SECONDS (10)
+
+// Number of chunks handed to the workers ahead of the one being written, per worker
+#define CHUNKS_IN_FLIGHT_PER_JOB (2)
+
+// An input file and its output.
+typedef struct
+{
+    const char *input_path;
+    gchar *output_path;
+
+    guint sample_rate;
+    int input_channels;
+    // Configuration the file is analysed with, the window of the preset is picked for its sample rate
+    AnalysisConfig config;
+    // Number of audio frames in the file
+    guint64 audio_frames;
+    // Number of analysis frames the file is turned into
+    guint64 frames;
+    // Duration of a hop in seconds
+    double hop_seconds;
+
+    // Number of chunks the file is split into
+    int chunks;
+    // Index of the next chunk to write
+    int next_chunk;
+    // Chunks analysed but not written yet, indexed by chunk
+    struct _OfflineChunk **pending;
+
+    // Output, only one of them is used depending on the format
+    FILE *csv;
+    SpectrumFileWriter *writer;
+
+    // Whether everything was analysed and written so far
+    gboolean ok;
+} OfflineFile;
+
+// A run of analysis frames of a file, analysed by a worker and written by the main thread.
+typedef struct _OfflineChunk
+{
+    OfflineFile *file;
+    // Index of the chunk in the file
+    int index;
+    // Index of the first analysis frame of the chunk
+    guint64 first_frame;
+    // Number of analysis frames in the chunk
+    guint64 frames;
+
+    // Shape of the frames, filled in by the worker
+    int channels;
+    int bands;
+    float frequencies[BAND_LAYOUT_MAX_BANDS];
+
+    // Lines of the frames when writing CSV
+    GString *csv;
+    // Levels of the frames one after the other when writing a spectrum file
+    float *levels;
+
+    // Number of frames produced by the core so far, including the warm up frames
+    guint64 produced;
+    // Number of warm up frames to drop before the chunk starts
+    guint64 skip;
+
+    // Whether the chunk was analysed successfully
+    gboolean ok;
+} OfflineChunk;
+
+// State shared by the main thread and the workers.
+typedef struct
+{
+    const OfflineAnalysisOptions *options;
+    // Chunks waiting to be analysed, a worker stops when it pops `stop_chunk`
+    GAsyncQueue *work;
+    // Chunks analysed and waiting to be written
+    GAsyncQueue *done;
+} OfflineAnalysis;
+
+// Marker telling a worker there is nothing left to do
+static OfflineChunk stop_chunk;
+
+/**
+ * Append a level from 0 to 1 to a CSV line, with four decimals.
+ *
+ * This is done by hand since it's by far the most common thing written, printf is several times slower and would
+ * use the locale's decimal separator.
+ */
+static void
+offline_analysis_append_level(GString *line, float level)
+{
+    int value = (int)lrintf(CLAMP(level, 0.0f, 1.0f) * 10000.0f);
+    char digits[7] = {
+        ',',
+        '0' + value / 10000,
+        '.',
+        '0' + value / 1000 % 10,
+        '0' + value / 100 % 10,
+        '0' + value / 10 % 10,
+        '0' + value % 10,
+    };
+
+    g_string_append_len(line, digits, sizeof(digits));
+}
+
+// Keep the frames of a chunk, dropping the ones that only warmed the core up.
+static void
+offline_analysis_chunk_frame_cb(const float *levels, int channels, int bands, gpointer user_data)
+{
+    OfflineChunk *chunk = user_data;
+    gchar time[G_ASCII_DTOSTR_BUF_SIZE];
+    guint64 frame;
+
+    if (chunk->produced++ < chunk->skip)
+        return;
+
+    frame = chunk->produced - chunk->skip - 1;
+    if (frame >= chunk->frames)
+        return;
+
+    if (chunk->levels != NULL)
+    {
+        memcpy(chunk->levels + frame * channels * bands, levels, sizeof(float) * channels * bands);
+        return;
+    }
+
+    // The time is that of the end of the window, when the live view would have shown the frame
+    frame += chunk->first_frame;
+    g_string_append_printf(chunk->csv, "%" G_GUINT64_FORMAT ",%s",
+                           frame,
+                           g_ascii_formatd(time, sizeof(time), "%.6f", (frame + 1) * chunk->file->hop_seconds));
+
+    for (int i = 0; i < channels * bands; i++)
+        offline_analysis_append_level(chunk->csv, levels[i]);
+
+    g_string_append_c(chunk->csv, '\n');
+}
+
+/**
+ * Replace the estimated plans of a core with measured ones, they pay for themselves over a whole file.
+ *
+ * The first worker to get here measures the plans, the others find them in FFTW's wisdom.
+ */
+static void
+offline_analysis_measure_plan(AnalysisCore *core)
+{
+    fftwf_plan plans[ANALYSIS_MAX_PLANS];
+    int count = analysis_core_get_plan_count(core);
+
+    if (!analysis_core_is_plan_estimated(core))
+        return;
+
+    for (int i = 0; i < count; i++)
+    {
+        plans[i] = analysis_plan_new(analysis_core_get_plan_size(core, i), analysis_core_get_channels(core),
+                                     FFTW_MEASURE);
+        if (plans[i] == NULL)
+        {
+            while (i-- > 0)
+                analysis_plan_destroy(plans[i]);
+            return;
+        }
+    }
+
+    analysis_core_swap_plans(core, plans);
+    for (int i = 0; i < count; i++)
+        analysis_plan_destroy(plans[i]);
+}
+
+/**
+ * Analyse a chunk on a worker.
+ *
+ * The core is started far enough before the chunk for its history and automatic gain to be the same as if the
+ * whole file had been analysed from the start, the frames produced before the chunk are dropped.
+ *
+ * @param `core` core of the worker, created on its first chunk
+ */
+static void
+offline_analysis_run_chunk(OfflineAnalysis *analysis, AnalysisCore **core, OfflineChunk *chunk)
+{
+    OfflineFile *file = chunk->file;
+    AnalysisConfig config = file->config;
+    WavReader *reader;
+    float *input;
+    guint64 warm_up, start_frame, remaining;
+    int frames;
+
+    reader = wav_reader_open(file->input_path);
+    if (reader == NULL)
+        return;
+
+    if (*core == NULL)
+    {
+        *core = analysis_core_new(&config);
+        offline_analysis_measure_plan(*core);
+    }
+    else if (analysis_core_configure(*core, &config))
+    {
+        offline_analysis_measure_plan(*core);
+    }
+    analysis_core_reset(*core);
+
+    chunk->channels = analysis_core_get_channels(*core);
+    chunk->bands = analysis_core_get_bands(*core);
+    memcpy(chunk->frequencies, analysis_core_get_band_frequencies(*core), sizeof(float) * chunk->bands);
+
+    if (analysis->options->format == OFFLINE_FORMAT_BINARY)
+        chunk->levels = g_new(float, chunk->frames * chunk->channels * chunk->bands);
+    else
+        chunk->csv = g_string_sized_new(chunk->frames * chunk->channels * chunk->bands * 7);
+
+    // Frames after the first `window_size - hop_size` samples see a full history, the gain needs longer
+    warm_up = (config.window_size - config.hop_size + config.hop_size - 1) / config.hop_size;
+    if (config.auto_gain)
+        warm_up += (GAIN_WARM_UP_SECONDS * config.sample_rate + config.hop_size - 1) / config.hop_size;
+    start_frame = chunk->first_frame - MIN(warm_up, chunk->first_frame);
+    chunk->skip = chunk->first_frame - start_frame;
+
+    // The last chunk runs to the end of the file, the others stop right after their last hop
+    if (chunk->index == file->chunks - 1)
+        remaining = file->audio_frames - start_frame * config.hop_size;
+    else
+        remaining = (chunk->first_frame + chunk->frames - start_frame) * config.hop_size;
+
+    if (!wav_reader_seek(reader, start_frame * config.hop_size))
+    {
+        wav_reader_close(reader);
+        return;
+    }
+
+    input = g_new(float, READ_FRAMES * file->input_channels);
+    while (remaining > 0 && (frames = wav_reader_read(reader, input, MIN(remaining, READ_FRAMES))) > 0)
+    {
+        analysis_core_process(*core, input, frames, offline_analysis_chunk_frame_cb, chunk);
+        remaining -= frames;
+    }
+
+    chunk->ok = remaining == 0;
+
+    g_free(input);
+    wav_reader_close(reader);
+}
+
+// Worker analysing chunks until it's told to stop, with its own core and therefore its own plan and buffers.
+static gpointer
+offline_analysis_worker_thread(gpointer data)
+{
+    OfflineAnalysis *analysis = data;
+    AnalysisCore *core = NULL;
+    OfflineChunk *chunk;
+
+    while ((chunk = g_async_queue_pop(analysis->work)) != &stop_chunk)
+    {
+        offline_analysis_run_chunk(analysis, &core, chunk);
+        g_async_queue_push(analysis->done, chunk);
+    }
+
+    analysis_core_free(core);
+
+    return NULL;
+}
+
+// Open the output of a file, now that its first chunk tells what the frames look like.
+static gboolean
+offline_analysis_open_output(OfflineAnalysis *analysis, OfflineFile *file, const OfflineChunk *chunk)
+{
+    const AnalysisConfig *config = &file->config;
+
+    if (analysis->options->format == OFFLINE_FORMAT_BINARY)
+    {
+        SpectrumFileInfo info = {
+            .sample_rate = file->sample_rate,
+            .window_size = config->window_size,
+            .hop_size = config->hop_size,
+            .channels = chunk->channels,
+            .bands = chunk->bands,
+            .band_layout = config->band_layout,
+            .format = analysis->options->quantization,
+        };
+
+        file->writer = spectrum_file_writer_new(file->output_path, &info, chunk->frequencies);
+        return file->writer != NULL;
+    }
+
+    file->csv = fopen(file->output_path, "w");
+    if (file->csv == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not create %s\n", file->output_path);
+        return FALSE;
+    }
+    setvbuf(file->csv, NULL, _IOFBF, CSV_BUFFER_SIZE);
+
+    // One column per band of every channel
+    fprintf(file->csv, "frame,time");
+    for (int c = 0; c < chunk->channels; c++)
+    {
+        for (int i = 0; i < chunk->bands; i++)
+            fprintf(file->csv, ",ch%d_%.0fHz", c, chunk->frequencies[i]);
+    }
+    fputc('\n', file->csv);
+
+    return TRUE;
+}
+
+// Write a chunk to the output of its file, the chunks of a file must be written in order.
+static void
+offline_analysis_write_chunk(OfflineAnalysis *analysis, OfflineChunk *chunk)
+{
+    OfflineFile *file = chunk->file;
+
+    if (!chunk->ok)
+    {
+        fprintf(stderr, "ERROR: Could not analyse %s\n", file->input_path);
+        file->ok = FALSE;
+    }
+
+    if (chunk->index == 0 && file->ok)
+        file->ok = offline_analysis_open_output(analysis, file, chunk);
+
+    if (!file->ok)
+        return;
+
+    if (file->writer != NULL)
+    {
+        for (guint64 i = 0; i < chunk->frames && file->ok; i++)
+            file->ok = spectrum_file_writer_append(file->writer, chunk->levels + i * chunk->channels * chunk->bands);
+    }
+    else if (fwrite(chunk->csv->str, 1, chunk->csv->len, file->csv) != chunk->csv->len)
+    {
+        file->ok = FALSE;
+    }
+}
+
+// Finish the output of a file once all of its chunks are written.
+static void
+offline_analysis_close_output(OfflineFile *file)
+{
+    if (file->writer != NULL && !spectrum_file_writer_close(file->writer))
+        file->ok = FALSE;
+    if (file->csv != NULL && fclose(file->csv) != 0)
+        file->ok = FALSE;
+    file->writer = NULL;
+    file->csv = NULL;
+
+    if (!file->ok)
+        fprintf(stderr, "ERROR: Could not write the analysis to %s\n", file->output_path);
+}
+
+static void
+offline_analysis_free_chunk(OfflineChunk *chunk)
+{
+    if (chunk->csv != NULL)
+        g_string_free(chunk->csv, TRUE);
+    g_free(chunk->levels);
+    g_free(chunk);
+}
+
+// Get the path of the output of an input when there are several inputs. The result must be freed with `g_free`.
+static gchar *
+offline_analysis_get_output_path(const OfflineAnalysisOptions *options, const char *input_path)
+{
+    g_autofree gchar *name = g_path_get_basename(input_path);
+    gchar *extension = strrchr(name, '.');
+    g_autofree gchar *output_name = NULL;
+
+    if (extension != NULL && extension != name)
+        *extension = '\0';
+
+    output_name = g_strconcat(name, options->format == OFFLINE_FORMAT_BINARY ? ".alzb" : ".csv", NULL);
+
+    return g_build_filename(options->output_path, output_name, NULL);
+}
+
+/**
+ * Read the header of an input file and work out how it's split up.
+ *
+ * @return FALSE if the file can't be analysed
+ */
+static gboolean
+offline_analysis_setup_file(const OfflineAnalysisOptions *options,
+                            OfflineFile *file,
+                            const char *input_path,
+                            gboolean several_inputs,
+                            int jobs)
+{
+    WavReader *reader;
+    guint64 chunk_frames, min_frames, max_frames;
+
+    file->input_path = input_path;
+    file->output_path = several_inputs ? offline_analysis_get_output_path(options, input_path)
+                                       : g_strdup(options->output_path);
+    file->ok = TRUE;
+
+    reader = wav_reader_open(input_path);
+    if (reader == NULL)
+        return FALSE;
+
+    file->sample_rate = wav_reader_get_sample_rate(reader);
+    file->input_channels = wav_reader_get_channels(reader);
+    file->audio_frames = wav_reader_get_frames(reader);
+    wav_reader_close(reader);
+
+    if (file->input_channels > ANALYSIS_MAX_CHANNELS)
+    {
+        fprintf(stderr, "ERROR: %s has more than %d channels\n", input_path, ANALYSIS_MAX_CHANNELS);
+        return FALSE;
+    }
+
+    // Like the live view, the window keeps the duration of the preset at the sample rate of the file
+    file->config = options->config;
+    file->config.sample_rate = file->sample_rate;
+    file->config.input_channels = file->input_channels;
+    analysis_config_apply_preset(&file->config, file->config.preset);
+
+    // The core produces a frame every full hop, just like the live view
+    file->frames = file->audio_frames / file->config.hop_size;
+    file->hop_seconds = (double)file->config.hop_size / file->sample_rate;
+
+    // One chunk per worker, within the chunk length limits
+    min_frames = MAX(MIN_CHUNK_SECONDS * file->sample_rate / file->config.hop_size, 1);
+    max_frames = MAX(MAX_CHUNK_SECONDS * file->sample_rate / file->config.hop_size, 1);
+    chunk_frames = CLAMP((file->frames + jobs - 1) / jobs, min_frames, max_frames);
+
+    file->chunks = MAX((file->frames + chunk_frames - 1) / chunk_frames, 1);
+    file->pending = g_new0(OfflineChunk *, file->chunks);
+
+    return TRUE;
+}
+
+int offline_analysis_run(const OfflineAnalysisOptions *options)
+{
+    OfflineAnalysis analysis = {.options = options};
+    OfflineFile *files;
+    GThread **workers;
+    gint64 start_time;
+    double elapsed, duration = 0;
+    int n_files, jobs, in_flight, max_in_flight, remaining;
+    int next_file = 0, next_chunk = 0;
+    gboolean ok = TRUE;
+
+    n_files = g_strv_length((gchar **)options->input_paths);
+    jobs = options->jobs > 0 ? options->jobs : (int)g_get_num_processors();
+
+    if (n_files > 1 && g_mkdir_with_parents(options->output_path, 0755) != 0)
+    {
+        fprintf(stderr, "ERROR: Could not create the output directory %s\n", options->output_path);
+        return 1;
+    }
+
+    // Work out how every file is split up, files that can't be read are left out
+    files = g_new0(OfflineFile, n_files);
+    remaining = 0;
+    for (int i = 0; i < n_files; i++)
+    {
+        if (offline_analysis_setup_file(options, &files[i], options->input_paths[i], n_files > 1, jobs))
+        {
+            remaining += files[i].chunks;
+            duration += (double)files[i].audio_frames / files[i].sample_rate;
+        }
+        else
+        {
+            files[i].chunks = 0;
+            ok = FALSE;
+        }
+    }
+
+    analysis.work = g_async_queue_new();
+    analysis.done = g_async_queue_new();
+
+    start_time = g_get_monotonic_time();
+    workers = g_new(GThread *, jobs);
+    for (int i = 0; i < jobs; i++)
+        workers[i] = g_thread_new("offline-analysis", offline_analysis_worker_thread, &analysis);
+
+    // Hand the chunks out in order and write them back in order, with a bounded number waiting to be written
+    in_flight = 0;
+    max_in_flight = jobs * CHUNKS_IN_FLIGHT_PER_JOB;
+    while (remaining > 0)
+    {
+        OfflineChunk *chunk;
+        OfflineFile *file;
+
+        while (in_flight < max_in_flight && next_file < n_files)
+        {
+            file = &files[next_file];
+
+            if (next_chunk < file->chunks)
+            {
+                guint64 chunk_frames = (file->frames + file->chunks - 1) / file->chunks;
+
+                chunk = g_new0(OfflineChunk, 1);
+                chunk->file = file;
+                chunk->index = next_chunk;
+                chunk->first_frame = MIN(next_chunk * chunk_frames, file->frames);
+                chunk->frames = MIN(chunk_frames, file->frames - chunk->first_frame);
+                g_async_queue_push(analysis.work, chunk);
+
+                in_flight++;
+                next_chunk++;
+            }
+            else
+            {
+                next_file++;
+                next_chunk = 0;
+            }
+        }
+
+        chunk = g_async_queue_pop(analysis.done);
+        in_flight--;
+
+        file = chunk->file;
+        file->pending[chunk->index] = chunk;
+        while (file->next_chunk < file->chunks && file->pending[file->next_chunk] != NULL)
+        {
+            chunk = file->pending[file->next_chunk];
+            file->pending[file->next_chunk] = NULL;
+            file->next_chunk++;
+            remaining--;
+
+            offline_analysis_write_chunk(&analysis, chunk);
+            offline_analysis_free_chunk(chunk);
+
+            if (file->next_chunk == file->chunks)
+                offline_analysis_close_output(file);
+        }
+    }
+
+    for (int i = 0; i < jobs; i++)
+        g_async_queue_push(analysis.work, &stop_chunk);
+    for (int i = 0; i < jobs; i++)
+        g_thread_join(workers[i]);
+    elapsed = (double)(g_get_monotonic_time() - start_time) / G_USEC_PER_SEC;
+
+    // Keep the measured plans for the next run
+    analysis_plan_export_wisdom();
+
+    for (int i = 0; i < n_files; i++)
+    {
+        ok = ok && files[i].ok;
+        g_free(files[i].output_path);
+        g_free(files[i].pending);
+    }
+
+    if (ok)
+        g_print("Analysed %.1f s of audio from %d files on %d threads in %.2f s (%.0fx real time)\n",
+                duration, n_files, jobs, elapsed, duration / MAX(elapsed, 1e-6));
+
+    g_free(workers);
+    g_free(files);
+    g_async_queue_unref(analysis.work);
+    g_async_queue_unref(analysis.done);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+/* offline-analysis.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OFFLINE_ANALYSIS_H
+#define OFFLINE_ANALYSIS_H
+
+#include <glib.h>
+#include <fft/analysis-core.h>
+#include <offline/spectrum-file.h>
+
+G_BEGIN_DECLS
+
+// How the analysis frames are written out.
+typedef enum
+{
+    // One line per frame with its index, its time in seconds and every level
+    OFFLINE_FORMAT_CSV,
+    // A spectrum file, see spectrum-file.h
+    OFFLINE_FORMAT_BINARY,
+} OfflineFormat;
+
+// What to analyse and where to write it.
+typedef struct
+{
+    // WAV files to analyse, NULL terminated
+    const char *const *input_paths;
+    // File to write the analysis frames to when there is a single input, otherwise the directory to write a file
+    // named after every input to
+    const char *output_path;
+    OfflineFormat format;
+    // How a spectrum file stores the levels, only used by the binary format
+    SpectrumFileFormat quantization;
+    // Number of worker threads, or 0 for one per processor
+    int jobs;
+    // Analysis settings, the sample rate and number of input channels are taken from each input file and the
+    // window and hop sizes follow `preset` at the sample rate of each file
+    AnalysisConfig config;
+} OfflineAnalysisOptions;
+
+/**
+ * Analyse whole audio files as fast as possible and write out every analysis frame.
+ *
+ * The files are split into chunks that are analysed in parallel by a pool of worker threads, each with its own
+ * analysis core. Every chunk is warmed up on the audio before it, so the outputs match analysing each file from
+ * start to end in one go.
+ * No audio device or display is involved, so this can run headless.
+ *
+ * @return the exit status for the command line, 0 on success
+ */
+int offline_analysis_run(const OfflineAnalysisOptions *options);
+
+G_END_DECLS
+
+#endif // OFFLINE_ANALYSIS_H
@@ -0,0 +1,367 @@
+/* spectrum-file.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <offline/spectrum-file.h>
+#include <fft/analysis-core.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Size of the output buffer, so frames are written in large blocks
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+struct _SpectrumFileWriter
+{
+    FILE *file;
+    SpectrumFileFormat format;
+    // Number of values in a frame
+    int values;
+    // Frame being quantized, `values` values of the file's format
+    guint8 *row;
+    // Number of frames appended so far
+    guint64 frames;
+    // Whether every write so far succeeded
+    gboolean ok;
+};
+
+struct _SpectrumFile
+{
+    GMappedFile *mapped;
+    SpectrumFileInfo info;
+    float frequencies[BAND_LAYOUT_MAX_BANDS];
+    guint64 frames;
+    // First frame in the mapping
+    const guint8 *rows;
+    // Size of a frame in bytes
+    gsize stride;
+};
+
+static void
+spectrum_file_put_u32(guint8 *data, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static void
+spectrum_file_put_u64(guint8 *data, guint64 value)
+{
+    value = GUINT64_TO_LE(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+static guint32
+spectrum_file_get_u32(const guint8 *data)
+{
+    guint32 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT32_FROM_LE(value);
+}
+
+static guint64
+spectrum_file_get_u64(const guint8 *data)
+{
+    guint64 value;
+
+    memcpy(&value, data, sizeof(value));
+    return GUINT64_FROM_LE(value);
+}
+
+// Write `count` floats in little endian order.
+static gboolean
+spectrum_file_write_floats(FILE *file, const float *values, int count)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    return fwrite(values, sizeof(float), count, file) == (size_t)count;
+#else
+    for (int i = 0; i < count; i++)
+    {
+        guint32 bits;
+
+        memcpy(&bits, values + i, sizeof(bits));
+        bits = GUINT32_TO_LE(bits);
+        if (fwrite(&bits, sizeof(bits), 1, file) != 1)
+            return FALSE;
+    }
+    return TRUE;
+#endif
+}
+
+// Read `count` little endian floats.
+static void
+spectrum_file_read_floats(const guint8 *data, float *values, int count)
+{
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    memcpy(values, data, sizeof(float) * count);
+#else
+    for (int i = 0; i < count; i++)
+    {
+        guint32 bits = spectrum_file_get_u32(data + i * 4);
+
+        memcpy(values + i, &bits, sizeof(bits));
+    }
+#endif
+}
+
+int spectrum_file_format_get_size(SpectrumFileFormat format)
+{
+    switch (format)
+    {
+    case SPECTRUM_FILE_FORMAT_U8:
+        return 1;
+    case SPECTRUM_FILE_FORMAT_U16:
+        return 2;
+    case SPECTRUM_FILE_FORMAT_FLOAT32:
+    default:
+        return 4;
+    }
+}
+
+SpectrumFileWriter *spectrum_file_writer_new(const char *path, const SpectrumFileInfo *info, const float *frequencies)
+{
+    SpectrumFileWriter *writer;
+    guint8 header[SPECTRUM_FILE_HEADER_SIZE] = {0};
+
+    writer = g_new0(SpectrumFileWriter, 1);
+    writer->format = info->format;
+    writer->values = info->channels * info->bands;
+    writer->row = g_malloc(writer->values * spectrum_file_format_get_size(info->format));
+    writer->ok = TRUE;
+
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not create %s\n", path);
+        g_free(writer->row);
+        g_free(writer);
+        return NULL;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+
+    // The number of frames is only known once the file is closed
+    memcpy(header, SPECTRUM_FILE_MAGIC, 4);
+    spectrum_file_put_u32(header + 4, SPECTRUM_FILE_VERSION);
+    spectrum_file_put_u32(header + 8, info->sample_rate);
+    spectrum_file_put_u32(header + 12, info->window_size);
+    spectrum_file_put_u32(header + 16, info->hop_size);
+    spectrum_file_put_u32(header + 20, info->channels);
+    spectrum_file_put_u32(header + 24, info->bands);
+    spectrum_file_put_u32(header + 28, info->band_layout);
+    spectrum_file_put_u32(header + 32, info->format);
+
+    writer->ok = fwrite(header, 1, sizeof(header), writer->file) == sizeof(header) &&
+                 spectrum_file_write_floats(writer->file, frequencies, info->bands);
+
+    return writer;
+}
+
+void spectrum_file_quantize(SpectrumFileFormat format, const float *levels, int count, guint8 *data)
+{
+    switch (format)
+    {
+    case SPECTRUM_FILE_FORMAT_U8:
+        for (int i = 0; i < count; i++)
+            data[i] = (guint8)lrintf(CLAMP(levels[i], 0.0f, 1.0f) * G_MAXUINT8);
+        break;
+
+    case SPECTRUM_FILE_FORMAT_U16:
+        for (int i = 0; i < count; i++)
+        {
+            guint16 value = GUINT16_TO_LE((guint16)lrintf(CLAMP(levels[i], 0.0f, 1.0f) * G_MAXUINT16));
+
+            memcpy(data + i * 2, &value, sizeof(value));
+        }
+        break;
+
+    case SPECTRUM_FILE_FORMAT_FLOAT32:
+    default:
+        for (int i = 0; i < count; i++)
+        {
+            guint32 bits;
+
+            memcpy(&bits, levels + i, sizeof(bits));
+            spectrum_file_put_u32(data + i * 4, bits);
+        }
+        break;
+    }
+}
+
+void spectrum_file_dequantize(SpectrumFileFormat format, const guint8 *data, int count, float *levels)
+{
+    switch (format)
+    {
+    case SPECTRUM_FILE_FORMAT_U8:
+        for (int i = 0; i < count; i++)
+            levels[i] = data[i] * (1.0f / G_MAXUINT8);
+        break;
+
+    case SPECTRUM_FILE_FORMAT_U16:
+        for (int i = 0; i < count; i++)
+        {
+            guint16 value;
+
+            memcpy(&value, data + i * 2, sizeof(value));
+            levels[i] = GUINT16_FROM_LE(value) * (1.0f / G_MAXUINT16);
+        }
+        break;
+
+    case SPECTRUM_FILE_FORMAT_FLOAT32:
+    default:
+        spectrum_file_read_floats(data, levels, count);
+        break;
+    }
+}
+
+gboolean spectrum_file_writer_append(SpectrumFileWriter *writer, const float *levels)
+{
+    gsize size = writer->values * spectrum_file_format_get_size(writer->format);
+
+    spectrum_file_quantize(writer->format, levels, writer->values, writer->row);
+    if (fwrite(writer->row, 1, size, writer->file) != size)
+        writer->ok = FALSE;
+
+    writer->frames++;
+
+    return writer->ok;
+}
+
+gboolean spectrum_file_writer_close(SpectrumFileWriter *writer)
+{
+    guint8 frames[8];
+    gboolean ok;
+
+    spectrum_file_put_u64(frames, writer->frames);
+    if (fseek(writer->file, 40, SEEK_SET) != 0 || fwrite(frames, 1, sizeof(frames), writer->file) != sizeof(frames))
+        writer->ok = FALSE;
+
+    if (fclose(writer->file) != 0)
+        writer->ok = FALSE;
+
+    ok = writer->ok;
+    g_free(writer->row);
+    g_free(writer);
+
+    return ok;
+}
+
+SpectrumFile *spectrum_file_open(const char *path)
+{
+    SpectrumFile *file;
+    GError *error = NULL;
+    const guint8 *data;
+    gsize size, rows_start;
+    SpectrumFileInfo *info;
+
+    file = g_new0(SpectrumFile, 1);
+
+    file->mapped = g_mapped_file_new(path, FALSE, &error);
+    if (file->mapped == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not open %s: %s\n", path, error->message);
+        g_error_free(error);
+        g_free(file);
+        return NULL;
+    }
+
+    data = (const guint8 *)g_mapped_file_get_contents(file->mapped);
+    size = g_mapped_file_get_length(file->mapped);
+
+    info = &file->info;
+    if (size < SPECTRUM_FILE_HEADER_SIZE ||
+        memcmp(data, SPECTRUM_FILE_MAGIC, 4) != 0 ||
+        spectrum_file_get_u32(data + 4) != SPECTRUM_FILE_VERSION)
+    {
+        fprintf(stderr, "ERROR: %s is not a spectrum file\n", path);
+        spectrum_file_close(file);
+        return NULL;
+    }
+
+    info->sample_rate = spectrum_file_get_u32(data + 8);
+    info->window_size = spectrum_file_get_u32(data + 12);
+    info->hop_size = spectrum_file_get_u32(data + 16);
+    info->channels = spectrum_file_get_u32(data + 20);
+    info->bands = spectrum_file_get_u32(data + 24);
+    info->band_layout = spectrum_file_get_u32(data + 28);
+    info->format = spectrum_file_get_u32(data + 32);
+
+    if (info->sample_rate == 0 || info->hop_size <= 0 ||
+        info->channels <= 0 || info->bands <= 0 || info->bands > BAND_LAYOUT_MAX_BANDS ||
+        info->channels > ANALYSIS_MAX_VALUES / info->bands ||
+        info->format > SPECTRUM_FILE_FORMAT_U8)
+    {
+        fprintf(stderr, "ERROR: %s holds frames that can't be shown\n", path);
+        spectrum_file_close(file);
+        return NULL;
+    }
+
+    rows_start = SPECTRUM_FILE_HEADER_SIZE + sizeof(float) * info->bands;
+    if (size < rows_start)
+    {
+        fprintf(stderr, "ERROR: %s is cut short\n", path);
+        spectrum_file_close(file);
+        return NULL;
+    }
+
+    spectrum_file_read_floats(data + SPECTRUM_FILE_HEADER_SIZE, file->frequencies, info->bands);
+
+    // The number of frames is only filled in once the writer is closed, so a file that's still being written
+    // has 0 there. That file, and one that was cut short, only has the frames that made it to the disk.
+    file->rows = data + rows_start;
+    file->stride = (gsize)info->channels * info->bands * spectrum_file_format_get_size(info->format);
+    file->frames = (size - rows_start) / file->stride;
+    if (spectrum_file_get_u64(data + 40) != 0)
+        file->frames = MIN(spectrum_file_get_u64(data + 40), file->frames);
+
+    return file;
+}
+
+void spectrum_file_close(SpectrumFile *file)
+{
+    if (file == NULL)
+        return;
+
+    g_mapped_file_unref(file->mapped);
+    g_free(file);
+}
+
+const SpectrumFileInfo *spectrum_file_get_info(SpectrumFile *file)
+{
+    return &file->info;
+}
+
+const float *spectrum_file_get_frequencies(SpectrumFile *file)
+{
+    return file->frequencies;
+}
+
+guint64 spectrum_file_get_frames(SpectrumFile *file)
+{
+    return file->frames;
+}
+
+void spectrum_file_read_frame(SpectrumFile *file, guint64 frame, float *levels)
+{
+    const guint8 *row = file->rows + frame * file->stride;
+    int values = file->info.channels * file->info.bands;
+
+    g_return_if_fail(frame < file->frames);
+
+    spectrum_file_dequantize(file->info.format, row, values, levels);
+}
@@ -0,0 +1,144 @@
+/* spectrum-file.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPECTRUM_FILE_H
+#define SPECTRUM_FILE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Compact binary file of analysis frames.
+ *
+ * All fields are little endian. The file starts with a `SPECTRUM_FILE_HEADER_SIZE` byte header:
+ *
+ *   offset  size  field
+ *        0     4  magic, `SPECTRUM_FILE_MAGIC`
+ *        4     4  version, `SPECTRUM_FILE_VERSION`
+ *        8     4  sample rate of the analysed audio in Hz
+ *       12     4  window size of the analysis in samples
+ *       16     4  hop size between frames in samples
+ *       20     4  number of channels in a frame
+ *       24     4  number of bands of each channel
+ *       28     4  `BandLayout` the bands were computed with
+ *       32     4  `SpectrumFileFormat` of the values
+ *       36     4  reserved, 0
+ *       40     8  number of frames, 0 until the writer is closed
+ *
+ * The header is followed by the center frequency of each band in Hz as 32 bit floats, then by the frames one after
+ * the other. A frame holds the values of every band of the first channel, then of the second channel and so on.
+ * Every frame has the same size, so any frame can be found straight from its index.
+ */
+#define SPECTRUM_FILE_MAGIC "ALZB"
+#define SPECTRUM_FILE_VERSION (1)
+#define SPECTRUM_FILE_HEADER_SIZE (48)
+
+// How the values of a frame are stored.
+typedef enum
+{
+    // Levels from 0 to 1 as 32 bit floats
+    SPECTRUM_FILE_FORMAT_FLOAT32,
+    // Levels from 0 to 1 scaled to 16 bit unsigned integers
+    SPECTRUM_FILE_FORMAT_U16,
+    // Levels from 0 to 1 scaled to 8 bit unsigned integers, a quarter of the size and plenty for drawing bars
+    SPECTRUM_FILE_FORMAT_U8,
+} SpectrumFileFormat;
+
+// Description of the frames in a spectrum file.
+typedef struct
+{
+    guint sample_rate;
+    int window_size;
+    int hop_size;
+    int channels;
+    int bands;
+    int band_layout;
+    SpectrumFileFormat format;
+} SpectrumFileInfo;
+
+// Get the size of a single value of a format in bytes.
+int spectrum_file_format_get_size(SpectrumFileFormat format);
+
+/**
+ * Store levels from 0 to 1 in a format, little endian like in a spectrum file.
+ *
+ * @param `data` room for `count` values of `format`
+ */
+void spectrum_file_quantize(SpectrumFileFormat format, const float *levels, int count, guint8 *data);
+
+// Read `count` values of a format back as levels from 0 to 1.
+void spectrum_file_dequantize(SpectrumFileFormat format, const guint8 *data, int count, float *levels);
+
+// Writer appending frames to a new spectrum file.
+typedef struct _SpectrumFileWriter SpectrumFileWriter;
+
+/**
+ * Create a spectrum file, replacing any file at `path`.
+ *
+ * @param `frequencies` center frequency of each of the `info->bands` bands
+ * @return the writer, or NULL if the file couldn't be created
+ */
+SpectrumFileWriter *spectrum_file_writer_new(const char *path, const SpectrumFileInfo *info, const float *frequencies);
+
+// Append a frame of `channels * bands` levels, quantized to the format of the file.
+gboolean spectrum_file_writer_append(SpectrumFileWriter *writer, const float *levels);
+
+/**
+ * Fill in the number of frames and close the file.
+ *
+ * @return FALSE if any of the frames couldn't be written
+ */
+gboolean spectrum_file_writer_close(SpectrumFileWriter *writer);
+
+/**
+ * Spectrum file mapped into memory for reading.
+ *
+ * No frame is read until it's asked for, so opening even very long files is instant.
+ */
+typedef struct _SpectrumFile SpectrumFile;
+
+/**
+ * Map a spectrum file and check its header.
+ *
+ * @return the file, or NULL if it couldn't be mapped or isn't a spectrum file
+ */
+SpectrumFile *spectrum_file_open(const char *path);
+
+void spectrum_file_close(SpectrumFile *file);
+
+// Get the description of the frames in the file.
+const SpectrumFileInfo *spectrum_file_get_info(SpectrumFile *file);
+
+// Get the center frequency of each band in Hz.
+const float *spectrum_file_get_frequencies(SpectrumFile *file);
+
+// Get the number of frames in the file.
+guint64 spectrum_file_get_frames(SpectrumFile *file);
+
+/**
+ * Read a frame as levels from 0 to 1.
+ *
+ * @param `frame` index of the frame, must be less than `spectrum_file_get_frames`
+ * @param `levels` room for `channels * bands` levels
+ */
+void spectrum_file_read_frame(SpectrumFile *file, guint64 frame, float *levels);
+
+G_END_DECLS
+
+#endif // SPECTRUM_FILE_H
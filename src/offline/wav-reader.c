@@ -0,0 +1,288 @@
+/* wav-reader.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <offline/wav-reader.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Format tags of the `fmt ` chunk
+#define WAVE_FORMAT_PCM (0x0001)
+#define WAVE_FORMAT_IEEE_FLOAT (0x0003)
+#define WAVE_FORMAT_EXTENSIBLE (0xFFFE)
+
+struct _WavReader
+{
+    FILE *file;
+
+    // Either `WAVE_FORMAT_PCM` or `WAVE_FORMAT_IEEE_FLOAT`
+    int format;
+    // Number of interleaved channels
+    int channels;
+    // Frames per second
+    guint sample_rate;
+    // Size of a single sample in bytes
+    int sample_size;
+    // Size of a frame of samples in bytes
+    int block_align;
+
+    // Offset of the first sample in the file
+    long data_start;
+    // Number of frames in the data chunk
+    guint64 frames;
+    // Number of frames read so far
+    guint64 position;
+
+    // Raw bytes of the frames being decoded
+    guint8 *buffer;
+    // Size of `buffer` in bytes
+    gsize buffer_size;
+};
+
+static guint16
+wav_reader_get_u16(const guint8 *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static guint32
+wav_reader_get_u32(const guint8 *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((guint32)data[3] << 24);
+}
+
+// Read the `fmt ` chunk, `data` holds `size` bytes of it.
+static gboolean
+wav_reader_parse_format(WavReader *reader, const guint8 *data, guint32 size)
+{
+    int bits;
+
+    if (size < 16)
+        return FALSE;
+
+    reader->format = wav_reader_get_u16(data);
+    reader->channels = wav_reader_get_u16(data + 2);
+    reader->sample_rate = wav_reader_get_u32(data + 4);
+    reader->block_align = wav_reader_get_u16(data + 12);
+    bits = wav_reader_get_u16(data + 14);
+
+    // The actual format of extensible files is in the first two bytes of the sub format GUID
+    if (reader->format == WAVE_FORMAT_EXTENSIBLE)
+    {
+        if (size < 40)
+            return FALSE;
+        reader->format = wav_reader_get_u16(data + 24);
+    }
+
+    if (reader->channels == 0 || reader->sample_rate == 0)
+        return FALSE;
+
+    reader->sample_size = reader->block_align / reader->channels;
+    if (reader->sample_size * reader->channels != reader->block_align || reader->sample_size * 8 < bits)
+        return FALSE;
+
+    switch (reader->format)
+    {
+    case WAVE_FORMAT_PCM:
+        return reader->sample_size >= 1 && reader->sample_size <= 4;
+    case WAVE_FORMAT_IEEE_FLOAT:
+        return reader->sample_size == 4 || reader->sample_size == 8;
+    default:
+        return FALSE;
+    }
+}
+
+WavReader *wav_reader_open(const char *path)
+{
+    WavReader *reader;
+    guint8 header[12];
+    guint8 chunk[8];
+    gboolean has_format = FALSE;
+
+    reader = g_new0(WavReader, 1);
+
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not open %s\n", path);
+        g_free(reader);
+        return NULL;
+    }
+
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        fprintf(stderr, "ERROR: %s is not a WAV file\n", path);
+        wav_reader_close(reader);
+        return NULL;
+    }
+
+    // Walk the chunks until the samples are found, the format must come before them
+    while (fread(chunk, 1, sizeof(chunk), reader->file) == sizeof(chunk))
+    {
+        guint32 size = wav_reader_get_u32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size <= 64)
+        {
+            guint8 format[64];
+
+            if (fread(format, 1, size, reader->file) != size || !wav_reader_parse_format(reader, format, size))
+            {
+                fprintf(stderr, "ERROR: %s uses an unsupported sample format\n", path);
+                wav_reader_close(reader);
+                return NULL;
+            }
+
+            has_format = TRUE;
+            fseek(reader->file, size & 1, SEEK_CUR);
+        }
+        else if (memcmp(chunk, "data", 4) == 0 && has_format)
+        {
+            long start = ftell(reader->file);
+            long end;
+
+            // Streamed files may not have filled in the size, the samples then run to the end of the file
+            fseek(reader->file, 0, SEEK_END);
+            end = ftell(reader->file);
+            fseek(reader->file, start, SEEK_SET);
+
+            if (size == 0 || size == G_MAXUINT32 || (long)size > end - start)
+                size = end - start;
+
+            reader->data_start = start;
+            reader->frames = size / reader->block_align;
+            return reader;
+        }
+        else if (fseek(reader->file, size + (size & 1), SEEK_CUR) != 0)
+        {
+            break;
+        }
+    }
+
+    fprintf(stderr, "ERROR: %s has no samples\n", path);
+    wav_reader_close(reader);
+    return NULL;
+}
+
+void wav_reader_close(WavReader *reader)
+{
+    if (reader == NULL)
+        return;
+
+    if (reader->file != NULL)
+        fclose(reader->file);
+    g_free(reader->buffer);
+    g_free(reader);
+}
+
+guint wav_reader_get_sample_rate(WavReader *reader)
+{
+    return reader->sample_rate;
+}
+
+int wav_reader_get_channels(WavReader *reader)
+{
+    return reader->channels;
+}
+
+guint64 wav_reader_get_frames(WavReader *reader)
+{
+    return reader->frames;
+}
+
+gboolean wav_reader_seek(WavReader *reader, guint64 frame)
+{
+    if (frame > reader->frames)
+        return FALSE;
+
+    if (fseek(reader->file, reader->data_start + (long)(frame * reader->block_align), SEEK_SET) != 0)
+        return FALSE;
+
+    reader->position = frame;
+    return TRUE;
+}
+
+int wav_reader_read(WavReader *reader, float *dest, int frames)
+{
+    const guint8 *data;
+    gsize size;
+    int samples;
+
+    frames = (int)MIN((guint64)frames, reader->frames - reader->position);
+    if (frames == 0)
+        return 0;
+
+    size = (gsize)frames * reader->block_align;
+    if (size > reader->buffer_size)
+    {
+        reader->buffer = g_realloc(reader->buffer, size);
+        reader->buffer_size = size;
+    }
+
+    if (fread(reader->buffer, 1, size, reader->file) != size)
+    {
+        fprintf(stderr, "ERROR: Could not read the samples of the WAV file\n");
+        return -1;
+    }
+
+    reader->position += frames;
+    data = reader->buffer;
+    samples = frames * reader->channels;
+
+    if (reader->format == WAVE_FORMAT_IEEE_FLOAT && reader->sample_size == 4)
+    {
+        for (int i = 0; i < samples; i++)
+        {
+            union { guint32 bits; float value; } sample = {.bits = wav_reader_get_u32(data + i * 4)};
+            dest[i] = sample.value;
+        }
+    }
+    else if (reader->format == WAVE_FORMAT_IEEE_FLOAT)
+    {
+        for (int i = 0; i < samples; i++)
+        {
+            union { guint64 bits; double value; } sample;
+
+            sample.bits = wav_reader_get_u32(data + i * 8) | ((guint64)wav_reader_get_u32(data + i * 8 + 4) << 32);
+            dest[i] = (float)sample.value;
+        }
+    }
+    else
+    {
+        // Integer samples are stored little endian, 8 bit samples are the only unsigned ones
+        int sample_size = reader->sample_size;
+        float scale = 1.0f / (float)(1u << (sample_size * 8 - 1));
+
+        for (int i = 0; i < samples; i++)
+        {
+            const guint8 *bytes = data + i * sample_size;
+            uint32_t value = 0;
+
+            for (int b = 0; b < sample_size; b++)
+                value |= (uint32_t)bytes[b] << (b * 8 + (4 - sample_size) * 8);
+
+            if (sample_size == 1)
+                dest[i] = ((float)bytes[0] - 128.0f) * scale;
+            else
+                dest[i] = (float)((int32_t)value >> ((4 - sample_size) * 8)) * scale;
+        }
+    }
+
+    return frames;
+}
@@ -0,0 +1,69 @@
+/* wav-reader.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WAV_READER_H
+#define WAV_READER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Reader decoding the samples of a WAV file to floats.
+ *
+ * Integer PCM of 8 to 32 bits and 32 or 64 bit float samples are supported, including files using the
+ * extensible format header.
+ */
+typedef struct _WavReader WavReader;
+
+/**
+ * Open a WAV file and read its header.
+ *
+ * @return the reader, or NULL if the file couldn't be opened or isn't a supported WAV file
+ */
+WavReader *wav_reader_open(const char *path);
+
+void wav_reader_close(WavReader *reader);
+
+// Get the sample rate of the file.
+guint wav_reader_get_sample_rate(WavReader *reader);
+
+// Get the number of interleaved channels in the file.
+int wav_reader_get_channels(WavReader *reader);
+
+// Get the number of frames in the file.
+guint64 wav_reader_get_frames(WavReader *reader);
+
+/**
+ * Move to a frame of the file, the next read starts there.
+ *
+ * @return FALSE if `frame` is past the end of the file or seeking failed
+ */
+gboolean wav_reader_seek(WavReader *reader, guint64 frame);
+
+/**
+ * Read the next frames of the file.
+ *
+ * @param `dest` room for `frames` frames of interleaved samples, scaled to the range -1 to 1
+ * @return the number of frames read, 0 at the end of the file or -1 if reading failed
+ */
+int wav_reader_read(WavReader *reader, float *dest, int frames);
+
+G_END_DECLS
+
+#endif // WAV_READER_H
@@ -0,0 +1,278 @@
+/* probes.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <probes/probes.h>
+
+#include <math.h>
+#include <time.h>
+
+// Number of low bits of a duration that pick the bucket within its octave
+#define SUB_BUCKET_BITS (2)
+
+G_STATIC_ASSERT((1 << SUB_BUCKET_BITS) == PROBE_BUCKETS_PER_OCTAVE);
+
+// Percentiles shown for every stage
+static const double dump_percentiles[] = {50, 90, 99, 100};
+static const char *const dump_percentile_names[] = {"p50", "p90", "p99", "max"};
+
+static const char *const stage_names[PROBE_COUNT] = {
+    [PROBE_RING_WRITE] = "ring-write",
+    [PROBE_WAKEUP] = "wakeup",
+    [PROBE_CONVERT] = "convert",
+    [PROBE_FFT] = "fft",
+    [PROBE_BAND_REDUCTION] = "band-reduction",
+    [PROBE_HANDOFF] = "handoff",
+    [PROBE_RENDER] = "render",
+    [PROBE_PAINT] = "paint",
+    [PROBE_AUDIO_TO_PHOTON] = "audio-to-photon",
+};
+
+// Number of threads that get histograms of their own, the threads after them all share the last ones
+#define MAX_THREADS (64)
+
+// Bucket counters of every stage recorded by a thread.
+// A block is a whole number of cache lines, so no two threads ever record into the same one.
+typedef struct
+{
+    guint buckets[PROBE_COUNT][PROBE_BUCKETS];
+} __attribute__((aligned(64))) ProbeThreadBlock;
+
+// Blocks of the threads that have recorded anything, a thread keeps its block once it's done so its counts stay.
+// They're static rather than allocated, since the audio callback records too.
+static ProbeThreadBlock thread_blocks[MAX_THREADS];
+
+// Number of blocks handed out, may run past `MAX_THREADS`
+static gint thread_block_count;
+
+// Block of the calling thread, NULL until it first records
+static _Thread_local ProbeThreadBlock *thread_block;
+
+// Times given to `probes_set_audio_written`, written by the audio callback
+static gint64 audio_write_time;
+static gint64 audio_capture_time;
+
+const char *probe_stage_get_name(ProbeStage stage)
+{
+    return stage_names[stage];
+}
+
+gint64 probe_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (gint64)now.tv_sec * G_GINT64_CONSTANT(1000000000) + now.tv_nsec;
+}
+
+// Find the bucket counting a duration, the first buckets hold a single nanosecond each.
+static int
+probe_get_bucket(guint64 duration)
+{
+    int octave;
+
+    if (duration < PROBE_BUCKETS_PER_OCTAVE)
+        return (int)duration;
+
+    octave = 63 - __builtin_clzll(duration);
+
+    return MIN((octave - SUB_BUCKET_BITS + 1) * PROBE_BUCKETS_PER_OCTAVE +
+                   (int)((duration >> (octave - SUB_BUCKET_BITS)) & (PROBE_BUCKETS_PER_OCTAVE - 1)),
+               PROBE_BUCKETS - 1);
+}
+
+gint64 probe_histogram_get_bucket_start(int bucket)
+{
+    int octave, sub_bucket;
+
+    if (bucket < PROBE_BUCKETS_PER_OCTAVE)
+        return bucket;
+
+    octave = bucket / PROBE_BUCKETS_PER_OCTAVE + SUB_BUCKET_BITS - 1;
+    sub_bucket = bucket % PROBE_BUCKETS_PER_OCTAVE;
+
+    return (gint64)(PROBE_BUCKETS_PER_OCTAVE + sub_bucket) << (octave - SUB_BUCKET_BITS);
+}
+
+// Get the block of the calling thread, handing one out the first time.
+static ProbeThreadBlock *
+probe_get_thread_block(void)
+{
+    if (G_UNLIKELY(thread_block == NULL))
+        thread_block = &thread_blocks[MIN(g_atomic_int_add(&thread_block_count, 1), MAX_THREADS - 1)];
+
+    return thread_block;
+}
+
+void probe_record(ProbeStage stage, gint64 duration)
+{
+    ProbeThreadBlock *block = probe_get_thread_block();
+    guint *counter = &block->buckets[stage][probe_get_bucket(MAX(duration, 0))];
+
+    // Only the last block can be shared, the others are written by their thread alone and only read elsewhere
+    if (G_LIKELY(block != &thread_blocks[MAX_THREADS - 1]))
+        __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+void probe_record_since(ProbeStage stage, gint64 start)
+{
+    probe_record(stage, probe_now() - start);
+}
+
+void probes_set_audio_written(gint64 write_time, gint64 capture_time)
+{
+    __atomic_store_n(&audio_capture_time, capture_time, __ATOMIC_RELAXED);
+    __atomic_store_n(&audio_write_time, write_time, __ATOMIC_RELEASE);
+}
+
+void probes_get_audio_written(gint64 *write_time, gint64 *capture_time)
+{
+    *write_time = __atomic_load_n(&audio_write_time, __ATOMIC_ACQUIRE);
+    *capture_time = __atomic_load_n(&audio_capture_time, __ATOMIC_RELAXED);
+}
+
+void probes_snapshot(ProbeHistogram *histograms)
+{
+    int blocks = MIN(g_atomic_int_get(&thread_block_count), MAX_THREADS);
+
+    for (int stage = 0; stage < PROBE_COUNT; stage++)
+    {
+        ProbeHistogram *histogram = &histograms[stage];
+
+        histogram->count = 0;
+        for (int i = 0; i < PROBE_BUCKETS; i++)
+        {
+            histogram->buckets[i] = 0;
+            for (int block = 0; block < blocks; block++)
+                histogram->buckets[i] += __atomic_load_n(&thread_blocks[block].buckets[stage][i], __ATOMIC_RELAXED);
+            histogram->count += histogram->buckets[i];
+        }
+    }
+}
+
+void probe_histogram_subtract(ProbeHistogram *histogram, const ProbeHistogram *earlier)
+{
+    // The counters may have wrapped around since, unsigned arithmetic still gets the difference right
+    histogram->count = 0;
+    for (int i = 0; i < PROBE_BUCKETS; i++)
+    {
+        histogram->buckets[i] -= earlier->buckets[i];
+        histogram->count += histogram->buckets[i];
+    }
+}
+
+gint64 probe_histogram_get_percentile(const ProbeHistogram *histogram, double percentile)
+{
+    guint64 rank, seen = 0;
+
+    if (histogram->count == 0)
+        return 0;
+
+    rank = MAX((guint64)ceil(histogram->count * CLAMP(percentile, 0, 100) / 100), 1);
+
+    for (int i = 0; i < PROBE_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen < rank)
+            continue;
+
+        if (i == PROBE_BUCKETS - 1)
+            return probe_histogram_get_bucket_start(i);
+
+        return (probe_histogram_get_bucket_start(i) + probe_histogram_get_bucket_start(i + 1)) / 2;
+    }
+
+    return probe_histogram_get_bucket_start(PROBE_BUCKETS - 1);
+}
+
+void probe_format_duration(gint64 duration, char *buffer, gsize size)
+{
+    if (duration < 10000)
+        g_snprintf(buffer, size, "%" G_GINT64_FORMAT " ns", duration);
+    else if (duration < 10000000)
+        g_snprintf(buffer, size, "%.1f µs", duration / 1e3);
+    else
+        g_snprintf(buffer, size, "%.1f ms", duration / 1e6);
+}
+
+static void
+probes_dump_text(FILE *stream, const ProbeHistogram *histograms, double interval)
+{
+    fprintf(stream, "Timings over the last %.1f s:\n", interval);
+
+    for (int stage = 0; stage < PROBE_COUNT; stage++)
+    {
+        const ProbeHistogram *histogram = &histograms[stage];
+
+        fprintf(stream, "  %-16s %8.1f/s", stage_names[stage], histogram->count / MAX(interval, 1e-6));
+
+        for (guint i = 0; i < G_N_ELEMENTS(dump_percentiles) && histogram->count > 0; i++)
+        {
+            char duration[32];
+
+            probe_format_duration(probe_histogram_get_percentile(histogram, dump_percentiles[i]),
+                                  duration, sizeof(duration));
+            fprintf(stream, "  %s %10s", dump_percentile_names[i], duration);
+        }
+
+        fputc('\n', stream);
+    }
+}
+
+static void
+probes_dump_json(FILE *stream, const ProbeHistogram *histograms, double interval)
+{
+    char number[G_ASCII_DTOSTR_BUF_SIZE];
+
+    // Always a dot as the decimal separator, whatever the locale
+    fprintf(stream, "{\"interval\": %s, \"stages\": {", g_ascii_formatd(number, sizeof(number), "%.3f", interval));
+
+    for (int stage = 0; stage < PROBE_COUNT; stage++)
+    {
+        const ProbeHistogram *histogram = &histograms[stage];
+
+        fprintf(stream, "%s\"%s\": {\"count\": %" G_GUINT64_FORMAT,
+                stage > 0 ? ", " : "", stage_names[stage], histogram->count);
+
+        for (guint i = 0; i < G_N_ELEMENTS(dump_percentiles); i++)
+            fprintf(stream, ", \"%s_ns\": %" G_GINT64_FORMAT,
+                    dump_percentile_names[i], probe_histogram_get_percentile(histogram, dump_percentiles[i]));
+
+        fputc('}', stream);
+    }
+
+    fputs("}}\n", stream);
+}
+
+void probes_dump(FILE *stream, ProbeDumpFormat format, const ProbeHistogram *histograms, double interval)
+{
+    switch (format)
+    {
+    case PROBE_DUMP_JSON:
+        probes_dump_json(stream, histograms, interval);
+        break;
+
+    case PROBE_DUMP_TEXT:
+    default:
+        probes_dump_text(stream, histograms, interval);
+        break;
+    }
+
+    fflush(stream);
+}
@@ -0,0 +1,153 @@
+/* probes.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <glib.h>
+#include <stdio.h>
+
+G_BEGIN_DECLS
+
+// Number of histogram buckets for every doubling of a duration, the percentiles are within 12% of the real value
+#define PROBE_BUCKETS_PER_OCTAVE (4)
+
+// Number of doublings covered by the histograms, from 1 ns up to over half an hour
+#define PROBE_OCTAVES (40)
+
+#define PROBE_BUCKETS (PROBE_OCTAVES * PROBE_BUCKETS_PER_OCTAVE)
+
+// Stages of the pipeline from the audio input to the screen that are timed.
+typedef enum
+{
+    // Audio callback copying the input into the ring buffer and waking the FFT thread up
+    PROBE_RING_WRITE,
+    // From the audio callback waking the FFT thread up until it reads the ring buffer
+    PROBE_WAKEUP,
+    // Conversion of the input into the analysed channels and the window function, per analysis frame
+    PROBE_CONVERT,
+    // Fourier transform of every analysed channel
+    PROBE_FFT,
+    // Reduction of the bins to band levels, normalization included
+    PROBE_BAND_REDUCTION,
+    // From a frame being published by the FFT thread until a view picks it up on the main thread
+    PROBE_HANDOFF,
+    // A view updating its bars for a display frame
+    PROBE_RENDER,
+    // The paint phase of a window, in which GTK renders everything the views drew
+    PROBE_PAINT,
+    // From the newest sample of an analysis frame being captured until the frame is expected on screen
+    PROBE_AUDIO_TO_PHOTON,
+    PROBE_COUNT,
+} ProbeStage;
+
+/**
+ * Histogram of the durations recorded for a stage.
+ *
+ * Bucket `i` counts the durations from `probe_histogram_get_bucket_start(i)` up to the start of the next one.
+ */
+typedef struct
+{
+    guint64 count;
+    guint buckets[PROBE_BUCKETS];
+} ProbeHistogram;
+
+/**
+ * Output formats of `probes_dump`.
+ */
+typedef enum
+{
+    // One line per stage, meant to be read
+    PROBE_DUMP_TEXT,
+    // One JSON object holding every stage on a single line
+    PROBE_DUMP_JSON,
+} ProbeDumpFormat;
+
+// Get the name of a stage as used in the dumps.
+const char *probe_stage_get_name(ProbeStage stage);
+
+// Get the time of the monotonic clock in nanoseconds, the same clock as `g_get_monotonic_time`.
+gint64 probe_now(void);
+
+/**
+ * Record a duration for a stage.
+ *
+ * This is lock-free and never allocates, so it's safe to call from the audio callback. Every thread counts into
+ * histograms of its own, so threads recording the same stage, like the workers of the offline analysis, don't
+ * share any cache line.
+ *
+ * @param `duration` in nanoseconds, negative durations are counted as 0
+ */
+void probe_record(ProbeStage stage, gint64 duration);
+
+// Record the time since `start` for a stage, `start` being a time returned by `probe_now`.
+void probe_record_since(ProbeStage stage, gint64 start);
+
+/**
+ * Remember when the audio callback last wrote to the ring buffer.
+ *
+ * @param `write_time` time the FFT thread was woken up at
+ * @param `capture_time` time the newest sample written was captured at, earlier than `write_time` by the
+ *                       input latency of the device
+ */
+void probes_set_audio_written(gint64 write_time, gint64 capture_time);
+
+// Get the times given to the last `probes_set_audio_written` call, both are 0 until it's been called.
+void probes_get_audio_written(gint64 *write_time, gint64 *capture_time);
+
+/**
+ * Copy the histograms of every stage.
+ *
+ * The copy isn't taken atomically as a whole, a duration recorded while copying may or may not be in it.
+ *
+ * @param `histograms` room for `PROBE_COUNT` histograms
+ */
+void probes_snapshot(ProbeHistogram *histograms);
+
+// Remove the durations already in `earlier`, so `histogram` only holds what was recorded since.
+void probe_histogram_subtract(ProbeHistogram *histogram, const ProbeHistogram *earlier);
+
+// Get the shortest duration counted by a bucket, in nanoseconds.
+gint64 probe_histogram_get_bucket_start(int bucket);
+
+/**
+ * Get a percentile of the recorded durations.
+ *
+ * @param `percentile` from 0 to 100, 100 giving the longest duration
+ * @return the middle of the bucket holding the percentile in nanoseconds, 0 if nothing was recorded
+ */
+gint64 probe_histogram_get_percentile(const ProbeHistogram *histogram, double percentile);
+
+/**
+ * Format a duration for people to read, in the unit that suits its size.
+ *
+ * @param `duration` in nanoseconds
+ */
+void probe_format_duration(gint64 duration, char *buffer, gsize size);
+
+/**
+ * Print the percentiles of every stage.
+ *
+ * @param `histograms` `PROBE_COUNT` histograms, as filled in by `probes_snapshot`
+ * @param `interval` number of seconds the histograms cover, only used to work out the rates
+ */
+void probes_dump(FILE *stream, ProbeDumpFormat format, const ProbeHistogram *histograms, double interval);
+
+G_END_DECLS
+
+#endif // PROBES_H
@@ -0,0 +1,213 @@
+/* test-band-stream.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test-common.h"
+
+#include <network/band-stream.h>
+
+#include <string.h>
+
+// Sequence number of the first frame of the datagrams the tests build, large enough to need all 64 bits
+#define TEST_SEQUENCE (G_GUINT64_CONSTANT(0x123456789A))
+
+// Size of a frame in a datagram, with its capture time.
+static gsize
+frame_size(SpectrumFileFormat format, int channels, int bands)
+{
+    return BAND_STREAM_FRAME_HEADER_SIZE + (gsize)channels * bands * spectrum_file_format_get_size(format);
+}
+
+/**
+ * Build a datagram of frames with every field of the header set, the values of the frames are left at 0.
+ *
+ * @return the datagram, free with `g_byte_array_unref`
+ */
+static GByteArray *
+new_datagram(SpectrumFileFormat format, int channels, int bands, guint frames)
+{
+    GByteArray *datagram = g_byte_array_new();
+
+    g_byte_array_set_size(datagram, BAND_STREAM_HEADER_SIZE + frames * frame_size(format, channels, bands));
+    memset(datagram->data, 0, datagram->len);
+
+    memcpy(datagram->data, BAND_STREAM_MAGIC, 4);
+    test_put_u16(datagram->data + 4, BAND_STREAM_VERSION);
+    test_put_u16(datagram->data + 6, format);
+    test_put_u16(datagram->data + 8, channels);
+    test_put_u16(datagram->data + 10, bands);
+    test_put_u32(datagram->data + 12, 10667);
+    test_put_u32(datagram->data + 16, frames);
+    test_put_u32(datagram->data + 24, TEST_SEQUENCE & G_MAXUINT32);
+    test_put_u32(datagram->data + 28, TEST_SEQUENCE >> 32);
+
+    return datagram;
+}
+
+// Check that a datagram is dropped.
+static void
+assert_dropped(GByteArray *datagram)
+{
+    BandStreamHeader header;
+
+    g_assert_false(band_stream_parse_header(datagram->data, datagram->len, &header));
+    g_byte_array_unref(datagram);
+}
+
+static void
+test_band_stream_parse(void)
+{
+    GByteArray *datagram = new_datagram(SPECTRUM_FILE_FORMAT_U8, 2, 3, 2);
+    guint8 *frame = datagram->data + BAND_STREAM_HEADER_SIZE + frame_size(SPECTRUM_FILE_FORMAT_U8, 2, 3);
+    BandStreamHeader header;
+    gint64 capture_time;
+    float levels[6];
+
+    // Capture time and values of the second frame
+    test_put_u32(frame, 0x89ABCDEF);
+    test_put_u32(frame + 4, 0x00012345);
+    frame[BAND_STREAM_FRAME_HEADER_SIZE] = G_MAXUINT8;
+    frame[BAND_STREAM_FRAME_HEADER_SIZE + 5] = 51;
+
+    g_assert_true(band_stream_parse_header(datagram->data, datagram->len, &header));
+    g_assert_cmpint(header.format, ==, SPECTRUM_FILE_FORMAT_U8);
+    g_assert_cmpint(header.channels, ==, 2);
+    g_assert_cmpint(header.bands, ==, 3);
+    g_assert_cmpuint(header.frame_interval, ==, 10667);
+    g_assert_cmpuint(header.frames, ==, 2);
+    g_assert_cmpuint(header.sequence, ==, TEST_SEQUENCE);
+
+    band_stream_read_frame(datagram->data, &header, 0, &capture_time, levels);
+    g_assert_cmpint(capture_time, ==, 0);
+    for (int i = 0; i < 6; i++)
+        g_assert_cmpfloat(levels[i], ==, 0.0f);
+
+    band_stream_read_frame(datagram->data, &header, 1, &capture_time, levels);
+    g_assert_cmpint(capture_time, ==, G_GINT64_CONSTANT(0x0001234589ABCDEF));
+    g_assert_cmpfloat(levels[0], ==, 1.0f);
+    g_assert_cmpfloat_with_epsilon(levels[5], 0.2f, 1e-6);
+
+    g_byte_array_unref(datagram);
+}
+
+static void
+test_band_stream_largest(void)
+{
+    GByteArray *datagram = new_datagram(SPECTRUM_FILE_FORMAT_FLOAT32, ANALYSIS_MAX_CHANNELS, BAND_LAYOUT_MAX_BANDS, 1);
+    BandStreamHeader header;
+
+    g_assert_cmpuint(datagram->len, ==, BAND_STREAM_MAX_DATAGRAM_SIZE);
+    g_assert_true(band_stream_parse_header(datagram->data, datagram->len, &header));
+
+    g_byte_array_unref(datagram);
+}
+
+static void
+test_band_stream_trailing_bytes(void)
+{
+    GByteArray *datagram = new_datagram(SPECTRUM_FILE_FORMAT_U16, 1, 16, 3);
+    BandStreamHeader header;
+
+    // A frame and a half more than the header counts, only the frames it counts are read
+    g_byte_array_set_size(datagram, datagram->len + frame_size(SPECTRUM_FILE_FORMAT_U16, 1, 16) * 3 / 2);
+    g_assert_true(band_stream_parse_header(datagram->data, datagram->len, &header));
+    g_assert_cmpuint(header.frames, ==, 3);
+
+    g_byte_array_unref(datagram);
+}
+
+static void
+test_band_stream_cut_short(void)
+{
+    GByteArray *datagram;
+
+    datagram = new_datagram(SPECTRUM_FILE_FORMAT_U8, 2, 8, 1);
+    g_byte_array_set_size(datagram, 0);
+    assert_dropped(datagram);
+
+    // Within the header
+    datagram = new_datagram(SPECTRUM_FILE_FORMAT_U8, 2, 8, 1);
+    g_byte_array_set_size(datagram, BAND_STREAM_HEADER_SIZE - 1);
+    assert_dropped(datagram);
+
+    // Within the capture time of the only frame
+    datagram = new_datagram(SPECTRUM_FILE_FORMAT_U8, 2, 8, 1);
+    g_byte_array_set_size(datagram, BAND_STREAM_HEADER_SIZE + 4);
+    assert_dropped(datagram);
+
+    // Within the values of the last frame
+    datagram = new_datagram(SPECTRUM_FILE_FORMAT_U16, 2, 8, 4);
+    g_byte_array_set_size(datagram, datagram->len - 1);
+    assert_dropped(datagram);
+
+    // Counting more frames than fit in any datagram
+    datagram = new_datagram(SPECTRUM_FILE_FORMAT_U8, 1, 1, 1);
+    test_put_u32(datagram->data + 16, G_MAXUINT32);
+    assert_dropped(datagram);
+}
+
+static void
+test_band_stream_bad_header(void)
+{
+    // Field of the header to overwrite, and the value that makes the datagram not one of ours
+    static const struct
+    {
+        gsize offset;
+        guint16 value;
+    } cases[] = {
+        // Magic and version
+        {0, 0x5A4C},
+        {4, 0},
+        {4, BAND_STREAM_VERSION + 1},
+        // Format
+        {6, SPECTRUM_FILE_FORMAT_U8 + 1},
+        {6, G_MAXUINT16},
+        // Channels
+        {8, 0},
+        {8, ANALYSIS_MAX_CHANNELS + 1},
+        {8, G_MAXUINT16},
+        // Bands
+        {10, 0},
+        {10, BAND_LAYOUT_MAX_BANDS + 1},
+        {10, G_MAXUINT16},
+        // Frames
+        {16, 0},
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++)
+    {
+        // Room for a frame of every value as a float, so only the field itself can get the datagram dropped
+        GByteArray *datagram = new_datagram(SPECTRUM_FILE_FORMAT_U8, 1, 1, 1);
+
+        g_byte_array_set_size(datagram, BAND_STREAM_MAX_DATAGRAM_SIZE);
+        test_put_u16(datagram->data + cases[i].offset, cases[i].value);
+        assert_dropped(datagram);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/band-stream/parse", test_band_stream_parse);
+    g_test_add_func("/band-stream/largest", test_band_stream_largest);
+    g_test_add_func("/band-stream/trailing-bytes", test_band_stream_trailing_bytes);
+    g_test_add_func("/band-stream/cut-short", test_band_stream_cut_short);
+    g_test_add_func("/band-stream/bad-header", test_band_stream_bad_header);
+
+    return g_test_run();
+}
@@ -0,0 +1,98 @@
+/* test-common.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test-common.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+void test_put_u16(guint8 *data, guint16 value)
+{
+    data[0] = value & 0xFF;
+    data[1] = value >> 8;
+}
+
+void test_put_u32(guint8 *data, guint32 value)
+{
+    for (int i = 0; i < 4; i++)
+        data[i] = (value >> (i * 8)) & 0xFF;
+}
+
+GByteArray *test_wav_new(void)
+{
+    GByteArray *wav = g_byte_array_new();
+
+    g_byte_array_append(wav, (const guint8 *)"RIFF\0\0\0\0WAVE", 12);
+    test_put_u32(wav->data + 4, 4);
+
+    return wav;
+}
+
+void test_wav_add_chunk(GByteArray *wav, const char *id, guint32 size, const void *data, gsize length)
+{
+    guint8 header[8];
+    static const guint8 padding = 0;
+
+    memcpy(header, id, 4);
+    test_put_u32(header + 4, size);
+
+    g_byte_array_append(wav, header, sizeof(header));
+    if (length > 0)
+        g_byte_array_append(wav, data, length);
+    if (length & 1)
+        g_byte_array_append(wav, &padding, 1);
+
+    test_put_u32(wav->data + 4, wav->len - 8);
+}
+
+void test_wav_add_format(GByteArray *wav, guint16 format, guint16 channels, guint32 sample_rate, guint16 bits)
+{
+    guint8 data[16];
+    guint16 block_align = channels * bits / 8;
+
+    test_put_u16(data, format);
+    test_put_u16(data + 2, channels);
+    test_put_u32(data + 4, sample_rate);
+    test_put_u32(data + 8, sample_rate * block_align);
+    test_put_u16(data + 12, block_align);
+    test_put_u16(data + 14, bits);
+
+    test_wav_add_chunk(wav, "fmt ", sizeof(data), data, sizeof(data));
+}
+
+gchar *test_write_file(const char *name, const void *data, gsize size)
+{
+    GError *error = NULL;
+    gchar *path = NULL;
+    int fd;
+
+    fd = g_file_open_tmp(name, &path, &error);
+    g_assert_no_error(error);
+    g_close(fd, NULL);
+
+    g_file_set_contents(path, data, size, &error);
+    g_assert_no_error(error);
+
+    return path;
+}
+
+void test_remove_file(gchar *path)
+{
+    g_remove(path);
+    g_free(path);
+}
@@ -0,0 +1,68 @@
+/* test-common.h
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// Format tags of the `fmt ` chunk of a WAV file
+#define TEST_WAV_FORMAT_PCM (0x0001)
+#define TEST_WAV_FORMAT_IEEE_FLOAT (0x0003)
+#define TEST_WAV_FORMAT_EXTENSIBLE (0xFFFE)
+
+// Store a little endian value, every format the tests build uses that byte order.
+void test_put_u16(guint8 *data, guint16 value);
+void test_put_u32(guint8 *data, guint32 value);
+
+/**
+ * Start a WAV file in memory, holding only the RIFF header.
+ *
+ * The chunks are added one by one, so the tests can get any part of the file wrong.
+ *
+ * @return the file, free with `g_byte_array_unref`
+ */
+GByteArray *test_wav_new(void);
+
+/**
+ * Append a chunk to a WAV file and update the size in its RIFF header.
+ *
+ * @param `size` size stored in the chunk header, doesn't have to match `length`
+ * @param `data` `length` bytes of the chunk, padded to an even size
+ */
+void test_wav_add_chunk(GByteArray *wav, const char *id, guint32 size, const void *data, gsize length);
+
+// Append a 16 byte `fmt ` chunk with a block align of `channels * bits / 8`.
+void test_wav_add_format(GByteArray *wav, guint16 format, guint16 channels, guint32 sample_rate, guint16 bits);
+
+/**
+ * Write data to a new temporary file.
+ *
+ * @param `name` template of the file name, as for `g_file_open_tmp`
+ * @return the path of the file, remove it with `test_remove_file`
+ */
+gchar *test_write_file(const char *name, const void *data, gsize size);
+
+// Remove a file written by `test_write_file` and free its path.
+void test_remove_file(gchar *path);
+
+G_END_DECLS
+
+#endif // TEST_COMMON_H
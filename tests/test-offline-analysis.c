@@ -0,0 +1,154 @@
+/* test-offline-analysis.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test-common.h"
+
+#include <offline/offline-analysis.h>
+
+#include <math.h>
+
+// Format of the input, a low sample rate keeps the file small while it's long enough to be split into chunks
+#define TEST_SAMPLE_RATE (8000)
+#define TEST_CHANNELS (2)
+
+// Length of the input in seconds. Files are split into chunks of at least a minute, so with `TEST_JOBS` workers
+// this makes three chunks, the last one shorter than the others.
+#define TEST_SECONDS (150)
+#define TEST_JOBS (3)
+
+// Loudness of the input changes this often in seconds, so the automatic gain is still moving at the chunk borders
+#define TEST_STEP_SECONDS (7)
+
+/**
+ * Write the input all cases analyse.
+ *
+ * The first channel is a sine sweep over most of the spectrum stepping through three levels far apart, the second
+ * one a steady tone that stops halfway, so the two channels don't reach the gain ceiling at the same time.
+ *
+ * @return the path of the file, remove it with `test_remove_file`
+ */
+static gchar *
+write_input(void)
+{
+    gsize frames = (gsize)TEST_SECONDS * TEST_SAMPLE_RATE;
+    static const double steps[] = {0.9, 0.01, 0.2};
+    double rate = log(3500.0 / 40.0);
+    GByteArray *wav = test_wav_new();
+    guint8 *data = g_malloc(frames * TEST_CHANNELS * 2);
+    gchar *path;
+
+    for (gsize i = 0; i < frames; i++)
+    {
+        double t = (double)i / TEST_SAMPLE_RATE;
+        double phase = 2 * G_PI * 40.0 * TEST_SECONDS / rate * (exp(t / TEST_SECONDS * rate) - 1);
+        double left = steps[(int)(t / TEST_STEP_SECONDS) % G_N_ELEMENTS(steps)] * sin(phase);
+        double right = t < TEST_SECONDS / 2 ? 0.3 * sin(2 * G_PI * 440.0 * t) : 0.0;
+
+        test_put_u16(data + i * 4, (guint16)(gint16)lrint(left * G_MAXINT16));
+        test_put_u16(data + i * 4 + 2, (guint16)(gint16)lrint(right * G_MAXINT16));
+    }
+
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, TEST_CHANNELS, TEST_SAMPLE_RATE, 16);
+    test_wav_add_chunk(wav, "data", frames * TEST_CHANNELS * 2, data, frames * TEST_CHANNELS * 2);
+    path = test_write_file("test-offline-analysis-XXXXXX.wav", wav->data, wav->len);
+
+    g_byte_array_unref(wav);
+    g_free(data);
+
+    return path;
+}
+
+// Analyse the input with a number of workers and read the output back.
+static GBytes *
+analyse(const char *input_path, const OfflineAnalysisOptions *base, int jobs)
+{
+    const char *input_paths[] = {input_path, NULL};
+    gchar *output_path = test_write_file("test-offline-analysis-XXXXXX.out", NULL, 0);
+    OfflineAnalysisOptions options = *base;
+    GError *error = NULL;
+    gchar *contents;
+    gsize size;
+
+    options.input_paths = input_paths;
+    options.output_path = output_path;
+    options.jobs = jobs;
+    g_assert_cmpint(offline_analysis_run(&options), ==, 0);
+
+    g_file_get_contents(output_path, &contents, &size, &error);
+    g_assert_no_error(error);
+    test_remove_file(output_path);
+
+    return g_bytes_new_take(contents, size);
+}
+
+// Check that analysing the input in chunks on several workers writes the same bytes as a single worker.
+static void
+assert_chunks_match(OfflineFormat format, SpectrumFileFormat quantization, AnalysisPreset preset)
+{
+    OfflineAnalysisOptions options = {
+        .format = format,
+        .quantization = quantization,
+    };
+    gchar *input_path = write_input();
+    GBytes *single, *chunked;
+
+    analysis_config_init(&options.config, 0, 0);
+    analysis_config_apply_preset(&options.config, preset);
+
+    single = analyse(input_path, &options, 1);
+    chunked = analyse(input_path, &options, TEST_JOBS);
+
+    g_assert_cmpuint(g_bytes_get_size(single), >, 0);
+    g_assert_cmpmem(g_bytes_get_data(chunked, NULL), g_bytes_get_size(chunked),
+                    g_bytes_get_data(single, NULL), g_bytes_get_size(single));
+
+    g_bytes_unref(single);
+    g_bytes_unref(chunked);
+    test_remove_file(input_path);
+}
+
+static void
+test_offline_analysis_csv(void)
+{
+    assert_chunks_match(OFFLINE_FORMAT_CSV, SPECTRUM_FILE_FORMAT_FLOAT32, ANALYSIS_PRESET_BALANCED);
+}
+
+static void
+test_offline_analysis_binary(void)
+{
+    assert_chunks_match(OFFLINE_FORMAT_BINARY, SPECTRUM_FILE_FORMAT_FLOAT32, ANALYSIS_PRESET_LOW_LATENCY);
+}
+
+static void
+test_offline_analysis_multi_resolution(void)
+{
+    // The longer windows run on decimated input, whose filter history has to carry over into every chunk too
+    assert_chunks_match(OFFLINE_FORMAT_BINARY, SPECTRUM_FILE_FORMAT_FLOAT32, ANALYSIS_PRESET_MULTI_RESOLUTION);
+}
+
+int main(int argc, char *argv[])
+{
+    // The analysis saves FFTW's wisdom in the cache directory, keep it away from the user's
+    g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add_func("/offline-analysis/csv", test_offline_analysis_csv);
+    g_test_add_func("/offline-analysis/binary", test_offline_analysis_binary);
+    g_test_add_func("/offline-analysis/multi-resolution", test_offline_analysis_multi_resolution);
+
+    return g_test_run();
+}
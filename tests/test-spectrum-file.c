@@ -0,0 +1,298 @@
+/* test-spectrum-file.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test-common.h"
+
+#include <fft/analysis-core.h>
+#include <offline/spectrum-file.h>
+
+#include <math.h>
+#include <string.h>
+
+// Shape of the files the tests write
+#define TEST_CHANNELS (2)
+#define TEST_BANDS (4)
+#define TEST_VALUES (TEST_CHANNELS * TEST_BANDS)
+#define TEST_FRAMES (10)
+
+static const float test_frequencies[TEST_BANDS] = {62.5f, 250.0f, 1000.0f, 4000.0f};
+
+// Get the level of a value in the frames the tests write, covering the whole range over the file.
+static float
+test_level(guint64 frame, int value)
+{
+    return (float)((frame * TEST_VALUES + value) % 41) / 40.0f;
+}
+
+// Write `TEST_FRAMES` frames of a format to a new file.
+static gchar *
+write_spectrum_file(SpectrumFileFormat format)
+{
+    SpectrumFileInfo info = {
+        .sample_rate = 48000,
+        .window_size = 2048,
+        .hop_size = 512,
+        .channels = TEST_CHANNELS,
+        .bands = TEST_BANDS,
+        .band_layout = 1,
+        .format = format,
+    };
+    gchar *path = test_write_file("test-spectrum-file-XXXXXX.alzb", NULL, 0);
+    SpectrumFileWriter *writer;
+
+    writer = spectrum_file_writer_new(path, &info, test_frequencies);
+    g_assert_nonnull(writer);
+
+    for (guint64 frame = 0; frame < TEST_FRAMES; frame++)
+    {
+        float levels[TEST_VALUES];
+
+        for (int i = 0; i < TEST_VALUES; i++)
+            levels[i] = test_level(frame, i);
+        g_assert_true(spectrum_file_writer_append(writer, levels));
+    }
+
+    g_assert_true(spectrum_file_writer_close(writer));
+
+    return path;
+}
+
+// Read the bytes of a file written by `write_spectrum_file`, the file is removed.
+static GByteArray *
+read_spectrum_file(SpectrumFileFormat format)
+{
+    gchar *path = write_spectrum_file(format);
+    GError *error = NULL;
+    gchar *contents;
+    gsize size;
+
+    g_file_get_contents(path, &contents, &size, &error);
+    g_assert_no_error(error);
+    test_remove_file(path);
+
+    return g_byte_array_new_take((guint8 *)contents, size);
+}
+
+// Write the bytes of a file and open it, the file is removed again once it's mapped.
+static SpectrumFile *
+open_spectrum_file(GByteArray *bytes)
+{
+    gchar *path = test_write_file("test-spectrum-file-XXXXXX.alzb", bytes->data, bytes->len);
+    SpectrumFile *file = spectrum_file_open(path);
+
+    test_remove_file(path);
+    g_byte_array_unref(bytes);
+
+    return file;
+}
+
+static void
+test_spectrum_file_round_trip(void)
+{
+    // Levels are rounded to the nearest step of the integer formats, allow a whole step for the float error
+    static const float tolerances[] = {
+        [SPECTRUM_FILE_FORMAT_FLOAT32] = 0.0f,
+        [SPECTRUM_FILE_FORMAT_U16] = 1.0f / G_MAXUINT16,
+        [SPECTRUM_FILE_FORMAT_U8] = 1.0f / G_MAXUINT8,
+    };
+
+    for (int format = SPECTRUM_FILE_FORMAT_FLOAT32; format <= SPECTRUM_FILE_FORMAT_U8; format++)
+    {
+        gchar *path = write_spectrum_file(format);
+        SpectrumFile *file = spectrum_file_open(path);
+        const SpectrumFileInfo *info;
+
+        g_assert_nonnull(file);
+        info = spectrum_file_get_info(file);
+        g_assert_cmpuint(info->sample_rate, ==, 48000);
+        g_assert_cmpint(info->window_size, ==, 2048);
+        g_assert_cmpint(info->hop_size, ==, 512);
+        g_assert_cmpint(info->channels, ==, TEST_CHANNELS);
+        g_assert_cmpint(info->bands, ==, TEST_BANDS);
+        g_assert_cmpint(info->band_layout, ==, 1);
+        g_assert_cmpint(info->format, ==, format);
+        g_assert_cmpmem(spectrum_file_get_frequencies(file), sizeof(test_frequencies),
+                        test_frequencies, sizeof(test_frequencies));
+        g_assert_cmpuint(spectrum_file_get_frames(file), ==, TEST_FRAMES);
+
+        // Frames can be read in any order
+        for (guint64 frame = TEST_FRAMES; frame-- > 0;)
+        {
+            float levels[TEST_VALUES];
+
+            spectrum_file_read_frame(file, frame, levels);
+            for (int i = 0; i < TEST_VALUES; i++)
+                g_assert_cmpfloat(fabsf(levels[i] - test_level(frame, i)), <=, tolerances[format]);
+        }
+
+        spectrum_file_close(file);
+        test_remove_file(path);
+    }
+}
+
+static void
+test_spectrum_file_quantize_range(void)
+{
+    static const float levels[] = {-0.5f, 0.0f, 1.0f, 1.5f};
+    static const float expected[] = {0.0f, 0.0f, 1.0f, 1.0f};
+    guint8 data[G_N_ELEMENTS(levels) * 2];
+    float result[G_N_ELEMENTS(levels)];
+
+    // Levels outside of 0 to 1 are clamped by the formats that can't hold them
+    for (int format = SPECTRUM_FILE_FORMAT_U16; format <= SPECTRUM_FILE_FORMAT_U8; format++)
+    {
+        spectrum_file_quantize(format, levels, G_N_ELEMENTS(levels), data);
+        spectrum_file_dequantize(format, data, G_N_ELEMENTS(levels), result);
+        for (gsize i = 0; i < G_N_ELEMENTS(levels); i++)
+            g_assert_cmpfloat_with_epsilon(result[i], expected[i], 1e-6);
+    }
+}
+
+static void
+test_spectrum_file_empty(void)
+{
+    SpectrumFileInfo info = {
+        .sample_rate = 44100,
+        .window_size = 1024,
+        .hop_size = 256,
+        .channels = 1,
+        .bands = TEST_BANDS,
+        .format = SPECTRUM_FILE_FORMAT_U8,
+    };
+    gchar *path = test_write_file("test-spectrum-file-XXXXXX.alzb", NULL, 0);
+    SpectrumFile *file;
+
+    g_assert_true(spectrum_file_writer_close(spectrum_file_writer_new(path, &info, test_frequencies)));
+
+    file = spectrum_file_open(path);
+    g_assert_nonnull(file);
+    g_assert_cmpuint(spectrum_file_get_frames(file), ==, 0);
+
+    spectrum_file_close(file);
+    test_remove_file(path);
+}
+
+static void
+test_spectrum_file_being_written(void)
+{
+    GByteArray *bytes = read_spectrum_file(SPECTRUM_FILE_FORMAT_U16);
+    gsize stride = TEST_VALUES * 2;
+    SpectrumFile *file;
+
+    // The writer only fills in the number of frames once it's closed, and may be within a frame
+    memset(bytes->data + 40, 0, 8);
+    g_byte_array_set_size(bytes, bytes->len - stride / 2);
+    file = open_spectrum_file(bytes);
+
+    g_assert_nonnull(file);
+    g_assert_cmpuint(spectrum_file_get_frames(file), ==, TEST_FRAMES - 1);
+
+    spectrum_file_close(file);
+}
+
+static void
+test_spectrum_file_cut_short(void)
+{
+    gsize rows_start = SPECTRUM_FILE_HEADER_SIZE + sizeof(test_frequencies);
+    gsize stride = TEST_VALUES * 4;
+    GByteArray *bytes;
+    SpectrumFile *file;
+
+    // Only the frames that are there can be read, whatever the header says
+    bytes = read_spectrum_file(SPECTRUM_FILE_FORMAT_FLOAT32);
+    g_byte_array_set_size(bytes, rows_start + 3 * stride + 1);
+    file = open_spectrum_file(bytes);
+    g_assert_nonnull(file);
+    g_assert_cmpuint(spectrum_file_get_frames(file), ==, 3);
+    spectrum_file_close(file);
+
+    // Trailing bytes don't add frames the header doesn't have
+    bytes = read_spectrum_file(SPECTRUM_FILE_FORMAT_FLOAT32);
+    g_byte_array_set_size(bytes, bytes->len + 2 * stride);
+    file = open_spectrum_file(bytes);
+    g_assert_nonnull(file);
+    g_assert_cmpuint(spectrum_file_get_frames(file), ==, TEST_FRAMES);
+    spectrum_file_close(file);
+
+    // Within the frequencies
+    bytes = read_spectrum_file(SPECTRUM_FILE_FORMAT_FLOAT32);
+    g_byte_array_set_size(bytes, rows_start - 1);
+    g_assert_null(open_spectrum_file(bytes));
+
+    // Within the header
+    bytes = read_spectrum_file(SPECTRUM_FILE_FORMAT_FLOAT32);
+    g_byte_array_set_size(bytes, SPECTRUM_FILE_HEADER_SIZE - 1);
+    g_assert_null(open_spectrum_file(bytes));
+
+    bytes = read_spectrum_file(SPECTRUM_FILE_FORMAT_FLOAT32);
+    g_byte_array_set_size(bytes, 0);
+    g_assert_null(open_spectrum_file(bytes));
+}
+
+static void
+test_spectrum_file_bad_header(void)
+{
+    // Field of the header to overwrite, and the value that makes the file unreadable
+    static const struct
+    {
+        gsize offset;
+        guint32 value;
+    } cases[] = {
+        // Magic and version
+        {0, 0x42445A41},
+        {4, 2},
+        // Sample rate and hop size
+        {8, 0},
+        {16, 0},
+        {16, 0x80000000},
+        // Channels
+        {20, 0},
+        {20, 0x80000000},
+        {20, ANALYSIS_MAX_VALUES / TEST_BANDS + 1},
+        // Channels whose product with the bands wraps around
+        {20, 0x40000000},
+        // Bands
+        {24, 0},
+        {24, BAND_LAYOUT_MAX_BANDS + 1},
+        {24, 0xFFFFFFFF},
+        // Format
+        {32, SPECTRUM_FILE_FORMAT_U8 + 1},
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++)
+    {
+        GByteArray *bytes = read_spectrum_file(SPECTRUM_FILE_FORMAT_FLOAT32);
+
+        test_put_u32(bytes->data + cases[i].offset, cases[i].value);
+        g_assert_null(open_spectrum_file(bytes));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/spectrum-file/round-trip", test_spectrum_file_round_trip);
+    g_test_add_func("/spectrum-file/quantize-range", test_spectrum_file_quantize_range);
+    g_test_add_func("/spectrum-file/empty", test_spectrum_file_empty);
+    g_test_add_func("/spectrum-file/being-written", test_spectrum_file_being_written);
+    g_test_add_func("/spectrum-file/cut-short", test_spectrum_file_cut_short);
+    g_test_add_func("/spectrum-file/bad-header", test_spectrum_file_bad_header);
+
+    return g_test_run();
+}
@@ -0,0 +1,374 @@
+/* test-wav-reader.c
+ *
+ * Copyright 2025 Junaid Chaudhry
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test-common.h"
+
+#include <offline/wav-reader.h>
+
+#include <string.h>
+
+// Offset of the `fmt ` chunk data in a file started with `test_wav_new`, if it's the first chunk
+#define FORMAT_OFFSET (20)
+
+// Write a WAV file and open it, the file is removed again once it's open.
+static WavReader *
+open_wav(GByteArray *wav)
+{
+    gchar *path = test_write_file("test-wav-reader-XXXXXX.wav", wav->data, wav->len);
+    WavReader *reader = wav_reader_open(path);
+
+    test_remove_file(path);
+    g_byte_array_unref(wav);
+
+    return reader;
+}
+
+// Check that a file is refused.
+static void
+assert_refused(GByteArray *wav)
+{
+    WavReader *reader = open_wav(wav);
+
+    g_assert_null(reader);
+}
+
+// Start a file with the format of 16 bit stereo at 44.1 kHz.
+static GByteArray *
+new_pcm16_stereo(void)
+{
+    GByteArray *wav = test_wav_new();
+
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, 2, 44100, 16);
+
+    return wav;
+}
+
+static void
+test_wav_reader_pcm16(void)
+{
+    static const guint8 data[] = {0x00, 0x00, 0x00, 0x40, 0x00, 0x80, 0xFF, 0x7F, 0x00, 0xC0, 0x01, 0x00};
+    GByteArray *wav = new_pcm16_stereo();
+    WavReader *reader;
+    float samples[8];
+
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    reader = open_wav(wav);
+
+    g_assert_nonnull(reader);
+    g_assert_cmpuint(wav_reader_get_sample_rate(reader), ==, 44100);
+    g_assert_cmpint(wav_reader_get_channels(reader), ==, 2);
+    g_assert_cmpuint(wav_reader_get_frames(reader), ==, 3);
+
+    g_assert_cmpint(wav_reader_read(reader, samples, 4), ==, 3);
+    g_assert_cmpfloat(samples[0], ==, 0.0f);
+    g_assert_cmpfloat(samples[1], ==, 0.5f);
+    g_assert_cmpfloat(samples[2], ==, -1.0f);
+    g_assert_cmpfloat(samples[3], ==, 32767.0f / 32768.0f);
+    g_assert_cmpfloat(samples[4], ==, -0.5f);
+    g_assert_cmpfloat(samples[5], ==, 1.0f / 32768.0f);
+    g_assert_cmpint(wav_reader_read(reader, samples, 4), ==, 0);
+
+    wav_reader_close(reader);
+}
+
+static void
+test_wav_reader_pcm8(void)
+{
+    static const guint8 data[] = {0x80, 0x00, 0xFF};
+    GByteArray *wav = test_wav_new();
+    WavReader *reader;
+    float samples[3];
+
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, 1, 8000, 8);
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    reader = open_wav(wav);
+
+    g_assert_nonnull(reader);
+    g_assert_cmpint(wav_reader_read(reader, samples, 3), ==, 3);
+    g_assert_cmpfloat(samples[0], ==, 0.0f);
+    g_assert_cmpfloat(samples[1], ==, -1.0f);
+    g_assert_cmpfloat(samples[2], ==, 127.0f / 128.0f);
+
+    wav_reader_close(reader);
+}
+
+static void
+test_wav_reader_pcm24(void)
+{
+    static const guint8 data[] = {0x00, 0x00, 0x40, 0x00, 0x00, 0x80, 0xFF, 0xFF, 0xFF};
+    GByteArray *wav = test_wav_new();
+    WavReader *reader;
+    float samples[3];
+
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, 1, 48000, 24);
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    reader = open_wav(wav);
+
+    g_assert_nonnull(reader);
+    g_assert_cmpint(wav_reader_read(reader, samples, 3), ==, 3);
+    g_assert_cmpfloat(samples[0], ==, 0.5f);
+    g_assert_cmpfloat(samples[1], ==, -1.0f);
+    g_assert_cmpfloat(samples[2], ==, -1.0f / 8388608.0f);
+
+    wav_reader_close(reader);
+}
+
+static void
+test_wav_reader_float_extensible(void)
+{
+    // 0.25 and -2, samples outside of -1 to 1 are kept as they are
+    static const guint8 data[] = {0x00, 0x00, 0x80, 0x3E, 0x00, 0x00, 0x00, 0xC0};
+    guint8 format[40] = {0};
+    GByteArray *wav = test_wav_new();
+    WavReader *reader;
+    float samples[2];
+
+    format[0] = 0xFE;
+    format[1] = 0xFF;
+    format[2] = 1;
+    format[4] = 0x80;
+    format[5] = 0xBB;
+    format[12] = 4;
+    format[14] = 32;
+    format[16] = 22;
+    format[24] = TEST_WAV_FORMAT_IEEE_FLOAT;
+    test_wav_add_chunk(wav, "fmt ", sizeof(format), format, sizeof(format));
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    reader = open_wav(wav);
+
+    g_assert_nonnull(reader);
+    g_assert_cmpuint(wav_reader_get_sample_rate(reader), ==, 48000);
+    g_assert_cmpuint(wav_reader_get_frames(reader), ==, 2);
+    g_assert_cmpint(wav_reader_read(reader, samples, 2), ==, 2);
+    g_assert_cmpfloat(samples[0], ==, 0.25f);
+    g_assert_cmpfloat(samples[1], ==, -2.0f);
+
+    wav_reader_close(reader);
+}
+
+static void
+test_wav_reader_seek(void)
+{
+    static const guint8 data[] = {0x01, 0x00, 0x02, 0x00, 0x03, 0x00};
+    GByteArray *wav = test_wav_new();
+    WavReader *reader;
+    float sample;
+
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, 1, 8000, 16);
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    reader = open_wav(wav);
+
+    g_assert_nonnull(reader);
+    g_assert_true(wav_reader_seek(reader, 2));
+    g_assert_cmpint(wav_reader_read(reader, &sample, 1), ==, 1);
+    g_assert_cmpfloat(sample, ==, 3.0f / 32768.0f);
+
+    g_assert_true(wav_reader_seek(reader, 0));
+    g_assert_cmpint(wav_reader_read(reader, &sample, 1), ==, 1);
+    g_assert_cmpfloat(sample, ==, 1.0f / 32768.0f);
+
+    g_assert_true(wav_reader_seek(reader, 3));
+    g_assert_cmpint(wav_reader_read(reader, &sample, 1), ==, 0);
+    g_assert_false(wav_reader_seek(reader, 4));
+
+    wav_reader_close(reader);
+}
+
+static void
+test_wav_reader_skip_chunks(void)
+{
+    static const guint8 data[] = {0x00, 0x40};
+    GByteArray *wav = test_wav_new();
+    WavReader *reader;
+    float sample;
+
+    // Chunks of an odd size are padded to an even one
+    test_wav_add_chunk(wav, "LIST", 3, "abc", 3);
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, 1, 8000, 16);
+    test_wav_add_chunk(wav, "fact", 4, "\0\0\0\0", 4);
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    reader = open_wav(wav);
+
+    g_assert_nonnull(reader);
+    g_assert_cmpint(wav_reader_read(reader, &sample, 1), ==, 1);
+    g_assert_cmpfloat(sample, ==, 0.5f);
+
+    wav_reader_close(reader);
+}
+
+static void
+test_wav_reader_not_wav(void)
+{
+    GByteArray *wav;
+
+    // Cut short within the RIFF header
+    wav = test_wav_new();
+    g_byte_array_set_size(wav, 10);
+    assert_refused(wav);
+
+    wav = new_pcm16_stereo();
+    memcpy(wav->data, "RIFX", 4);
+    assert_refused(wav);
+
+    wav = new_pcm16_stereo();
+    memcpy(wav->data + 8, "AVI ", 4);
+    assert_refused(wav);
+
+    // Nothing but the header
+    assert_refused(test_wav_new());
+}
+
+static void
+test_wav_reader_missing_samples(void)
+{
+    static const guint8 data[] = {0x00, 0x00, 0x00, 0x00};
+    GByteArray *wav;
+
+    assert_refused(new_pcm16_stereo());
+
+    // The format has to come before the samples
+    wav = test_wav_new();
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, 2, 44100, 16);
+    assert_refused(wav);
+
+    // A chunk claiming to run far past the end of the file hides everything after it
+    wav = new_pcm16_stereo();
+    test_wav_add_chunk(wav, "LIST", 0xFFFFFFF0, NULL, 0);
+    test_wav_add_chunk(wav, "data", sizeof(data), data, sizeof(data));
+    assert_refused(wav);
+}
+
+static void
+test_wav_reader_truncated_format(void)
+{
+    guint8 format[16] = {0};
+    GByteArray *wav;
+
+    // Too short to hold the fields of any format
+    wav = test_wav_new();
+    test_wav_add_chunk(wav, "fmt ", 14, format, 14);
+    assert_refused(wav);
+
+    // Cut short within the format
+    wav = new_pcm16_stereo();
+    g_byte_array_set_size(wav, FORMAT_OFFSET + 10);
+    assert_refused(wav);
+
+    // Extensible formats have to hold the sub format
+    wav = new_pcm16_stereo();
+    wav->data[FORMAT_OFFSET] = 0xFE;
+    wav->data[FORMAT_OFFSET + 1] = 0xFF;
+    assert_refused(wav);
+
+    // Formats of more than 64 bytes are skipped like any other unknown chunk
+    wav = test_wav_new();
+    test_wav_add_chunk(wav, "fmt ", 66, NULL, 0);
+    assert_refused(wav);
+}
+
+static void
+test_wav_reader_unsupported_format(void)
+{
+    GByteArray *wav;
+
+    wav = new_pcm16_stereo();
+    wav->data[FORMAT_OFFSET + 2] = 0;
+    assert_refused(wav);
+
+    wav = new_pcm16_stereo();
+    memset(wav->data + FORMAT_OFFSET + 4, 0, 4);
+    assert_refused(wav);
+
+    // Block align of 3 bytes for 2 channels
+    wav = new_pcm16_stereo();
+    wav->data[FORMAT_OFFSET + 12] = 3;
+    assert_refused(wav);
+
+    // More bits than fit in the samples
+    wav = new_pcm16_stereo();
+    wav->data[FORMAT_OFFSET + 14] = 17;
+    assert_refused(wav);
+
+    // Compressed samples
+    wav = new_pcm16_stereo();
+    wav->data[FORMAT_OFFSET] = 0x02;
+    assert_refused(wav);
+
+    wav = test_wav_new();
+    test_wav_add_format(wav, TEST_WAV_FORMAT_PCM, 1, 8000, 40);
+    assert_refused(wav);
+
+    wav = test_wav_new();
+    test_wav_add_format(wav, TEST_WAV_FORMAT_IEEE_FLOAT, 1, 8000, 16);
+    assert_refused(wav);
+}
+
+static void
+test_wav_reader_data_size(void)
+{
+    static const guint8 data[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    // Size stored in the data chunk, and the frames it's expected to give for the 10 bytes of samples
+    static const struct
+    {
+        guint32 size;
+        guint64 frames;
+    } cases[] = {
+        {4, 1},
+        // Partial frames are left out
+        {10, 2},
+        // Larger than the file
+        {1000, 2},
+        // Not filled in by a streaming writer
+        {0, 2},
+        {G_MAXUINT32, 2},
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++)
+    {
+        GByteArray *wav = new_pcm16_stereo();
+        WavReader *reader;
+
+        test_wav_add_chunk(wav, "data", cases[i].size, data, sizeof(data));
+        reader = open_wav(wav);
+
+        g_assert_nonnull(reader);
+        g_assert_cmpuint(wav_reader_get_frames(reader), ==, cases[i].frames);
+
+        wav_reader_close(reader);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/wav-reader/pcm16", test_wav_reader_pcm16);
+    g_test_add_func("/wav-reader/pcm8", test_wav_reader_pcm8);
+    g_test_add_func("/wav-reader/pcm24", test_wav_reader_pcm24);
+    g_test_add_func("/wav-reader/float-extensible", test_wav_reader_float_extensible);
+    g_test_add_func("/wav-reader/seek", test_wav_reader_seek);
+    g_test_add_func("/wav-reader/skip-chunks", test_wav_reader_skip_chunks);
+    g_test_add_func("/wav-reader/not-wav", test_wav_reader_not_wav);
+    g_test_add_func("/wav-reader/missing-samples", test_wav_reader_missing_samples);
+    g_test_add_func("/wav-reader/truncated-format", test_wav_reader_truncated_format);
+    g_test_add_func("/wav-reader/unsupported-format", test_wav_reader_unsupported_format);
+    g_test_add_func("/wav-reader/data-size", test_wav_reader_data_size);
+
+    return g_test_run();
+}